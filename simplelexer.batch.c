@@ -0,0 +1,1002 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+/* io_uring has no libc wrappers, so the driver needs syscall()
+   and GCC's atomic builtins to use it. */
+#if defined(__linux__) && !defined(SIMPLELEXER_NO_IO_URING) \
+    && defined(__GNUC__)
+#define _DEFAULT_SOURCE
+#define SIMPLELEXER_IO_URING
+#endif
+
+#include "simplelexer.batch.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef SIMPLELEXER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/* Opening and closing files through io_uring requires Linux 5.6. */
+#if !defined(IORING_FEAT_RW_CUR_POS) || !defined(__NR_io_uring_setup)
+#undef SIMPLELEXER_IO_URING
+#endif
+#endif
+
+/* the number of files that SimpleLexer_LexFiles() keeps in flight
+   by default */
+#define SIMPLE_BATCH_QUEUE_DEPTH 64
+
+/* the default size of each file's read buffer */
+#define SIMPLE_BATCH_BUFFER_SIZE (64 * 1024)
+
+/* the initial size of the lexers' growable token buffers */
+#define SIMPLE_BATCH_TOKEN_BUFFER_SIZE 256
+
+/* the most threads that the fallback thread pool starts */
+#define SIMPLE_BATCH_MAX_THREADS 64
+
+/*
+ * These are the operations that a batch performs on its files.
+ */
+typedef enum SimpleBatchOperation {
+    SIMPLE_BATCH_OPEN,
+    SIMPLE_BATCH_READ,
+    SIMPLE_BATCH_CLOSE
+} SimpleBatchOperation;
+
+/*
+ * This is one of the files in flight.  Each slot has at most one
+ * operation pending at a time.  The slots are reused for new files
+ * once their files are closed.
+ */
+typedef struct SimpleBatchSlot {
+    SimpleLexer lexer;
+    char* buffer;               /* the slot's read buffer */
+    size_t file;                /* the index of the slot's file */
+    int fd;                     /* the file's descriptor */
+    int isStream;               /* whether the file can't be read
+                                   at offsets (for example, a pipe) */
+    off_t offset;               /* where the next read starts */
+    SimpleBatchOperation operation; /* the pending operation */
+    long result;                /* the operation's result or minus errno */
+} SimpleBatchSlot;
+
+#ifdef SIMPLELEXER_IO_URING
+/*
+ * This is an io_uring instance and its memory-mapped queues.
+ */
+typedef struct SimpleBatchRing {
+    int fd;
+    void* rings;                /* the submission and completion rings */
+    size_t ringsSize;
+    struct io_uring_sqe* sqes;  /* the submission queue entries */
+    size_t sqesSize;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+    unsigned numUnsubmitted;    /* entries queued since the last submission */
+} SimpleBatchRing;
+
+/* the user data of the entries that cancel slots' operations */
+#define SIMPLE_BATCH_CANCEL UINT64_MAX
+#endif
+
+typedef struct SimpleBatch {
+    const char* const* paths;
+    size_t numPaths;
+    size_t nextPath;            /* the next file to open */
+    SimpleBatchSlot* slots;
+    size_t numSlots;
+    size_t bufferSize;
+    size_t numPending;          /* the number of pending operations */
+    int stopped;                /* whether a handler stopped lexing */
+
+    SimpleBatchTokenHandler tokenHandler;
+    SimpleBatchFileHandler fileHandler;
+    void* context;
+    size_t file;                /* the file whose tokens are being pushed */
+
+#ifdef SIMPLELEXER_IO_URING
+    int usesRing;               /* whether the ring or the threads are used */
+    SimpleBatchRing ring;
+#endif
+
+    /* The thread pool passes slot indices through two circular queues
+       with room for every slot. */
+    pthread_mutex_t mutex;      /* guards the queues and quitting */
+    pthread_cond_t requested;   /* signaled when requests arrive */
+    pthread_cond_t completed;   /* signaled when operations complete */
+    size_t* requests;
+    size_t firstRequest;
+    size_t numRequests;
+    size_t* completions;
+    size_t firstCompletion;
+    size_t numCompletions;
+    pthread_t* threads;
+    size_t numThreads;
+    int quitting;               /* whether the threads should exit */
+} SimpleBatch;
+
+/*
+ * Perform a slot's pending operation on the calling thread.
+ */
+static void SimpleBatch_Perform(
+    const SimpleBatch* batch,
+    SimpleBatchSlot* slot)
+{
+    ssize_t size;
+
+    switch (slot->operation)
+    {
+    case SIMPLE_BATCH_OPEN:
+        slot->result = open(batch->paths[slot->file], O_RDONLY | O_CLOEXEC);
+        break;
+    case SIMPLE_BATCH_READ:
+        do
+        {
+            size = slot->isStream
+                ? read(slot->fd, slot->buffer, batch->bufferSize)
+                : pread(slot->fd, slot->buffer, batch->bufferSize,
+                    slot->offset);
+        } while (size < 0 && errno == EINTR);
+        slot->result = (long)size;
+        break;
+    case SIMPLE_BATCH_CLOSE:
+        slot->result = close(slot->fd);
+        break;
+    }
+    if (slot->result < 0)
+    {
+        slot->result = -errno;
+    }
+}
+
+static void* SimpleBatch_RunThread(void* argument)
+{
+    SimpleBatch* batch;
+    size_t slot;
+
+    batch = argument;
+    pthread_mutex_lock(&batch->mutex);
+    for (;;)
+    {
+        while (batch->numRequests == 0 && !batch->quitting)
+        {
+            pthread_cond_wait(&batch->requested, &batch->mutex);
+        }
+        if (batch->numRequests == 0)
+        {
+            break;
+        }
+        slot = batch->requests[batch->firstRequest];
+        batch->firstRequest = (batch->firstRequest + 1) % batch->numSlots;
+        --batch->numRequests;
+        pthread_mutex_unlock(&batch->mutex);
+
+        SimpleBatch_Perform(batch, &batch->slots[slot]);
+
+        pthread_mutex_lock(&batch->mutex);
+        batch->completions[(batch->firstCompletion + batch->numCompletions)
+            % batch->numSlots] = slot;
+        ++batch->numCompletions;
+        pthread_cond_signal(&batch->completed);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+/*
+ * Start up to `numThreads` threads.  If none start, the calling thread
+ * performs the operations as they're submitted.  This returns nonzero
+ * if the thread pool couldn't be created at all.
+ */
+static int SimpleBatch_StartThreads(SimpleBatch* batch, size_t numThreads)
+{
+    batch->requests = malloc(batch->numSlots * sizeof(size_t));
+    batch->completions = malloc(batch->numSlots * sizeof(size_t));
+    batch->threads = malloc(numThreads * sizeof(pthread_t));
+    if (batch->requests == NULL || batch->completions == NULL
+        || batch->threads == NULL)
+    {
+        goto failed;
+    }
+    if (pthread_mutex_init(&batch->mutex, NULL) != 0)
+    {
+        goto failed;
+    }
+    if (pthread_cond_init(&batch->requested, NULL) != 0)
+    {
+        goto failedWithMutex;
+    }
+    if (pthread_cond_init(&batch->completed, NULL) != 0)
+    {
+        pthread_cond_destroy(&batch->requested);
+        goto failedWithMutex;
+    }
+
+    batch->firstRequest = 0;
+    batch->numRequests = 0;
+    batch->firstCompletion = 0;
+    batch->numCompletions = 0;
+    batch->quitting = 0;
+    batch->numThreads = 0;
+    while (batch->numThreads < numThreads
+        && pthread_create(&batch->threads[batch->numThreads], NULL,
+            SimpleBatch_RunThread, batch) == 0)
+    {
+        ++batch->numThreads;
+    }
+    return 0;
+
+failedWithMutex:
+    pthread_mutex_destroy(&batch->mutex);
+failed:
+    free(batch->requests);
+    free(batch->completions);
+    free(batch->threads);
+    return 1;
+}
+
+static void SimpleBatch_StopThreads(SimpleBatch* batch)
+{
+    pthread_mutex_lock(&batch->mutex);
+    batch->quitting = 1;
+    pthread_cond_broadcast(&batch->requested);
+    pthread_mutex_unlock(&batch->mutex);
+
+    while (batch->numThreads != 0)
+    {
+        pthread_join(batch->threads[--batch->numThreads], NULL);
+    }
+
+    pthread_cond_destroy(&batch->completed);
+    pthread_cond_destroy(&batch->requested);
+    pthread_mutex_destroy(&batch->mutex);
+    free(batch->requests);
+    free(batch->completions);
+    free(batch->threads);
+}
+
+static void SimpleBatch_SubmitToThreads(SimpleBatch* batch, size_t slot)
+{
+    if (batch->numThreads == 0)
+    {
+        SimpleBatch_Perform(batch, &batch->slots[slot]);
+        batch->completions[(batch->firstCompletion + batch->numCompletions)
+            % batch->numSlots] = slot;
+        ++batch->numCompletions;
+        return;
+    }
+
+    pthread_mutex_lock(&batch->mutex);
+    batch->requests[(batch->firstRequest + batch->numRequests)
+        % batch->numSlots] = slot;
+    ++batch->numRequests;
+    pthread_cond_signal(&batch->requested);
+    pthread_mutex_unlock(&batch->mutex);
+}
+
+static size_t SimpleBatch_WaitForThreads(SimpleBatch* batch)
+{
+    size_t slot;
+
+    pthread_mutex_lock(&batch->mutex);
+    while (batch->numCompletions == 0)
+    {
+        pthread_cond_wait(&batch->completed, &batch->mutex);
+    }
+    slot = batch->completions[batch->firstCompletion];
+    batch->firstCompletion = (batch->firstCompletion + 1) % batch->numSlots;
+    --batch->numCompletions;
+    pthread_mutex_unlock(&batch->mutex);
+    return slot;
+}
+
+#ifdef SIMPLELEXER_IO_URING
+/*
+ * Return nonzero if the io_uring instance `fd` supports opening,
+ * reading, and closing files.
+ */
+static int SimpleBatchRing_SupportsFiles(int fd)
+{
+    static const int operations[] = {
+        IORING_OP_OPENAT,
+        IORING_OP_READ,
+        IORING_OP_CLOSE
+    };
+    struct io_uring_probe* probe;
+    size_t index;
+    int supported;
+
+    probe = calloc(1, sizeof(struct io_uring_probe)
+        + IORING_OP_LAST * sizeof(struct io_uring_probe_op));
+    if (probe == NULL)
+    {
+        return 0;
+    }
+
+    supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE,
+        probe, IORING_OP_LAST) == 0;
+    for (index = 0; supported && index < 3; ++index)
+    {
+        supported = operations[index] <= probe->last_op
+            && (probe->ops[operations[index]].flags & IO_URING_OP_SUPPORTED);
+    }
+
+    free(probe);
+    return supported;
+}
+
+/*
+ * Set up an io_uring instance with room for `numEntries` operations.
+ * This returns nonzero if the kernel doesn't support (or forbids) io_uring
+ * or any of the operations that batches need.
+ */
+static int SimpleBatchRing_Init(SimpleBatchRing* ring, size_t numEntries)
+{
+    struct io_uring_params params;
+    size_t cqSize;
+    char* rings;
+
+    if (numEntries > UINT32_MAX)
+    {
+        return 1;
+    }
+
+    (void) memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, (unsigned)numEntries,
+        &params);
+    if (ring->fd < 0)
+    {
+        return 1;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)
+        || !SimpleBatchRing_SupportsFiles(ring->fd))
+    {
+        (void) close(ring->fd);
+        return 1;
+    }
+
+    ring->ringsSize = params.sq_off.array
+        + params.sq_entries * sizeof(unsigned);
+    cqSize = params.cq_off.cqes
+        + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (cqSize > ring->ringsSize)
+    {
+        ring->ringsSize = cqSize;
+    }
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->rings = mmap(NULL, ring->ringsSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->rings == MAP_FAILED)
+    {
+        (void) close(ring->fd);
+        return 1;
+    }
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE,
+        MAP_SHARED, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        (void) munmap(ring->rings, ring->ringsSize);
+        (void) close(ring->fd);
+        return 1;
+    }
+
+    rings = ring->rings;
+    ring->sqTail = (unsigned*)(rings + params.sq_off.tail);
+    ring->sqMask = (unsigned*)(rings + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned*)(rings + params.sq_off.array);
+    ring->cqHead = (unsigned*)(rings + params.cq_off.head);
+    ring->cqTail = (unsigned*)(rings + params.cq_off.tail);
+    ring->cqMask = (unsigned*)(rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(rings + params.cq_off.cqes);
+    ring->numUnsubmitted = 0;
+    return 0;
+}
+
+static void SimpleBatchRing_Destroy(SimpleBatchRing* ring)
+{
+    (void) munmap(ring->sqes, ring->sqesSize);
+    (void) munmap(ring->rings, ring->ringsSize);
+    (void) close(ring->fd);
+}
+
+/*
+ * Queue a slot's pending operation.  The queue always has room because
+ * it has at least as many entries as there are slots.  The operation
+ * is submitted the next time that the batch waits for completions.
+ */
+static void SimpleBatchRing_Queue(SimpleBatch* batch, size_t slotIndex)
+{
+    SimpleBatchRing* ring;
+    SimpleBatchSlot* slot;
+    struct io_uring_sqe* sqe;
+    unsigned tail;
+    unsigned index;
+
+    ring = &batch->ring;
+    slot = &batch->slots[slotIndex];
+
+    /* Only this thread writes the tail. */
+    tail = *ring->sqTail;
+    index = tail & *ring->sqMask;
+    sqe = &ring->sqes[index];
+    (void) memset(sqe, 0, sizeof(*sqe));
+    switch (slot->operation)
+    {
+    case SIMPLE_BATCH_OPEN:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = (uintptr_t)batch->paths[slot->file];
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+        break;
+    case SIMPLE_BATCH_READ:
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = slot->fd;
+        sqe->addr = (uintptr_t)slot->buffer;
+        sqe->len = (unsigned)batch->bufferSize;
+        /* An offset of -1 reads from the file's current position. */
+        sqe->off = slot->isStream ? (uint64_t)-1 : (uint64_t)slot->offset;
+        break;
+    case SIMPLE_BATCH_CLOSE:
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = slot->fd;
+        break;
+    }
+    sqe->user_data = slotIndex;
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ++ring->numUnsubmitted;
+}
+
+/*
+ * Wait for an operation to complete, submitting the queued operations
+ * if none has, and store its result in its slot.  This returns the slot's
+ * index or SIZE_MAX (with errno set) if io_uring failed.
+ */
+static size_t SimpleBatchRing_Wait(SimpleBatch* batch)
+{
+    SimpleBatchRing* ring;
+    struct io_uring_cqe* cqe;
+    unsigned head;
+    size_t slot;
+    long numSubmitted;
+
+    ring = &batch->ring;
+    for (;;)
+    {
+        /* Only this thread writes the head. */
+        head = *ring->cqHead;
+        if (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            cqe = &ring->cqes[head & *ring->cqMask];
+            slot = (size_t)cqe->user_data;
+            batch->slots[slot].result = cqe->res;
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            return slot;
+        }
+
+        numSubmitted = syscall(__NR_io_uring_enter, ring->fd,
+            ring->numUnsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (numSubmitted < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return SIZE_MAX;
+        }
+        ring->numUnsubmitted -= (unsigned)numSubmitted;
+    }
+}
+
+/*
+ * Stop a batch's operations after io_uring failed: take back the queued
+ * operations that the kernel hasn't seen, cancel the rest, wait for them
+ * to finish, and close the files that they left open.  This returns
+ * nonzero if io_uring failed again, in which case the kernel might still
+ * be using the slots' buffers.
+ */
+static int SimpleBatchRing_Abort(SimpleBatch* batch)
+{
+    SimpleBatchRing* ring;
+    SimpleBatchSlot* slot;
+    struct io_uring_sqe* sqe;
+    struct io_uring_cqe* cqe;
+    unsigned tail;
+    unsigned head;
+    size_t index;
+    long numSubmitted;
+    int isOpen;
+
+    ring = &batch->ring;
+
+    /* Only this thread writes the tail, and the kernel reads entries
+       only when they're submitted. */
+    tail = *ring->sqTail;
+    for (; ring->numUnsubmitted != 0; --ring->numUnsubmitted)
+    {
+        --tail;
+        sqe = &ring->sqes[ring->sqArray[tail & *ring->sqMask]];
+        batch->slots[sqe->user_data].result = -ECANCELED;
+        --batch->numPending;
+    }
+
+    /* Cancelling an operation that isn't in flight does nothing. */
+    for (index = 0; index < batch->numSlots; ++index)
+    {
+        sqe = &ring->sqes[tail & *ring->sqMask];
+        (void) memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->addr = index;
+        sqe->user_data = SIMPLE_BATCH_CANCEL;
+        ring->sqArray[tail & *ring->sqMask] = tail & *ring->sqMask;
+        ++tail;
+        ++ring->numUnsubmitted;
+    }
+    __atomic_store_n(ring->sqTail, tail, __ATOMIC_RELEASE);
+
+    for (;;)
+    {
+        head = *ring->cqHead;
+        if (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+        {
+            cqe = &ring->cqes[head & *ring->cqMask];
+            if (cqe->user_data != SIMPLE_BATCH_CANCEL)
+            {
+                batch->slots[cqe->user_data].result = cqe->res;
+                --batch->numPending;
+            }
+            __atomic_store_n(ring->cqHead, head + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+        if (batch->numPending == 0)
+        {
+            break;
+        }
+
+        numSubmitted = syscall(__NR_io_uring_enter, ring->fd,
+            ring->numUnsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (numSubmitted < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return 1;
+        }
+        ring->numUnsubmitted -= (unsigned)numSubmitted;
+    }
+
+    /* Every slot's last operation has finished or was cancelled. */
+    for (index = 0; index < batch->numSlots; ++index)
+    {
+        slot = &batch->slots[index];
+        if (slot->operation == SIMPLE_BATCH_OPEN)
+        {
+            isOpen = slot->result >= 0;
+            slot->fd = (int)slot->result;
+        }
+        else
+        {
+            /* A cancelled close leaves its file open. */
+            isOpen = slot->operation == SIMPLE_BATCH_READ
+                || slot->result == -ECANCELED;
+        }
+        if (isOpen)
+        {
+            (void) close(slot->fd);
+        }
+    }
+    return 0;
+}
+#endif  /* SIMPLELEXER_IO_URING */
+
+/*
+ * Start a slot's pending operation.
+ */
+static void SimpleBatch_Submit(SimpleBatch* batch, size_t slot)
+{
+    ++batch->numPending;
+#ifdef SIMPLELEXER_IO_URING
+    if (batch->usesRing)
+    {
+        SimpleBatchRing_Queue(batch, slot);
+        return;
+    }
+#endif
+    SimpleBatch_SubmitToThreads(batch, slot);
+}
+
+/*
+ * Wait for an operation to complete.  This returns the operation's slot
+ * or SIZE_MAX (with errno set) if io_uring failed.
+ */
+static size_t SimpleBatch_Wait(SimpleBatch* batch)
+{
+    size_t slot;
+
+#ifdef SIMPLELEXER_IO_URING
+    if (batch->usesRing)
+    {
+        slot = SimpleBatchRing_Wait(batch);
+        if (slot != SIZE_MAX)
+        {
+            --batch->numPending;
+        }
+        return slot;
+    }
+#endif
+    slot = SimpleBatch_WaitForThreads(batch);
+    --batch->numPending;
+    return slot;
+}
+
+/*
+ * Open the next file in a slot if the batch hasn't stopped.
+ */
+static void SimpleBatch_StartFile(SimpleBatch* batch, size_t slotIndex)
+{
+    SimpleBatchSlot* slot;
+
+    if (batch->stopped || batch->nextPath == batch->numPaths)
+    {
+        return;
+    }
+
+    slot = &batch->slots[slotIndex];
+    slot->file = batch->nextPath++;
+    slot->isStream = 0;
+    slot->offset = 0;
+    SimpleLexer_Reset(&slot->lexer);
+    slot->operation = SIMPLE_BATCH_OPEN;
+    SimpleBatch_Submit(batch, slotIndex);
+}
+
+/*
+ * Pass a file's result to the file handler unless the batch has stopped.
+ * `errorNumber` is the errno value for SIMPLE_LEXER_IO_ERROR.
+ */
+static void SimpleBatch_FinishFile(
+    SimpleBatch* batch,
+    const SimpleBatchSlot* slot,
+    SimpleLexerError error,
+    int errorNumber)
+{
+    if (batch->stopped)
+    {
+        return;
+    }
+    if (error == SIMPLE_LEXER_STOPPED)
+    {
+        batch->stopped = 1;
+    }
+    else if (batch->fileHandler != NULL)
+    {
+        if (error == SIMPLE_LEXER_IO_ERROR)
+        {
+            errno = errorNumber;
+        }
+        batch->stopped = batch->fileHandler(batch->context, slot->file, error)
+            != 0;
+    }
+}
+
+static int SimpleBatch_PassToken(void* context, const SimpleToken* token)
+{
+    SimpleBatch* batch;
+
+    batch = context;
+    return batch->tokenHandler(batch->context, batch->file, token);
+}
+
+/*
+ * Pass the tokens in a slot's read buffer to the token handler.
+ * This returns SIMPLE_LEXER_EOF once the buffer is exhausted.
+ */
+static SimpleLexerError SimpleBatch_HandleTokens(
+    SimpleBatch* batch,
+    SimpleBatchSlot* slot)
+{
+    batch->file = slot->file;
+    return SimpleLexer_Feed(&slot->lexer, slot->buffer, (size_t)slot->result,
+        SimpleBatch_PassToken, batch);
+}
+
+/*
+ * Finish a slot's lexer and pass its final token, if any, to the token
+ * handler.
+ */
+static SimpleLexerError SimpleBatch_HandleFinalToken(
+    SimpleBatch* batch,
+    SimpleBatchSlot* slot)
+{
+    SimpleLexerError error;
+    SimpleToken token;
+
+    /* In fragment mode, the final token can come in fragments, too. */
+    do
+    {
+        token.text = NULL;
+        error = SimpleLexer_Finish(&slot->lexer, &token);
+        if (token.text != NULL
+            && batch->tokenHandler(batch->context, slot->file, &token))
+        {
+            return SIMPLE_LEXER_STOPPED;
+        }
+    } while (error == SIMPLE_LEXER_PARTIAL_TOKEN);
+    return error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error;
+}
+
+/*
+ * Act on the result of a slot's operation and start the slot's next one.
+ * Once a handler stops lexing, the batch only closes its open files.
+ */
+static void SimpleBatch_Complete(SimpleBatch* batch, size_t slotIndex)
+{
+    SimpleBatchSlot* slot;
+    SimpleLexerError error;
+
+    slot = &batch->slots[slotIndex];
+    switch (slot->operation)
+    {
+    case SIMPLE_BATCH_OPEN:
+        if (slot->result < 0)
+        {
+            SimpleBatch_FinishFile(batch, slot, SIMPLE_LEXER_IO_ERROR,
+                (int)-slot->result);
+            SimpleBatch_StartFile(batch, slotIndex);
+            return;
+        }
+        slot->fd = (int)slot->result;
+        slot->operation = batch->stopped
+            ? SIMPLE_BATCH_CLOSE
+            : SIMPLE_BATCH_READ;
+        break;
+
+    case SIMPLE_BATCH_READ:
+        if (batch->stopped)
+        {
+            slot->operation = SIMPLE_BATCH_CLOSE;
+            break;
+        }
+        if (slot->result == -EINTR)
+        {
+            break;
+        }
+        if (slot->result == -ESPIPE && !slot->isStream)
+        {
+            slot->isStream = 1;
+            break;
+        }
+
+        if (slot->result < 0)
+        {
+            SimpleBatch_FinishFile(batch, slot, SIMPLE_LEXER_IO_ERROR,
+                (int)-slot->result);
+        }
+        else if (slot->result == 0)
+        {
+            SimpleBatch_FinishFile(batch, slot,
+                SimpleBatch_HandleFinalToken(batch, slot), 0);
+        }
+        else
+        {
+            error = SimpleBatch_HandleTokens(batch, slot);
+            if (error == SIMPLE_LEXER_EOF)
+            {
+                slot->offset += slot->result;
+                break;
+            }
+            SimpleBatch_FinishFile(batch, slot, error, 0);
+        }
+        slot->operation = SIMPLE_BATCH_CLOSE;
+        break;
+
+    case SIMPLE_BATCH_CLOSE:
+        SimpleBatch_StartFile(batch, slotIndex);
+        return;
+    }
+    SimpleBatch_Submit(batch, slotIndex);
+}
+
+/*
+ * Free the first `numSlots` slots' buffers and lexers.
+ */
+static void SimpleBatch_DestroySlots(SimpleBatch* batch, size_t numSlots)
+{
+    while (numSlots != 0)
+    {
+        --numSlots;
+        SimpleLexer_Destroy(&batch->slots[numSlots].lexer);
+        free(batch->slots[numSlots].buffer);
+    }
+    free(batch->slots);
+}
+
+SimpleLexerError SimpleLexer_LexFiles(
+    const char* const* paths,
+    size_t numPaths,
+    const SimpleBatchOptions* options,
+    SimpleBatchTokenHandler tokenHandler,
+    SimpleBatchFileHandler fileHandler,
+    void* context)
+{
+    SimpleBatch batch;
+    SimpleBatchSlot* slot;
+    size_t maxTokenSize;
+    size_t numThreads;
+    size_t index;
+    int savedErrno;
+    int failed;
+    int inUse;
+
+    assert(paths != NULL || numPaths == 0);
+    assert(tokenHandler != NULL);
+
+    if (numPaths == 0)
+    {
+        return SIMPLE_LEXER_EOF;
+    }
+
+    batch.paths = paths;
+    batch.numPaths = numPaths;
+    batch.nextPath = 0;
+    batch.numSlots = SIMPLE_BATCH_QUEUE_DEPTH;
+    batch.bufferSize = SIMPLE_BATCH_BUFFER_SIZE;
+    maxTokenSize = SIZE_MAX;
+    if (options != NULL)
+    {
+        if (options->queueDepth != 0)
+        {
+            batch.numSlots = options->queueDepth;
+        }
+        if (options->bufferSize != 0)
+        {
+            batch.bufferSize = options->bufferSize;
+        }
+        if (options->maxTokenSize != 0)
+        {
+            maxTokenSize = options->maxTokenSize;
+        }
+    }
+    if (batch.numSlots > numPaths)
+    {
+        batch.numSlots = numPaths;
+    }
+    /* Reads can't return more than INT_MAX bytes on Linux anyway. */
+    if (batch.bufferSize > 0x7ffff000)
+    {
+        batch.bufferSize = 0x7ffff000;
+    }
+    batch.numPending = 0;
+    batch.stopped = 0;
+    batch.tokenHandler = tokenHandler;
+    batch.fileHandler = fileHandler;
+    batch.context = context;
+
+    batch.slots = calloc(batch.numSlots, sizeof(SimpleBatchSlot));
+    if (batch.slots == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    for (index = 0; index < batch.numSlots; ++index)
+    {
+        slot = &batch.slots[index];
+        slot->buffer = malloc(batch.bufferSize);
+        if (slot->buffer == NULL
+            || SimpleLexer_InitGrowable(&slot->lexer, NULL,
+                SIMPLE_BATCH_TOKEN_BUFFER_SIZE < maxTokenSize
+                    ? SIMPLE_BATCH_TOKEN_BUFFER_SIZE
+                    : maxTokenSize,
+                maxTokenSize) != 0)
+        {
+            free(slot->buffer);
+            SimpleBatch_DestroySlots(&batch, index);
+            return SIMPLE_LEXER_OUT_OF_MEMORY;
+        }
+        if (options != NULL && options->configure != NULL)
+        {
+            options->configure(context, &slot->lexer);
+        }
+        SimpleLexer_SetTokenViews(&slot->lexer, 1);
+    }
+
+    numThreads = batch.numSlots < SIMPLE_BATCH_MAX_THREADS
+        ? batch.numSlots
+        : SIMPLE_BATCH_MAX_THREADS;
+#ifdef SIMPLELEXER_IO_URING
+    batch.usesRing = SimpleBatchRing_Init(&batch.ring, batch.numSlots) == 0;
+    failed = !batch.usesRing
+        && SimpleBatch_StartThreads(&batch, numThreads) != 0;
+#else
+    failed = SimpleBatch_StartThreads(&batch, numThreads) != 0;
+#endif
+    if (failed)
+    {
+        SimpleBatch_DestroySlots(&batch, batch.numSlots);
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+
+    for (index = 0; index < batch.numSlots; ++index)
+    {
+        SimpleBatch_StartFile(&batch, index);
+    }
+    while (batch.numPending != 0)
+    {
+        index = SimpleBatch_Wait(&batch);
+        if (index == SIZE_MAX)
+        {
+            failed = 1;
+            break;
+        }
+        SimpleBatch_Complete(&batch, index);
+    }
+
+    savedErrno = errno;
+    inUse = 0;
+#ifdef SIMPLELEXER_IO_URING
+    if (batch.usesRing)
+    {
+        /* If the kernel might still write to the buffers, leak them. */
+        inUse = failed && SimpleBatchRing_Abort(&batch) != 0;
+        SimpleBatchRing_Destroy(&batch.ring);
+    }
+    else
+    {
+        SimpleBatch_StopThreads(&batch);
+    }
+#else
+    SimpleBatch_StopThreads(&batch);
+#endif
+    if (!inUse)
+    {
+        SimpleBatch_DestroySlots(&batch, batch.numSlots);
+    }
+    errno = savedErrno;
+
+    if (failed)
+    {
+        return SIMPLE_LEXER_IO_ERROR;
+    }
+    return batch.stopped ? SIMPLE_LEXER_STOPPED : SIMPLE_LEXER_EOF;
+}
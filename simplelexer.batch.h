@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a driver that lexes many files at once.  Unlike the rest of
+ * SimpleLexer, it depends on POSIX (open(), pread(), and POSIX threads).
+ * On Linux, it submits its reads through io_uring when the kernel allows.
+ */
+
+#ifndef __SIMPLELEXER_BATCH_H
+#define __SIMPLELEXER_BATCH_H
+
+#include "simplelexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * SimpleLexer_LexFiles() passes each token to a SimpleBatchTokenHandler
+ * along with the caller-supplied context pointer and the index of the token's
+ * file.  Like a SimpleTokenHandler, it returns zero to continue lexing and
+ * nonzero to stop.
+ */
+typedef int (*SimpleBatchTokenHandler)(
+    void* context,
+    size_t file,
+    const SimpleToken* token);
+
+/*
+ * SimpleLexer_LexFiles() passes each file's result to a SimpleBatchFileHandler
+ * once it's done with the file.  `error` is what SimpleLexer_LexFile() would
+ * have returned for the file (except that it's never SIMPLE_LEXER_STOPPED),
+ * and errno is set if `error` is SIMPLE_LEXER_IO_ERROR.  This returns zero
+ * to continue lexing and nonzero to stop.
+ */
+typedef int (*SimpleBatchFileHandler)(
+    void* context,
+    size_t file,
+    SimpleLexerError error);
+
+/*
+ * These are SimpleLexer_LexFiles()'s settings.  Zero fields mean defaults.
+ */
+typedef struct SimpleBatchOptions {
+    /* the number of files in flight at once (64 by default) */
+    size_t queueDepth;
+
+    /* the size of each file's read buffer in bytes (64 KiB by default) */
+    size_t bufferSize;
+
+    /* the size limit of each lexer's growable token buffer (no limit
+       by default; see SimpleLexer_InitGrowable()) */
+    size_t maxTokenSize;
+
+    /* if not NULL, called with the caller's context once for each lexer
+       after initializing it so that the caller can change its settings */
+    void (*configure)(void* context, SimpleLexer* lexer);
+} SimpleBatchOptions;
+
+/*
+ * Lex the `numPaths` files at `paths`, each as a separate stream.
+ * `options` may be NULL, in which case the defaults apply.
+ *
+ * This keeps up to `options->queueDepth` files in flight, each with its own
+ * read buffer and growable lexer, so the batch needs roughly `queueDepth`
+ * times `bufferSize` bytes plus the lexers' token buffers.  It opens, reads,
+ * and closes the files asynchronously through io_uring if possible and
+ * through a pool of threads calling open(), pread(), and close() otherwise
+ * (or if SimpleLexer was compiled with SIMPLELEXER_NO_IO_URING defined).
+ * Either way, the lexing and all handler calls happen on the calling thread
+ * as each read completes, so handlers and the lexers' symbol tables needn't
+ * be thread-safe.  Files are lexed as SimpleLexer_LexFd() lexes pipes,
+ * with token views enabled, and their tokens' spans start at the beginning
+ * of each file.  Tokens from different files interleave, but each file's
+ * tokens arrive in order, followed by its result, which goes to
+ * `fileHandler` if it isn't NULL.
+ *
+ * This returns SIMPLE_LEXER_EOF once it has passed every file's result to
+ * `fileHandler` (whether or not the files were lexed without errors) and
+ * SIMPLE_LEXER_STOPPED if a handler stopped lexing.  It returns
+ * SIMPLE_LEXER_OUT_OF_MEMORY if it couldn't allocate the batch's buffers
+ * and lexers and SIMPLE_LEXER_IO_ERROR (with errno set) if io_uring failed
+ * partway through, in which case some files' results might be missing.
+ */
+extern SimpleLexerError SimpleLexer_LexFiles(
+    const char* const* paths,
+    size_t numPaths,
+    const SimpleBatchOptions* options,
+    SimpleBatchTokenHandler tokenHandler,
+    SimpleBatchFileHandler fileHandler,
+    void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SIMPLELEXER_BATCH_H */
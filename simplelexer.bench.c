@@ -0,0 +1,769 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This measures SimpleLexer's throughput on synthetic corpora and on files
+ * named on the command line.  Run it without arguments for the defaults or
+ * with -h for its options.  Compile it with optimizations enabled.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "simplelexer.h"
+#include "simplelexer.file.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * This is the benchmark's configuration.
+ */
+typedef struct BenchOptions
+{
+    size_t corpusSize;          /* the size of each synthetic corpus */
+    size_t numWarmups;          /* untimed runs before the timed runs */
+    size_t numRepetitions;      /* timed runs */
+    const char* filter;         /* only corpora whose names contain this */
+    int tokenViews;             /* set if the lexers use token views */
+    SimpleLexerPositionTracking positionTracking;
+} BenchOptions;
+
+/*
+ * This is the text of a corpus and what lexing it yields.
+ */
+typedef struct Corpus
+{
+    const char* name;
+    const char* text;
+    size_t size;
+    SimpleToken* tokens;        /* copies of the corpus's tokens */
+    size_t numTokens;
+    size_t tokenBytes;          /* the total length of the tokens */
+    SimpleTokenArena arena;     /* holds the copies */
+} Corpus;
+
+/*
+ * This is the outcome of one timed run: how long it took and how much
+ * text and how many tokens it processed.
+ */
+typedef struct BenchRun
+{
+    double seconds;
+    size_t bytes;
+    size_t tokens;
+} BenchRun;
+
+typedef void (*BenchFunction)(const Corpus* corpus, size_t chunkSize,
+    BenchRun* run);
+
+/* Results accumulate here so that the compiler can't discard the work. */
+static volatile size_t sink;
+
+static char lexerBuffer[64 * 1024];
+static SimpleLexer lexer;
+static BenchOptions options;
+
+static double Now()
+{
+    struct timespec now;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+/*
+ * This builds synthetic corpora from pseudorandom pieces.
+ */
+typedef struct Generator
+{
+    char* text;
+    size_t size;
+    size_t length;
+    uint32_t seed;
+} Generator;
+
+static uint32_t Random(Generator* generator, uint32_t limit)
+{
+    generator->seed = generator->seed * 1103515245u + 12345u;
+    return (generator->seed >> 8) % limit;
+}
+
+static int IsFull(const Generator* generator)
+{
+    return generator->length == generator->size;
+}
+
+static void Put(Generator* generator, const char* text, size_t length)
+{
+    if (length > generator->size - generator->length)
+    {
+        length = generator->size - generator->length;
+    }
+    (void) memcpy(generator->text + generator->length, text, length);
+    generator->length += length;
+}
+
+static void PutChar(Generator* generator, char c)
+{
+    Put(generator, &c, 1);
+}
+
+static void PutWord(Generator* generator, size_t minLength, size_t maxLength)
+{
+    size_t length;
+
+    length = minLength + Random(generator, (uint32_t)(maxLength - minLength + 1));
+    while (length-- != 0)
+    {
+        PutChar(generator, (char)('a' + Random(generator, 26)));
+    }
+}
+
+static void GenerateShortTokens(Generator* generator)
+{
+    while (!IsFull(generator))
+    {
+        PutWord(generator, 1, 8);
+        PutChar(generator, Random(generator, 5) == 0 ? '\n' : ' ');
+    }
+}
+
+static void GenerateLongTokens(Generator* generator)
+{
+    while (!IsFull(generator))
+    {
+        PutWord(generator, 200, 2000);
+        PutChar(generator, Random(generator, 5) == 0 ? '\n' : ' ');
+    }
+}
+
+static void GenerateQuotedTokens(Generator* generator)
+{
+    size_t numWords;
+
+    while (!IsFull(generator))
+    {
+        PutChar(generator, '"');
+        for (numWords = 2 + Random(generator, 7); numWords != 0; --numWords)
+        {
+            PutWord(generator, 1, 8);
+            PutChar(generator, numWords == 1 ? '"' : ' ');
+        }
+        PutChar(generator, Random(generator, 5) == 0 ? '\n' : ' ');
+    }
+}
+
+static void GenerateEscapedTokens(Generator* generator)
+{
+    static const char escaped[] = "nt\"\\ #ab";
+    size_t length;
+
+    while (!IsFull(generator))
+    {
+        for (length = 1 + Random(generator, 8); length != 0; --length)
+        {
+            if (Random(generator, 2) == 0)
+            {
+                PutChar(generator, '\\');
+                PutChar(generator,
+                    escaped[Random(generator, sizeof(escaped) - 1)]);
+            }
+            else
+            {
+                PutChar(generator, (char)('a' + Random(generator, 26)));
+            }
+        }
+        PutChar(generator, Random(generator, 5) == 0 ? '\n' : ' ');
+    }
+}
+
+static void GenerateComments(Generator* generator)
+{
+    size_t numWords;
+
+    while (!IsFull(generator))
+    {
+        if (Random(generator, 5) == 0)
+        {
+            PutWord(generator, 1, 8);
+            PutChar(generator, ' ');
+            PutWord(generator, 1, 8);
+        }
+        else
+        {
+            Put(generator, "# ", 2);
+            for (numWords = 8 + Random(generator, 8); numWords != 0; --numWords)
+            {
+                PutWord(generator, 1, 8);
+                PutChar(generator, ' ');
+            }
+        }
+        PutChar(generator, '\n');
+    }
+}
+
+static void GenerateLongLines(Generator* generator)
+{
+    size_t lineLength;
+
+    while (!IsFull(generator))
+    {
+        for (lineLength = 0; lineLength < 64 * 1024 && !IsFull(generator);
+            lineLength += 9)
+        {
+            PutWord(generator, 1, 8);
+            PutChar(generator, ' ');
+        }
+        PutChar(generator, '\n');
+    }
+}
+
+static void GenerateCrlfLines(Generator* generator)
+{
+    size_t numWords;
+
+    while (!IsFull(generator))
+    {
+        for (numWords = 1 + Random(generator, 8); numWords != 0; --numWords)
+        {
+            PutWord(generator, 1, 8);
+            if (numWords != 1)
+            {
+                PutChar(generator, ' ');
+            }
+        }
+        Put(generator, "\r\n", 2);
+    }
+}
+
+typedef struct CorpusGenerator
+{
+    const char* name;
+    void (*generate)(Generator* generator);
+} CorpusGenerator;
+
+#define REGISTER_CORPUS(name, function) { name, function }
+
+static const CorpusGenerator generators[] = {
+    REGISTER_CORPUS("short-tokens", GenerateShortTokens),
+    REGISTER_CORPUS("long-tokens", GenerateLongTokens),
+    REGISTER_CORPUS("quoted", GenerateQuotedTokens),
+    REGISTER_CORPUS("escaped", GenerateEscapedTokens),
+    REGISTER_CORPUS("comments", GenerateComments),
+    REGISTER_CORPUS("long-lines", GenerateLongLines),
+    REGISTER_CORPUS("crlf", GenerateCrlfLines),
+    { NULL, NULL },
+};
+
+static void InitLexer()
+{
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetTokenViews(&lexer, options.tokenViews);
+    SimpleLexer_SetPositionTracking(&lexer, options.positionTracking);
+}
+
+/*
+ * Lex a corpus once, keeping copies of its tokens for the benchmarks that
+ * need them.  This returns zero on success and nonzero otherwise.
+ */
+static int PrepareCorpus(Corpus* corpus)
+{
+    SimpleToken token;
+    SimpleToken* tokens;
+    size_t capacity;
+    SimpleLexerError error;
+
+    SimpleTokenArena_Init(&corpus->arena, NULL, 0);
+    corpus->tokens = NULL;
+    corpus->numTokens = 0;
+    corpus->tokenBytes = 0;
+    capacity = 0;
+
+    InitLexer();
+    SimpleLexer_SetInput(&lexer, corpus->text, corpus->size);
+    for (;;)
+    {
+        token.text = NULL;
+        error = SimpleLexer_GetNextToken(&lexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            (void) SimpleLexer_Finish(&lexer, &token);
+        }
+        else if (error != SIMPLE_LEXER_OK)
+        {
+            (void) fprintf(stderr, "%s: lexing failed with error %d\n",
+                corpus->name, (int)error);
+            return 1;
+        }
+        if (token.text == NULL)
+        {
+            break;
+        }
+
+        if (corpus->numTokens == capacity)
+        {
+            capacity = capacity != 0 ? capacity * 2 : 1024;
+            tokens = realloc(corpus->tokens, capacity * sizeof(SimpleToken));
+            if (tokens == NULL)
+            {
+                return 1;
+            }
+            corpus->tokens = tokens;
+        }
+        if (SimpleTokenArena_Copy(&corpus->arena, &token,
+            &corpus->tokens[corpus->numTokens]))
+        {
+            return 1;
+        }
+        ++corpus->numTokens;
+        corpus->tokenBytes += token.length;
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            break;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Lex the whole corpus via SimpleLexer_GetNextToken() and
+ * SimpleLexer_Finish(), giving the lexer `chunkSize` bytes at a time
+ * (or the whole corpus at once if `chunkSize` is zero).
+ */
+static void BenchGetNextToken(
+    const Corpus* corpus,
+    size_t chunkSize,
+    BenchRun* run)
+{
+    SimpleToken token;
+    SimpleLexerError error;
+    size_t offset;
+    size_t size;
+    size_t numTokens;
+    size_t checksum;
+    double start;
+
+    numTokens = 0;
+    checksum = 0;
+    start = Now();
+    InitLexer();
+    for (offset = 0; offset < corpus->size; offset += size)
+    {
+        size = chunkSize != 0 && corpus->size - offset > chunkSize
+            ? chunkSize
+            : corpus->size - offset;
+        SimpleLexer_SetInput(&lexer, corpus->text + offset, size);
+        while ((error = SimpleLexer_GetNextToken(&lexer, &token))
+            == SIMPLE_LEXER_OK)
+        {
+            checksum += token.length;
+            ++numTokens;
+        }
+    }
+    if (SimpleLexer_Finish(&lexer, &token) == SIMPLE_LEXER_OK)
+    {
+        checksum += token.length;
+        ++numTokens;
+    }
+    run->seconds = Now() - start;
+    run->bytes = corpus->size;
+    run->tokens = numTokens;
+    sink += checksum;
+}
+
+static int CountToken(void* context, const SimpleToken* token)
+{
+    size_t* checksum = context;
+
+    *checksum += token->length;
+    return 0;
+}
+
+/*
+ * Like BenchGetNextToken(), but push the tokens to a handler via
+ * SimpleLexer_Feed().  The tokens are always views.
+ */
+static void BenchFeed(
+    const Corpus* corpus,
+    size_t chunkSize,
+    BenchRun* run)
+{
+    SimpleToken token;
+    size_t offset;
+    size_t size;
+    size_t checksum;
+    double start;
+
+    checksum = 0;
+    start = Now();
+    InitLexer();
+    for (offset = 0; offset < corpus->size; offset += size)
+    {
+        size = chunkSize != 0 && corpus->size - offset > chunkSize
+            ? chunkSize
+            : corpus->size - offset;
+        (void) SimpleLexer_Feed(&lexer, corpus->text + offset, size,
+            CountToken, &checksum);
+    }
+    if (SimpleLexer_Finish(&lexer, &token) == SIMPLE_LEXER_OK)
+    {
+        checksum += token.length;
+    }
+    run->seconds = Now() - start;
+    run->bytes = corpus->size;
+    run->tokens = corpus->numTokens;
+    sink += checksum;
+}
+
+/*
+ * Lex each line of the corpus as a stream of its own, so that a large part
+ * of the work is finishing streams via SimpleLexer_Finish().
+ */
+static void BenchFinish(
+    const Corpus* corpus,
+    size_t chunkSize,
+    BenchRun* run)
+{
+    SimpleToken token;
+    const char* line;
+    const char* end;
+    const char* newline;
+    size_t numTokens;
+    size_t checksum;
+    double start;
+
+    (void) chunkSize;
+    numTokens = 0;
+    checksum = 0;
+    start = Now();
+    end = corpus->text + corpus->size;
+    for (line = corpus->text; line < end; line = newline + 1)
+    {
+        newline = memchr(line, '\n', (size_t)(end - line));
+        if (newline == NULL)
+        {
+            newline = end;
+        }
+        InitLexer();
+        SimpleLexer_SetInput(&lexer, line, (size_t)(newline - line));
+        while (SimpleLexer_GetNextToken(&lexer, &token) == SIMPLE_LEXER_OK)
+        {
+            checksum += token.length;
+            ++numTokens;
+        }
+        token.text = NULL;
+        (void) SimpleLexer_Finish(&lexer, &token);
+        if (token.text != NULL)
+        {
+            checksum += token.length;
+            ++numTokens;
+        }
+    }
+    run->seconds = Now() - start;
+    run->bytes = corpus->size;
+    run->tokens = numTokens;
+    sink += checksum;
+}
+
+/*
+ * Duplicate and free each of the corpus's tokens via SimpleToken_Duplicate()
+ * and SimpleToken_Free().
+ */
+static void BenchDuplicate(
+    const Corpus* corpus,
+    size_t chunkSize,
+    BenchRun* run)
+{
+    SimpleToken* duplicate;
+    size_t index;
+    size_t checksum;
+    double start;
+
+    (void) chunkSize;
+    checksum = 0;
+    start = Now();
+    for (index = 0; index < corpus->numTokens; ++index)
+    {
+        duplicate = SimpleToken_Duplicate(&corpus->tokens[index]);
+        if (duplicate != NULL)
+        {
+            checksum += duplicate->length;
+            SimpleToken_Free(duplicate);
+        }
+    }
+    run->seconds = Now() - start;
+    run->bytes = corpus->tokenBytes;
+    run->tokens = corpus->numTokens;
+    sink += checksum;
+}
+
+typedef struct Benchmark
+{
+    const char* name;
+    BenchFunction function;
+    size_t chunkSize;           /* zero means the whole corpus at once */
+} Benchmark;
+
+#define REGISTER_BENCHMARK(name, function, chunkSize) \
+    { name, function, chunkSize }
+
+static const Benchmark benchmarks[] = {
+    REGISTER_BENCHMARK("GetNextToken", BenchGetNextToken, 0),
+    REGISTER_BENCHMARK("GetNextToken/4KiB", BenchGetNextToken, 4096),
+    REGISTER_BENCHMARK("GetNextToken/64B", BenchGetNextToken, 64),
+    REGISTER_BENCHMARK("Feed", BenchFeed, 0),
+    REGISTER_BENCHMARK("Feed/4KiB", BenchFeed, 4096),
+    REGISTER_BENCHMARK("Finish/line", BenchFinish, 0),
+    REGISTER_BENCHMARK("Duplicate", BenchDuplicate, 0),
+    { NULL, NULL, 0 },
+};
+
+static int CompareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Run a benchmark on a corpus repeatedly and print the median run's
+ * throughput and the runs' median absolute deviation from it.
+ */
+static int RunBenchmark(const Benchmark* benchmark, const Corpus* corpus)
+{
+    BenchRun run;
+    double* seconds;
+    double* deviations;
+    double median;
+    double deviation;
+    size_t index;
+    size_t count;
+
+    count = options.numRepetitions;
+    seconds = malloc(2 * count * sizeof(double));
+    if (seconds == NULL)
+    {
+        return 1;
+    }
+    deviations = seconds + count;
+
+    for (index = 0; index < options.numWarmups; ++index)
+    {
+        benchmark->function(corpus, benchmark->chunkSize, &run);
+    }
+    for (index = 0; index < count; ++index)
+    {
+        benchmark->function(corpus, benchmark->chunkSize, &run);
+        seconds[index] = run.seconds;
+    }
+
+    qsort(seconds, count, sizeof(double), CompareDoubles);
+    median = count % 2 != 0
+        ? seconds[count / 2]
+        : (seconds[count / 2 - 1] + seconds[count / 2]) / 2;
+    for (index = 0; index < count; ++index)
+    {
+        deviations[index] = seconds[index] > median
+            ? seconds[index] - median
+            : median - seconds[index];
+    }
+    qsort(deviations, count, sizeof(double), CompareDoubles);
+    deviation = deviations[count / 2];
+
+    if (median <= 0)
+    {
+        median = 1e-9;
+    }
+    (void) printf("%-16s %-18s %10.1f %14.0f %10.2f %7.1f%%\n",
+        corpus->name, benchmark->name,
+        (double)run.bytes / median / 1e6,
+        (double)run.tokens / median,
+        run.tokens != 0 ? median * 1e9 / (double)run.tokens : 0.0,
+        100 * deviation / median);
+    (void) fflush(stdout);
+
+    free(seconds);
+    return 0;
+}
+
+static int RunCorpus(Corpus* corpus)
+{
+    const Benchmark* benchmark;
+    int failed;
+
+    failed = PrepareCorpus(corpus);
+    for (benchmark = benchmarks; !failed && benchmark->name != NULL;
+        ++benchmark)
+    {
+        failed = RunBenchmark(benchmark, corpus);
+    }
+
+    SimpleTokenArena_Destroy(&corpus->arena);
+    free(corpus->tokens);
+    return failed;
+}
+
+static void PrintUsage(const char* program)
+{
+    (void) fprintf(stderr,
+        "usage: %s [-s MiB] [-w warmups] [-r repetitions] [-f filter] [-v]"
+        " [-p lines|offsets|nothing] [file ...]\n"
+        "  -s  size of each synthetic corpus in MiB (default 16)\n"
+        "  -w  untimed runs before each benchmark (default 1)\n"
+        "  -r  timed runs of each benchmark (default 7)\n"
+        "  -f  only run corpora whose names contain filter\n"
+        "  -v  let the lexer return token views\n"
+        "  -p  what positions the lexer tracks (default lines)\n"
+        "Files are benchmarked instead of the synthetic corpora.\n",
+        program);
+}
+
+int main(int argc, char **argv)
+{
+    const CorpusGenerator* corpusGenerator;
+    Generator generator;
+    Corpus corpus;
+    SimpleMappedFile file;
+    int option;
+    int failed;
+
+    options.corpusSize = 16 * 1024 * 1024;
+    options.numWarmups = 1;
+    options.numRepetitions = 7;
+    options.filter = NULL;
+    options.tokenViews = 0;
+    options.positionTracking = SIMPLE_LEXER_TRACK_LINES;
+    while ((option = getopt(argc, argv, "s:w:r:f:vp:h")) != -1)
+    {
+        switch (option)
+        {
+            case 's':
+                options.corpusSize = strtoul(optarg, NULL, 10) * 1024 * 1024;
+                break;
+            case 'w':
+                options.numWarmups = strtoul(optarg, NULL, 10);
+                break;
+            case 'r':
+                options.numRepetitions = strtoul(optarg, NULL, 10);
+                break;
+            case 'f':
+                options.filter = optarg;
+                break;
+            case 'v':
+                options.tokenViews = 1;
+                break;
+            case 'p':
+                if (strcmp(optarg, "lines") == 0)
+                {
+                    options.positionTracking = SIMPLE_LEXER_TRACK_LINES;
+                }
+                else if (strcmp(optarg, "offsets") == 0)
+                {
+                    options.positionTracking = SIMPLE_LEXER_TRACK_OFFSETS;
+                }
+                else if (strcmp(optarg, "nothing") == 0)
+                {
+                    options.positionTracking = SIMPLE_LEXER_TRACK_NOTHING;
+                }
+                else
+                {
+                    PrintUsage(argv[0]);
+                    return 2;
+                }
+                break;
+            default:
+                PrintUsage(argv[0]);
+                return 2;
+        }
+    }
+    if (options.corpusSize == 0 || options.numRepetitions == 0)
+    {
+        PrintUsage(argv[0]);
+        return 2;
+    }
+
+    SimpleLexer_Init(&lexer, lexerBuffer, sizeof(lexerBuffer));
+
+    (void) printf("%-16s %-18s %10s %14s %10s %8s\n", "corpus", "benchmark",
+        "MB/s", "tokens/s", "ns/token", "MAD");
+
+    failed = 0;
+    if (optind == argc)
+    {
+        generator.text = malloc(options.corpusSize);
+        if (generator.text == NULL)
+        {
+            (void) fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        generator.size = options.corpusSize;
+        for (corpusGenerator = generators; corpusGenerator->name != NULL;
+            ++corpusGenerator)
+        {
+            if (options.filter != NULL
+                && strstr(corpusGenerator->name, options.filter) == NULL)
+            {
+                continue;
+            }
+            generator.length = 0;
+            generator.seed = 1;
+            corpusGenerator->generate(&generator);
+
+            corpus.name = corpusGenerator->name;
+            corpus.text = generator.text;
+            corpus.size = generator.size;
+            failed |= RunCorpus(&corpus);
+        }
+        free(generator.text);
+    }
+
+    for (; optind < argc; ++optind)
+    {
+        if (options.filter != NULL
+            && strstr(argv[optind], options.filter) == NULL)
+        {
+            continue;
+        }
+        if (SimpleLexer_OpenMapped(&file, argv[optind]) != 0)
+        {
+            perror(argv[optind]);
+            failed = 1;
+            continue;
+        }
+        corpus.name = argv[optind];
+        corpus.text = file.data;
+        corpus.size = file.size;
+        failed |= RunCorpus(&corpus);
+        SimpleLexer_CloseMapped(&file);
+    }
+
+    return failed;
+}
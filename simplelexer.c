@@ -25,13 +25,105 @@
  */
 
 #include "simplelexer.h"
+#include "simplelexer.internal.h"
 
 #include <assert.h>
-#include <ctype.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * Define SIMPLELEXER_NO_SIMD to force the portable scalar delimiter scanner.
+ * Otherwise SSE2 is used wherever the compiler targets it and AVX2 is picked
+ * at runtime on GCC-compatible x86 compilers.
+ */
+#if !defined(SIMPLELEXER_NO_SIMD) \
+    && (defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SIMPLELEXER_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMPLELEXER_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+/*
+ * Define SIMPLELEXER_STATS to make lexers count what they do
+ * (see SimpleLexerStats).  Otherwise counting compiles to nothing.
+ */
+#ifdef SIMPLELEXER_STATS
+#define SIMPLE_LEXER_COUNT(lexer, counter, amount) \
+    ((void) ((lexer)->stats.counter += (amount)))
+#else
+#define SIMPLE_LEXER_COUNT(lexer, counter, amount) ((void) 0)
+#endif
+
+/*
+ * Define SIMPLELEXER_USDT to compile in USDT probes (static tracepoints),
+ * which tools such as perf and bpftrace can attach to in running processes.
+ * They require <sys/sdt.h> (SystemTap's headers) and cost a no-op instruction
+ * each when nothing is attached.  The provider is "simplelexer", and every
+ * probe's first three arguments are a stream offset, a length, and
+ * the lexer's state:
+ *
+ *    input(offset, length, state): SimpleLexer_SetInput() was given `length`
+ *       bytes that start at `offset` in the stream.
+ *    token(offset, length, state): A token that is `length` bytes long ended
+ *       before `offset`.  `state` tells quoted tokens apart.
+ *    error(offset, length, state, error): Lexing failed with `error` at
+ *       `offset` after `length` bytes of the current token.
+ *    finish(offset, length, state, error): SimpleLexer_Finish() returned
+ *       `error` and a final token `length` bytes long (or zero).
+ */
+#ifdef SIMPLELEXER_USDT
+#include <sys/sdt.h>
+#define SIMPLE_LEXER_PROBE3(name, offset, length, state) \
+    DTRACE_PROBE3(simplelexer, name, (size_t)(offset), (size_t)(length), \
+        (int)(state))
+#define SIMPLE_LEXER_PROBE4(name, offset, length, state, error) \
+    DTRACE_PROBE4(simplelexer, name, (size_t)(offset), (size_t)(length), \
+        (int)(state), (int)(error))
+#else
+#define SIMPLE_LEXER_PROBE3(name, offset, length, state) ((void) 0)
+#define SIMPLE_LEXER_PROBE4(name, offset, length, state, error) ((void) 0)
+#endif
+
+static void* SimpleLexer_StandardAllocate(void* context, size_t size)
+{
+    (void) context;
+    return malloc(size);
+}
+
+static void* SimpleLexer_StandardReallocate(
+    void* context,
+    void* block,
+    size_t oldSize,
+    size_t newSize)
+{
+    (void) context;
+    (void) oldSize;
+    return realloc(block, newSize);
+}
+
+static void SimpleLexer_StandardDeallocate(
+    void* context,
+    void* block,
+    size_t size)
+{
+    (void) context;
+    (void) size;
+    free(block);
+}
+
+const SimpleLexerAllocator SimpleLexer_StandardAllocator = {
+    SimpleLexer_StandardAllocate,
+    SimpleLexer_StandardReallocate,
+    SimpleLexer_StandardDeallocate,
+    NULL
+};
+
 void SimpleLexer_Init(
     SimpleLexer* restrict lexer,
     char* restrict tokenBuffer,
@@ -41,40 +133,366 @@ void SimpleLexer_Init(
     assert(tokenBuffer != NULL);
     assert(tokenBufferSize != 0);
 
-    lexer->currentPosition.line = 1;
-    lexer->currentPosition.column = 1;
+    lexer->tokenViews = 0;
+    lexer->fragments = 0;
+    lexer->positionTracking = SIMPLE_LEXER_TRACK_LINES;
+    lexer->symbols = NULL;
+    lexer->keywords = NULL;
+    lexer->dialect = &SimpleLexer_DefaultDialect;
+    lexer->quote = '"';
+    lexer->utf8 = 0;
+    lexer->columns = SIMPLE_LEXER_COLUMN_BYTES;
+    lexer->tabWidth = 0;
+
+    lexer->buffer = tokenBuffer;
+    lexer->bufferCapacity = tokenBufferSize;
+    lexer->maxBufferCapacity = tokenBufferSize;
+    lexer->ownsBuffer = 0;
+
+#ifdef SIMPLELEXER_STATS
+    /* SimpleLexer_Reset() adds the previous stream's bytes to the counters. */
+    lexer->inputOffset = 0;
+    lexer->inputIndex = 0;
+    (void) memset(&lexer->stats, 0, sizeof(lexer->stats));
+#endif
+
+    SimpleLexer_Reset(lexer);
+}
+
+int SimpleLexer_InitGrowable(
+    SimpleLexer* restrict lexer,
+    const SimpleLexerAllocator* restrict allocator,
+    size_t initialBufferSize,
+    size_t maxBufferSize)
+{
+    char* buffer;
+
+    assert(lexer != NULL);
+    assert(initialBufferSize != 0);
+    assert(initialBufferSize <= maxBufferSize);
+
+    if (allocator == NULL)
+    {
+        allocator = &SimpleLexer_StandardAllocator;
+    }
+
+    buffer = allocator->allocate(allocator->context, initialBufferSize);
+    if (buffer == NULL)
+    {
+        return 1;
+    }
+
+    SimpleLexer_Init(lexer, buffer, initialBufferSize);
+    lexer->allocator = *allocator;
+    lexer->maxBufferCapacity = maxBufferSize;
+    lexer->ownsBuffer = 1;
+    return 0;
+}
+
+void SimpleLexer_Reset(SimpleLexer* lexer)
+{
+    assert(lexer != NULL);
+    assert(lexer->buffer != NULL);
+
+#ifdef SIMPLELEXER_STATS
+    lexer->stats.numBytes += lexer->inputOffset + lexer->inputIndex;
+    lexer->tokenSpansInputs = 0;
+#endif
+
+    /* Lexers that don't track lines leave lines and columns zero. */
+    lexer->currentPosition.line =
+        lexer->positionTracking == SIMPLE_LEXER_TRACK_LINES;
+    lexer->currentPosition.column = lexer->currentPosition.line;
+    lexer->currentPosition.offset = 0;
     lexer->numColumnsInPreviousLine = 0;
-    lexer->tokenStart.line = 1;
-    lexer->tokenStart.column = 1;
+    lexer->tokenStart = lexer->currentPosition;
 
-    lexer->escaping = 0;
-    lexer->inToken = 0;
-    lexer->inComment = 0;
-    lexer->tokenIsQuoted = 0;
+    lexer->state = SIMPLE_LEXER_STATE_NORMAL;
     lexer->startedEscaped = 0;
+    lexer->tokenEscaped = 0;
     lexer->finished = 0;
+    lexer->tokenIsView = 0;
+    lexer->tokenFragmented = 0;
 
-    lexer->buffer = tokenBuffer;
     lexer->bufferLength = 0;
-    lexer->bufferCapacity = tokenBufferSize;
 
     lexer->input = NULL;
     lexer->inputSize = 0;
     lexer->inputIndex = 0;
+    lexer->inputOffset = 0;
+    lexer->tokenInputIndex = 0;
+
+    lexer->utf8Needed = 0;
+    lexer->utf8Seen = 0;
+    lexer->numUtf8Held = 0;
+    lexer->utf8InputSize = 0;
+    lexer->columnBytesNeeded = 0;
+}
+
+void SimpleLexer_Destroy(SimpleLexer* lexer)
+{
+    assert(lexer != NULL);
+
+    if (lexer->ownsBuffer)
+    {
+        lexer->allocator.deallocate(lexer->allocator.context, lexer->buffer,
+            lexer->bufferCapacity);
+        lexer->buffer = NULL;
+        lexer->bufferCapacity = 0;
+        lexer->ownsBuffer = 0;
+    }
+}
+
+void SimpleLexer_SetTokenViews(SimpleLexer* lexer, int enabled)
+{
+    assert(lexer != NULL);
+
+    lexer->tokenViews = enabled != 0;
 }
 
-static int SimpleLexer_AppendToBuffer(SimpleLexer* lexer, char c)
+void SimpleLexer_SetFragments(SimpleLexer* lexer, int enabled)
 {
+    assert(lexer != NULL);
+
+    lexer->fragments = enabled != 0;
+}
+
+void SimpleLexer_SetUtf8(SimpleLexer* lexer, int enabled)
+{
+    assert(lexer != NULL);
+    assert(lexer->input == NULL);
+
+    lexer->utf8 = enabled != 0;
+}
+
+void SimpleLexer_SetColumns(
+    SimpleLexer* lexer,
+    SimpleLexerColumns columns,
+    size_t tabWidth)
+{
+    assert(lexer != NULL);
+    assert(lexer->currentPosition.offset == 0);
+
+    lexer->columns = columns;
+    lexer->tabWidth = tabWidth;
+}
+
+void SimpleLexer_SetSymbolTable(
+    SimpleLexer* restrict lexer,
+    SimpleSymbolTable* restrict symbols)
+{
+    assert(lexer != NULL);
+
+    lexer->symbols = symbols;
+}
+
+void SimpleLexer_SetKeywords(
+    SimpleLexer* restrict lexer,
+    const SimpleKeywordSet* restrict keywords)
+{
+    assert(lexer != NULL);
+
+    lexer->keywords = keywords;
+}
+
+void SimpleLexer_SetPositionTracking(
+    SimpleLexer* lexer,
+    SimpleLexerPositionTracking tracking)
+{
+    assert(lexer != NULL);
+    assert(lexer->currentPosition.offset == 0);
+
+    lexer->positionTracking = tracking;
+    lexer->currentPosition.line = tracking == SIMPLE_LEXER_TRACK_LINES;
+    lexer->currentPosition.column = lexer->currentPosition.line;
+    lexer->tokenStart = lexer->currentPosition;
+}
+
+void SimpleLexer_ComputeLineAndColumn(
+    const char* restrict text,
+    size_t textSize,
+    TextPosition* restrict position)
+{
+    const char* end;
+    const char* lineStart;
+    const char* newline;
+    size_t line;
+
+    assert(text != NULL || textSize == 0);
+    assert(position != NULL);
+
+    end = text + (position->offset < textSize ? position->offset : textSize);
+    line = 1;
+    lineStart = text;
+    while ((newline = memchr(lineStart, '\n', (size_t)(end - lineStart)))
+        != NULL)
+    {
+        ++line;
+        lineStart = newline + 1;
+    }
+
+    position->line = line;
+    position->column = position->offset - (size_t)(lineStart - text) + 1;
+}
+
+/*
+ * Grow a growable lexer's token buffer geometrically so that it holds at least
+ * `minCapacity` bytes if its maximum size permits and as much as it permits
+ * otherwise.  The current token's text is preserved.
+ */
+static SimpleLexerError SimpleLexer_GrowBuffer(
+    SimpleLexer* lexer,
+    size_t minCapacity)
+{
+    size_t newCapacity;
+    char* newBuffer;
+
+    assert(lexer != NULL);
+    assert(lexer->ownsBuffer);
+    assert(lexer->bufferCapacity < lexer->maxBufferCapacity);
+
+    newCapacity = lexer->bufferCapacity;
+    while (newCapacity < minCapacity
+        && newCapacity < lexer->maxBufferCapacity)
+    {
+        newCapacity = newCapacity <= lexer->maxBufferCapacity / 2
+            ? newCapacity * 2
+            : lexer->maxBufferCapacity;
+    }
+
+    newBuffer = lexer->allocator.reallocate(lexer->allocator.context,
+        lexer->buffer, lexer->bufferCapacity, newCapacity);
+    if (newBuffer == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+
+    lexer->buffer = newBuffer;
+    lexer->bufferCapacity = newCapacity;
+    return SIMPLE_LEXER_OK;
+}
+
+static SimpleLexerError SimpleLexer_AppendToBuffer(SimpleLexer* lexer, char c)
+{
+    SimpleLexerError error;
+
     assert(lexer != NULL);
     assert(lexer->buffer != NULL);
 
-    if (lexer->bufferLength < lexer->bufferCapacity - 1)
+    if (lexer->bufferLength >= lexer->bufferCapacity - 1)
     {
-        lexer->buffer[lexer->bufferLength] = c;
-        ++lexer->bufferLength;
-        return 0;
+        if (lexer->bufferCapacity == lexer->maxBufferCapacity)
+        {
+            return SIMPLE_LEXER_TOKEN_TOO_LARGE;
+        }
+        error = SimpleLexer_GrowBuffer(lexer, lexer->bufferLength + 2);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+    }
+
+    lexer->buffer[lexer->bufferLength] = c;
+    ++lexer->bufferLength;
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Append an unescaped input character to the current token.  This is a no-op
+ * if the token is a view because the character is already in the input.
+ */
+static inline SimpleLexerError SimpleLexer_AppendInputChar(
+    SimpleLexer* lexer,
+    char c)
+{
+    return lexer->tokenIsView
+        ? SIMPLE_LEXER_OK
+        : SimpleLexer_AppendToBuffer(lexer, c);
+}
+
+/*
+ * Copy the current token's text from the lexer's input into its token buffer
+ * so that the token no longer refers to the input.  If the text doesn't fit,
+ * this returns an error and leaves the token a view.
+ */
+static SimpleLexerError SimpleLexer_MaterializeView(SimpleLexer* lexer)
+{
+    size_t length;
+    SimpleLexerError error;
+
+    assert(lexer != NULL);
+    assert(lexer->tokenIsView);
+    assert(lexer->bufferLength == 0);
+
+    length = lexer->inputIndex - lexer->tokenInputIndex;
+    if (length >= lexer->bufferCapacity)
+    {
+        if (lexer->bufferCapacity == lexer->maxBufferCapacity)
+        {
+            return SIMPLE_LEXER_TOKEN_TOO_LARGE;
+        }
+        error = SimpleLexer_GrowBuffer(lexer, length + 1);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+        if (length >= lexer->bufferCapacity)
+        {
+            return SIMPLE_LEXER_TOKEN_TOO_LARGE;
+        }
+    }
+
+    (void) memcpy(lexer->buffer, lexer->input + lexer->tokenInputIndex,
+        length);
+    lexer->bufferLength = length;
+    lexer->tokenIsView = 0;
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Append the next `run` bytes of the lexer's input, none of which
+ * are special, to the lexer's token buffer and consume them.
+ * If only some of them fit, consume those and return an error.
+ */
+static SimpleLexerError SimpleLexer_AppendRunToBuffer(
+    SimpleLexer* lexer,
+    size_t run)
+{
+    size_t room;
+    SimpleLexerError error;
+
+    assert(lexer != NULL);
+    assert(lexer->buffer != NULL);
+    assert(lexer->inputIndex + run <= lexer->inputSize);
+
+    if (lexer->tokenIsView)
+    {
+        lexer->inputIndex += run;
+        return SIMPLE_LEXER_OK;
     }
-    return 1;
+
+    error = SIMPLE_LEXER_OK;
+    room = lexer->bufferCapacity - 1 - lexer->bufferLength;
+    if (run > room && lexer->bufferCapacity < lexer->maxBufferCapacity)
+    {
+        error = SimpleLexer_GrowBuffer(lexer, lexer->bufferLength + run + 1);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+        room = lexer->bufferCapacity - 1 - lexer->bufferLength;
+    }
+    if (run > room)
+    {
+        run = room;
+        error = SIMPLE_LEXER_TOKEN_TOO_LARGE;
+    }
+
+    (void) memcpy(lexer->buffer + lexer->bufferLength,
+        lexer->input + lexer->inputIndex, run);
+    lexer->bufferLength += run;
+    lexer->inputIndex += run;
+    return error;
 }
 
 static void SimpleLexer_StartToken(
@@ -84,56 +502,218 @@ static void SimpleLexer_StartToken(
 {
     assert(lexer != NULL);
     assert(lexer->buffer != NULL);
-    assert(lexer->inToken == 0);
-    assert(lexer->inComment == 0);
+    assert(lexer->state == SIMPLE_LEXER_STATE_NORMAL);
     assert(lexer->finished == 0);
 
     lexer->tokenStart = lexer->currentPosition;
-
-    lexer->inToken = 1;
-    lexer->tokenIsQuoted = quoted;
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+    {
+        lexer->tokenStart.offset = lexer->inputOffset + lexer->inputIndex;
+    }
     lexer->startedEscaped = startedEscaped;
+    lexer->tokenEscaped = startedEscaped;
+
+    /* Tokens that start with escapes can't be views, and quoted tokens'
+       text starts after their opening quotation marks. */
+    lexer->tokenIsView = lexer->tokenViews && !startedEscaped;
+    lexer->tokenInputIndex = lexer->inputIndex + (quoted ? 1 : 0);
+#ifdef SIMPLELEXER_STATS
+    lexer->tokenSpansInputs = 0;
+#endif
+}
+
+#ifdef SIMPLELEXER_STATS
+
+/*
+ * Return the SimpleLexerStats token length histogram bucket for `length`.
+ */
+static inline size_t SimpleLexerStats_Bucket(size_t length)
+{
+    size_t bucket;
+
+#if defined(__GNUC__)
+    bucket = length != 0
+        ? sizeof(unsigned long long) * CHAR_BIT
+            - (size_t)__builtin_clzll((unsigned long long)length)
+        : 0;
+#else
+    for (bucket = 0; length != 0; length >>= 1)
+    {
+        ++bucket;
+    }
+#endif
+    return bucket;
+}
+
+static void SimpleLexer_CountToken(
+    SimpleLexer* restrict lexer,
+    const SimpleToken* restrict token)
+{
+    if (token->quoted)
+    {
+        ++lexer->stats.numQuotedTokens;
+    }
+    else
+    {
+        ++lexer->stats.numUnquotedTokens;
+    }
+    lexer->stats.numStartedEscapedTokens += token->startedEscaped != 0;
+    lexer->stats.numSpanningTokens += lexer->tokenSpansInputs != 0;
+    ++lexer->stats.tokenLengths[SimpleLexerStats_Bucket(token->length)];
 }
 
-static void SimpleLexer_FinishToken(
+#endif  /* SIMPLELEXER_STATS */
+
+static inline void SimpleLexer_FinishToken(
     SimpleLexer* restrict lexer,
     SimpleToken* restrict outToken,
-    char recordCurrentPositionAsEnd)
+    char recordCurrentPositionAsEnd,
+    int trackLines)
 {
     assert(lexer != NULL);
     assert(lexer->buffer != NULL);
     assert(outToken != NULL);
 
-    lexer->buffer[lexer->bufferLength] = '\0';
-
-    outToken->text = lexer->buffer;
-    outToken->length = lexer->bufferLength;
+    if (lexer->tokenIsView)
+    {
+        outToken->text = (char*)(lexer->input + lexer->tokenInputIndex);
+        outToken->length = lexer->inputIndex - lexer->tokenInputIndex;
+        outToken->isView = 1;
+        lexer->tokenIsView = 0;
+    }
+    else
+    {
+        lexer->buffer[lexer->bufferLength] = '\0';
+        outToken->text = lexer->buffer;
+        outToken->length = lexer->bufferLength;
+        outToken->isView = 0;
+    }
     outToken->span.start = lexer->tokenStart;
-    outToken->quoted = lexer->tokenIsQuoted;
+    outToken->quoted = lexer->state == SIMPLE_LEXER_STATE_QUOTED
+        || lexer->state == SIMPLE_LEXER_STATE_ESCAPING_QUOTED;
     outToken->startedEscaped = lexer->startedEscaped;
+    outToken->firstFragment = !lexer->tokenFragmented;
+    outToken->lastFragment = 1;
 
     lexer->bufferLength = 0;
-    lexer->inToken = 0;
 
-    if (recordCurrentPositionAsEnd)
+    if (recordCurrentPositionAsEnd || !trackLines)
     {
         outToken->span.end = lexer->currentPosition;
     }
-    else if (lexer->currentPosition.column != 1)
+    else if (lexer->currentPosition.column != 1
+        || lexer->currentPosition.line == lexer->tokenStart.line)
     {
         outToken->span.end.line = lexer->currentPosition.line;
         outToken->span.end.column = lexer->currentPosition.column - 1;
+
+        /* Tokens of nothing but UTF-8 continuation bytes take no columns
+           if columns count code points. */
+        if (trackLines > 1
+            && lexer->currentPosition.line == lexer->tokenStart.line
+            && outToken->span.end.column < lexer->tokenStart.column)
+        {
+            outToken->span.end.column = lexer->tokenStart.column;
+        }
     }
-    else if (lexer->currentPosition.line > 1)
+    else
     {
+        /* The token ended in a newline (or in continuation bytes after
+           one, which is as close as columns can say). */
         outToken->span.end.line = lexer->currentPosition.line - 1;
         outToken->span.end.column = lexer->numColumnsInPreviousLine;
     }
+
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+    {
+        outToken->span.end.offset = lexer->inputOffset + lexer->inputIndex
+            - (recordCurrentPositionAsEnd ? 0 : 1);
+    }
+
+    /* Last fragments' text isn't their tokens' text. */
+    outToken->symbol = lexer->symbols != NULL && !lexer->tokenFragmented
+        ? SimpleSymbolTable_Intern(lexer->symbols, outToken->text,
+            outToken->length)
+        : SIMPLE_SYMBOL_NONE;
+    outToken->keyword = lexer->keywords != NULL && !outToken->quoted
+        && !lexer->tokenEscaped && !lexer->tokenFragmented
+        ? SimpleKeywordSet_Find(lexer->keywords, outToken->text,
+            outToken->length)
+        : SIMPLE_KEYWORD_NONE;
+    lexer->tokenFragmented = 0;
+
+#ifdef SIMPLELEXER_STATS
+    SimpleLexer_CountToken(lexer, outToken);
+#endif
+    SIMPLE_LEXER_PROBE3(token, lexer->inputOffset + lexer->inputIndex,
+        outToken->length, lexer->state);
+}
+
+/*
+ * Return the current token's text so far as a fragment (see
+ * SimpleLexer_SetFragments()) and empty the token buffer (or end the token's
+ * view) so that lexing can continue the token.  This returns
+ * SIMPLE_LEXER_TOKEN_TOO_LARGE instead if there's no text, which happens
+ * only if the buffer can't hold a single byte.
+ */
+static SimpleLexerError SimpleLexer_EmitFragment(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict outToken)
+{
+    assert(lexer != NULL);
+    assert(lexer->fragments);
+    assert(outToken != NULL);
+
+    if (lexer->tokenIsView)
+    {
+        outToken->text = (char*)(lexer->input + lexer->tokenInputIndex);
+        outToken->length = lexer->inputIndex - lexer->tokenInputIndex;
+        outToken->isView = 1;
+        lexer->tokenIsView = 0;
+    }
+    else if (lexer->bufferLength != 0)
+    {
+        lexer->buffer[lexer->bufferLength] = '\0';
+        outToken->text = lexer->buffer;
+        outToken->length = lexer->bufferLength;
+        outToken->isView = 0;
+        lexer->bufferLength = 0;
+    }
     else
     {
-        outToken->span.end.line = 1;
-        outToken->span.end.column = 1;
+        return SIMPLE_LEXER_TOKEN_TOO_LARGE;
+    }
+    outToken->span.start = lexer->tokenStart;
+    outToken->span.end = lexer->currentPosition;
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+    {
+        outToken->span.end.offset = lexer->inputOffset + lexer->inputIndex
+            - lexer->numUtf8Held;
     }
+    outToken->quoted = lexer->state == SIMPLE_LEXER_STATE_QUOTED
+        || lexer->state == SIMPLE_LEXER_STATE_ESCAPING_QUOTED;
+    outToken->startedEscaped = lexer->startedEscaped;
+    outToken->firstFragment = !lexer->tokenFragmented;
+    outToken->lastFragment = 0;
+    outToken->symbol = SIMPLE_SYMBOL_NONE;
+    outToken->keyword = SIMPLE_KEYWORD_NONE;
+    lexer->tokenFragmented = 1;
+    SIMPLE_LEXER_COUNT(lexer, numFragments, 1);
+    return SIMPLE_LEXER_PARTIAL_TOKEN;
+}
+
+/*
+ * Turn a SIMPLE_LEXER_TOKEN_TOO_LARGE `error` into a fragment if the lexer
+ * is in fragment mode.
+ */
+static inline SimpleLexerError SimpleLexer_FragmentIfTooLarge(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict outToken,
+    SimpleLexerError error)
+{
+    return error == SIMPLE_LEXER_TOKEN_TOO_LARGE && lexer->fragments
+        ? SimpleLexer_EmitFragment(lexer, outToken)
+        : error;
 }
 
 int SimpleToken_Copy(
@@ -150,11 +730,17 @@ int SimpleToken_Copy(
         return 1;
     }
 
-    (void) memcpy(dest->text, source->text, source->length + 1);
+    (void) memcpy(dest->text, source->text, source->length);
+    dest->text[source->length] = '\0';
     dest->length = source->length;
     dest->span = source->span;
     dest->quoted = source->quoted;
     dest->startedEscaped = source->startedEscaped;
+    dest->isView = 0;
+    dest->firstFragment = source->firstFragment;
+    dest->lastFragment = source->lastFragment;
+    dest->symbol = source->symbol;
+    dest->keyword = source->keyword;
 
     return 0;
 }
@@ -195,231 +781,3656 @@ void SimpleToken_Free(SimpleToken* token)
     free(token);
 }
 
-static inline void SimpleLexer_AdvanceLine(SimpleLexer* lexer)
-{
-    ++lexer->currentPosition.line;
-    lexer->numColumnsInPreviousLine = lexer->currentPosition.column;
-    lexer->currentPosition.column = 1;
-}
+/*
+ * Arena blocks start with this header.  Their data follows it,
+ * rounded up to SIMPLE_TOKEN_ARENA_ALIGNMENT.
+ */
+struct SimpleTokenArenaBlock {
+    SimpleTokenArenaBlock* next;
+    size_t size;                /* the size of the block's data in bytes */
+};
 
-void SimpleLexer_SetInput(
-    SimpleLexer* restrict lexer,
-    const char* restrict text,
-    size_t textSize)
+typedef union SimpleTokenArena_MaxAlign {
+    long double d;
+    long long ll;
+    void* p;
+    void (*f)(void);
+} SimpleTokenArena_MaxAlign;
+
+typedef struct SimpleTokenArena_AlignmentProbe {
+    char c;
+    SimpleTokenArena_MaxAlign a;
+} SimpleTokenArena_AlignmentProbe;
+
+#define SIMPLE_TOKEN_ARENA_ALIGNMENT \
+    offsetof(SimpleTokenArena_AlignmentProbe, a)
+#define SIMPLE_TOKEN_ARENA_ALIGN(size) \
+    (((size) + SIMPLE_TOKEN_ARENA_ALIGNMENT - 1) \
+        & ~(SIMPLE_TOKEN_ARENA_ALIGNMENT - 1))
+#define SIMPLE_TOKEN_ARENA_HEADER_SIZE \
+    SIMPLE_TOKEN_ARENA_ALIGN(sizeof(SimpleTokenArenaBlock))
+#define SIMPLE_TOKEN_ARENA_DATA(block) \
+    ((char*)(block) + SIMPLE_TOKEN_ARENA_HEADER_SIZE)
+
+void SimpleTokenArena_Init(
+    SimpleTokenArena* restrict arena,
+    const SimpleLexerAllocator* restrict allocator,
+    size_t blockSize)
 {
-    assert(lexer != NULL);
-    assert(text != NULL);
+    assert(arena != NULL);
 
-    lexer->input = text;
-    lexer->inputSize = textSize;
-    lexer->inputIndex = 0;
+    arena->firstBlock = NULL;
+    arena->currentBlock = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+    arena->blockSize = blockSize != 0 ? blockSize : 64 * 1024;
+    arena->allocator = allocator != NULL
+        ? *allocator
+        : SimpleLexer_StandardAllocator;
 }
 
-SimpleLexerError SimpleLexer_GetNextToken(
-    SimpleLexer* restrict lexer,
+/*
+ * Make the current block one that has at least `size` free bytes,
+ * reusing the block after the current one if it's big enough.
+ */
+static int SimpleTokenArena_NextBlock(SimpleTokenArena* arena, size_t size)
+{
+    SimpleTokenArenaBlock* block;
+    size_t dataSize;
+
+    block = arena->currentBlock != NULL
+        ? arena->currentBlock->next
+        : arena->firstBlock;
+    if (block == NULL || block->size < size)
+    {
+        dataSize = size > arena->blockSize ? size : arena->blockSize;
+        if (dataSize > SIZE_MAX - SIMPLE_TOKEN_ARENA_HEADER_SIZE)
+        {
+            return 1;
+        }
+        block = arena->allocator.allocate(arena->allocator.context,
+            SIMPLE_TOKEN_ARENA_HEADER_SIZE + dataSize);
+        if (block == NULL)
+        {
+            return 1;
+        }
+        block->size = dataSize;
+
+        /* Link the new block in after the current one, ahead of any blocks
+           left over from before the last reset. */
+        if (arena->currentBlock != NULL)
+        {
+            block->next = arena->currentBlock->next;
+            arena->currentBlock->next = block;
+        }
+        else
+        {
+            block->next = arena->firstBlock;
+            arena->firstBlock = block;
+        }
+    }
+
+    arena->currentBlock = block;
+    arena->next = SIMPLE_TOKEN_ARENA_DATA(block);
+    arena->end = arena->next + block->size;
+    return 0;
+}
+
+void* SimpleTokenArena_Allocate(SimpleTokenArena* arena, size_t size)
+{
+    char* allocation;
+
+    assert(arena != NULL);
+
+    if (size > SIZE_MAX - (SIMPLE_TOKEN_ARENA_ALIGNMENT - 1))
+    {
+        return NULL;
+    }
+
+    /* Empty allocations take up space so that they get distinct non-NULL
+       pointers, even from empty arenas, whose next pointers are NULL. */
+    size = SIMPLE_TOKEN_ARENA_ALIGN(size != 0 ? size : 1);
+    if ((size_t)(arena->end - arena->next) < size
+        && SimpleTokenArena_NextBlock(arena, size))
+    {
+        return NULL;
+    }
+
+    allocation = arena->next;
+    arena->next += size;
+    return allocation;
+}
+
+int SimpleTokenArena_Copy(
+    SimpleTokenArena* restrict arena,
+    const SimpleToken* restrict source,
+    SimpleToken* restrict dest)
+{
+    char* text;
+
+    assert(arena != NULL);
+    assert(source != NULL);
+    assert(dest != NULL);
+    assert(source != dest);
+
+    text = SimpleTokenArena_Allocate(arena, source->length + 1);
+    if (text == NULL)
+    {
+        return 1;
+    }
+
+    *dest = *source;
+    (void) memcpy(text, source->text, source->length);
+    text[source->length] = '\0';
+    dest->text = text;
+    dest->isView = 0;
+    return 0;
+}
+
+SimpleToken* SimpleTokenArena_Duplicate(
+    SimpleTokenArena* restrict arena,
+    const SimpleToken* restrict source)
+{
+    return SimpleTokenArena_DuplicateMany(arena, source, 1);
+}
+
+SimpleToken* SimpleTokenArena_DuplicateMany(
+    SimpleTokenArena* restrict arena,
+    const SimpleToken* restrict sources,
+    size_t numTokens)
+{
+    SimpleToken* copies;
+    char* text;
+    size_t size;
+    size_t index;
+
+    assert(arena != NULL);
+    assert(sources != NULL || numTokens == 0);
+
+    if (numTokens > SIZE_MAX / sizeof(*copies))
+    {
+        return NULL;
+    }
+    size = numTokens * sizeof(*copies);
+    for (index = 0; index < numTokens; ++index)
+    {
+        if (sources[index].length >= SIZE_MAX - size)
+        {
+            return NULL;
+        }
+        size += sources[index].length + 1;
+    }
+
+    copies = SimpleTokenArena_Allocate(arena, size);
+    if (copies == NULL)
+    {
+        return NULL;
+    }
+
+    text = (char*)(copies + numTokens);
+    for (index = 0; index < numTokens; ++index)
+    {
+        copies[index] = sources[index];
+        (void) memcpy(text, sources[index].text, sources[index].length);
+        text[sources[index].length] = '\0';
+        copies[index].text = text;
+        copies[index].isView = 0;
+        text += sources[index].length + 1;
+    }
+    return copies;
+}
+
+void SimpleTokenArena_Reset(SimpleTokenArena* arena)
+{
+    assert(arena != NULL);
+
+    arena->currentBlock = NULL;
+    arena->next = NULL;
+    arena->end = NULL;
+}
+
+void SimpleTokenArena_Destroy(SimpleTokenArena* arena)
+{
+    SimpleTokenArenaBlock* block;
+    SimpleTokenArenaBlock* next;
+
+    assert(arena != NULL);
+
+    for (block = arena->firstBlock; block != NULL; block = next)
+    {
+        next = block->next;
+        arena->allocator.deallocate(arena->allocator.context, block,
+            SIMPLE_TOKEN_ARENA_HEADER_SIZE + block->size);
+    }
+    arena->firstBlock = NULL;
+    SimpleTokenArena_Reset(arena);
+}
+
+/*
+ * Double the capacity of an array (or give it `initialCapacity` elements
+ * if its capacity is zero).  This returns the resized array and updates
+ * `capacity`, or returns NULL if `allocator` failed.
+ */
+static void* SimpleLexer_GrowArray(
+    const SimpleLexerAllocator* restrict allocator,
+    void* array,
+    size_t* restrict capacity,
+    size_t elementSize,
+    size_t initialCapacity)
+{
+    size_t newCapacity;
+
+    if (*capacity == 0)
+    {
+        array = allocator->allocate(allocator->context,
+            initialCapacity * elementSize);
+        newCapacity = initialCapacity;
+    }
+    else
+    {
+        if (*capacity > SIZE_MAX / 2 / elementSize)
+        {
+            return NULL;
+        }
+        newCapacity = *capacity * 2;
+        array = allocator->reallocate(allocator->context, array,
+            *capacity * elementSize, newCapacity * elementSize);
+    }
+
+    if (array != NULL)
+    {
+        *capacity = newCapacity;
+    }
+    return array;
+}
+
+void SimpleSymbolTable_Init(
+    SimpleSymbolTable* restrict table,
+    const SimpleLexerAllocator* restrict allocator)
+{
+    assert(table != NULL);
+
+    table->slots = NULL;
+    table->numSlots = 0;
+    table->symbols = NULL;
+    table->numSymbols = 0;
+    table->symbolCapacity = 0;
+    table->allocator = allocator != NULL
+        ? *allocator
+        : SimpleLexer_StandardAllocator;
+    SimpleTokenArena_Init(&table->arena, &table->allocator, 0);
+}
+
+/*
+ * Hash `length` bytes of `text` eight bytes at a time.
+ */
+static inline uint64_t SimpleLexer_Hash(
+    const char* text,
+    size_t length,
+    uint64_t seed)
+{
+    uint64_t hash;
+    uint64_t word;
+
+    hash = seed ^ length;
+    for (; length >= 8; text += 8, length -= 8)
+    {
+        (void) memcpy(&word, text, 8);
+        hash = (hash ^ word) * UINT64_C(0xff51afd7ed558ccd);
+        hash ^= hash >> 32;
+    }
+    word = 0;
+    (void) memcpy(&word, text, length);
+    hash = (hash ^ word) * UINT64_C(0xc4ceb9fe1a85ec53);
+    hash ^= hash >> 29;
+    return hash;
+}
+
+static inline uint32_t SimpleSymbolTable_Hash(const char* text, size_t length)
+{
+    return (uint32_t)SimpleLexer_Hash(text, length,
+        UINT64_C(0x9e3779b97f4a7c15));
+}
+
+/*
+ * Return the index of the slot that holds the given string's symbol
+ * or, if the string isn't in the table, the empty slot where it belongs.
+ * The table must have at least one empty slot.
+ */
+static inline size_t SimpleSymbolTable_Probe(
+    const SimpleSymbolTable* restrict table,
+    const char* restrict text,
+    size_t length,
+    uint32_t hash)
+{
+    const SimpleSymbol* symbol;
+    size_t mask;
+    size_t slot;
+
+    mask = table->numSlots - 1;
+    for (slot = hash & mask; table->slots[slot] != SIMPLE_SYMBOL_NONE;
+        slot = (slot + 1) & mask)
+    {
+        symbol = &table->symbols[table->slots[slot] - 1];
+        if (symbol->hash == hash && symbol->length == length
+            && memcmp(symbol->text, text, length) == 0)
+        {
+            break;
+        }
+    }
+    return slot;
+}
+
+/*
+ * Double the number of slots in the table, keeping it at most half full.
+ */
+static int SimpleSymbolTable_Rehash(SimpleSymbolTable* table)
+{
+    uint32_t* slots;
+    size_t numSlots;
+    size_t mask;
+    size_t slot;
+    size_t index;
+
+    numSlots = table->numSlots != 0 ? table->numSlots * 2 : 64;
+    if (numSlots > SIZE_MAX / sizeof(*slots))
+    {
+        return 1;
+    }
+    slots = table->allocator.allocate(table->allocator.context,
+        numSlots * sizeof(*slots));
+    if (slots == NULL)
+    {
+        return 1;
+    }
+
+    (void) memset(slots, 0, numSlots * sizeof(*slots));
+    mask = numSlots - 1;
+    for (index = 0; index < table->numSymbols; ++index)
+    {
+        slot = table->symbols[index].hash & mask;
+        while (slots[slot] != SIMPLE_SYMBOL_NONE)
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = (uint32_t)(index + 1);
+    }
+
+    if (table->slots != NULL)
+    {
+        table->allocator.deallocate(table->allocator.context, table->slots,
+            table->numSlots * sizeof(*slots));
+    }
+    table->slots = slots;
+    table->numSlots = numSlots;
+    return 0;
+}
+
+uint32_t SimpleSymbolTable_Intern(
+    SimpleSymbolTable* restrict table,
+    const char* restrict text,
+    size_t length)
+{
+    SimpleSymbol* symbols;
+    SimpleSymbol* symbol;
+    char* copy;
+    uint32_t hash;
+    size_t slot;
+
+    assert(table != NULL);
+    assert(text != NULL || length == 0);
+
+    hash = SimpleSymbolTable_Hash(text, length);
+    slot = 0;
+    if (table->numSlots != 0)
+    {
+        slot = SimpleSymbolTable_Probe(table, text, length, hash);
+        if (table->slots[slot] != SIMPLE_SYMBOL_NONE)
+        {
+            return table->slots[slot];
+        }
+    }
+
+    /* Add the string, making room for it first. */
+    if (table->numSymbols == UINT32_MAX)
+    {
+        return SIMPLE_SYMBOL_NONE;
+    }
+    if ((table->numSymbols + 1) * 2 > table->numSlots)
+    {
+        if (SimpleSymbolTable_Rehash(table))
+        {
+            return SIMPLE_SYMBOL_NONE;
+        }
+        slot = SimpleSymbolTable_Probe(table, text, length, hash);
+    }
+    if (table->numSymbols == table->symbolCapacity)
+    {
+        symbols = SimpleLexer_GrowArray(&table->allocator, table->symbols,
+            &table->symbolCapacity, sizeof(*symbols), 32);
+        if (symbols == NULL)
+        {
+            return SIMPLE_SYMBOL_NONE;
+        }
+        table->symbols = symbols;
+    }
+    copy = SimpleTokenArena_Allocate(&table->arena, length + 1);
+    if (copy == NULL)
+    {
+        return SIMPLE_SYMBOL_NONE;
+    }
+
+    (void) memcpy(copy, text, length);
+    copy[length] = '\0';
+    symbol = &table->symbols[table->numSymbols];
+    symbol->text = copy;
+    symbol->length = length;
+    symbol->hash = hash;
+    table->slots[slot] = (uint32_t)++table->numSymbols;
+    return table->slots[slot];
+}
+
+uint32_t SimpleSymbolTable_Find(
+    const SimpleSymbolTable* restrict table,
+    const char* restrict text,
+    size_t length)
+{
+    assert(table != NULL);
+    assert(text != NULL || length == 0);
+
+    if (table->numSlots == 0)
+    {
+        return SIMPLE_SYMBOL_NONE;
+    }
+    return table->slots[SimpleSymbolTable_Probe(table, text, length,
+        SimpleSymbolTable_Hash(text, length))];
+}
+
+const char* SimpleSymbolTable_GetText(
+    const SimpleSymbolTable* restrict table,
+    uint32_t symbol,
+    size_t* restrict length)
+{
+    assert(table != NULL);
+    assert(symbol != SIMPLE_SYMBOL_NONE && symbol <= table->numSymbols);
+
+    if (length != NULL)
+    {
+        *length = table->symbols[symbol - 1].length;
+    }
+    return table->symbols[symbol - 1].text;
+}
+
+void SimpleSymbolTable_Destroy(SimpleSymbolTable* table)
+{
+    SimpleLexerAllocator allocator;
+
+    assert(table != NULL);
+
+    if (table->slots != NULL)
+    {
+        table->allocator.deallocate(table->allocator.context, table->slots,
+            table->numSlots * sizeof(*table->slots));
+    }
+    if (table->symbols != NULL)
+    {
+        table->allocator.deallocate(table->allocator.context, table->symbols,
+            table->symbolCapacity * sizeof(*table->symbols));
+    }
+    SimpleTokenArena_Destroy(&table->arena);
+    allocator = table->allocator;
+    SimpleSymbolTable_Init(table, &allocator);
+}
+
+/*
+ * Map `value` onto [0, `range`) by multiplication, which is cheaper than
+ * division.  `range` must be at most 2^32.
+ */
+static inline size_t SimpleKeywordSet_Reduce(uint32_t value, size_t range)
+{
+    return (size_t)(((uint64_t)value * range) >> 32);
+}
+
+static inline size_t SimpleKeywordSet_Bucket(
+    const SimpleKeywordSet* set,
+    uint64_t hash)
+{
+    return SimpleKeywordSet_Reduce((uint32_t)(hash >> 32), set->numBuckets);
+}
+
+/*
+ * Return the slot of a string with the given hash in a bucket
+ * with the given displacement.
+ */
+static inline size_t SimpleKeywordSet_Slot(
+    const SimpleKeywordSet* set,
+    uint64_t hash,
+    uint32_t displacement)
+{
+    hash ^= displacement * UINT64_C(0x9e3779b97f4a7c15);
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    return SimpleKeywordSet_Reduce((uint32_t)hash, set->numKeywords);
+}
+
+/*
+ * Try to place the keywords in the set's slots using the set's seed.
+ * `hashes`, `bucketKeywords`, and `bucketStarts` are scratch space for
+ * the keywords' hashes, the keywords' indexes sorted by bucket, and where
+ * each bucket's keywords start in `bucketKeywords`.  This returns zero
+ * on success, one if another seed might work, and two if the keywords
+ * contain duplicates.
+ */
+static int SimpleKeywordSet_Place(
+    SimpleKeywordSet* restrict set,
+    const char* const* restrict keywords,
+    const size_t* restrict lengths,
+    uint64_t* restrict hashes,
+    size_t* restrict bucketKeywords,
+    size_t* restrict bucketStarts)
+{
+    const size_t* members;
+    size_t maxDisplacement;
+    size_t bucketSize;
+    size_t maxBucketSize;
+    size_t bucket;
+    size_t index;
+    size_t other;
+    size_t slot;
+    uint32_t displacement;
+
+    /* Sort the keywords by bucket. */
+    (void) memset(bucketStarts, 0,
+        (set->numBuckets + 1) * sizeof(*bucketStarts));
+    for (index = 0; index < set->numKeywords; ++index)
+    {
+        hashes[index] = SimpleLexer_Hash(keywords[index], lengths[index],
+            set->seed);
+        ++bucketStarts[SimpleKeywordSet_Bucket(set, hashes[index]) + 1];
+    }
+    maxBucketSize = 0;
+    for (bucket = 1; bucket <= set->numBuckets; ++bucket)
+    {
+        if (bucketStarts[bucket] > maxBucketSize)
+        {
+            maxBucketSize = bucketStarts[bucket];
+        }
+        bucketStarts[bucket] += bucketStarts[bucket - 1];
+    }
+    for (index = 0; index < set->numKeywords; ++index)
+    {
+        bucketKeywords[bucketStarts[SimpleKeywordSet_Bucket(set,
+            hashes[index])]++] = index;
+    }
+    (void) memmove(bucketStarts + 1, bucketStarts,
+        set->numBuckets * sizeof(*bucketStarts));
+    bucketStarts[0] = 0;
+
+    for (slot = 0; slot < set->numKeywords; ++slot)
+    {
+        set->slots[slot].keyword = SIMPLE_KEYWORD_NONE;
+    }
+    (void) memset(set->displacements, 0,
+        set->numBuckets * sizeof(*set->displacements));
+
+    /* Displace the biggest buckets first, while most slots are free. */
+    maxDisplacement = set->numKeywords < (UINT32_MAX - 1024) / 64
+        ? 64 * set->numKeywords + 1024
+        : UINT32_MAX;
+    for (bucketSize = maxBucketSize; bucketSize != 0; --bucketSize)
+    {
+        for (bucket = 0; bucket < set->numBuckets; ++bucket)
+        {
+            if (bucketStarts[bucket + 1] - bucketStarts[bucket] != bucketSize)
+            {
+                continue;
+            }
+
+            members = bucketKeywords + bucketStarts[bucket];
+            for (displacement = 0; displacement < maxDisplacement;
+                ++displacement)
+            {
+                for (index = 0; index < bucketSize; ++index)
+                {
+                    slot = SimpleKeywordSet_Slot(set, hashes[members[index]],
+                        displacement);
+                    if (set->slots[slot].keyword != SIMPLE_KEYWORD_NONE)
+                    {
+                        break;
+                    }
+                    set->slots[slot].text = keywords[members[index]];
+                    set->slots[slot].length = lengths[members[index]];
+                    set->slots[slot].keyword = (int)members[index];
+                }
+                if (index == bucketSize)
+                {
+                    break;
+                }
+                while (index-- != 0)
+                {
+                    set->slots[SimpleKeywordSet_Slot(set,
+                        hashes[members[index]], displacement)].keyword =
+                        SIMPLE_KEYWORD_NONE;
+                }
+            }
+            if (displacement == maxDisplacement)
+            {
+                /* Keywords with the same hash can't be separated. */
+                for (index = 0; index < bucketSize; ++index)
+                {
+                    for (other = index + 1; other < bucketSize; ++other)
+                    {
+                        if (lengths[members[index]] == lengths[members[other]]
+                            && memcmp(keywords[members[index]],
+                                keywords[members[other]],
+                                lengths[members[index]]) == 0)
+                        {
+                            return 2;
+                        }
+                    }
+                }
+                return 1;
+            }
+            set->displacements[bucket] = displacement;
+        }
+    }
+    return 0;
+}
+
+int SimpleKeywordSet_Init(
+    SimpleKeywordSet* restrict set,
+    const SimpleLexerAllocator* restrict allocator,
+    const char* const* restrict keywords,
+    size_t numKeywords)
+{
+    char* scratch;
+    size_t* lengths;
+    size_t scratchSize;
+    size_t index;
+    unsigned attempt;
+    int result;
+
+    assert(set != NULL);
+    assert(keywords != NULL || numKeywords == 0);
+
+    set->slots = NULL;
+    set->displacements = NULL;
+    set->numKeywords = numKeywords;
+    set->numBuckets = numKeywords / 4 + 1;
+    set->seed = 0;
+    set->minLength = 1;
+    set->maxLength = 0;
+    set->allocator = allocator != NULL
+        ? *allocator
+        : SimpleLexer_StandardAllocator;
+    if (numKeywords == 0)
+    {
+        return 0;
+    }
+    if (numKeywords > INT_MAX || numKeywords > UINT32_MAX)
+    {
+        return 1;
+    }
+
+    /* The scratch space holds the keywords' hashes and lengths,
+       the keywords sorted by bucket, and the buckets' starts. */
+    scratchSize = numKeywords * (sizeof(uint64_t) + 2 * sizeof(size_t))
+        + (set->numBuckets + 1) * sizeof(size_t);
+    scratch = set->allocator.allocate(set->allocator.context, scratchSize);
+    set->slots = set->allocator.allocate(set->allocator.context,
+        numKeywords * sizeof(*set->slots));
+    set->displacements = set->allocator.allocate(set->allocator.context,
+        set->numBuckets * sizeof(*set->displacements));
+    result = scratch == NULL || set->slots == NULL
+        || set->displacements == NULL;
+
+    if (result == 0)
+    {
+        lengths = (size_t*)(scratch + numKeywords * sizeof(uint64_t));
+        set->minLength = SIZE_MAX;
+        for (index = 0; index < numKeywords; ++index)
+        {
+            lengths[index] = strlen(keywords[index]);
+            if (lengths[index] < set->minLength)
+            {
+                set->minLength = lengths[index];
+            }
+            if (lengths[index] > set->maxLength)
+            {
+                set->maxLength = lengths[index];
+            }
+        }
+
+        result = 1;
+        for (attempt = 1; attempt <= 64 && result == 1; ++attempt)
+        {
+            set->seed = attempt * UINT64_C(0x2545f4914f6cdd1d);
+            result = SimpleKeywordSet_Place(set, keywords, lengths,
+                (uint64_t*)scratch, lengths + numKeywords,
+                lengths + 2 * numKeywords);
+        }
+    }
+
+    if (scratch != NULL)
+    {
+        set->allocator.deallocate(set->allocator.context, scratch,
+            scratchSize);
+    }
+    if (result != 0)
+    {
+        SimpleKeywordSet_Destroy(set);
+    }
+    return result != 0;
+}
+
+int SimpleKeywordSet_Find(
+    const SimpleKeywordSet* restrict set,
+    const char* restrict text,
+    size_t length)
+{
+    const SimpleKeyword* slot;
+    uint64_t hash;
+
+    assert(set != NULL);
+    assert(text != NULL || length == 0);
+
+    /* This also rejects everything if there are no keywords. */
+    if (length < set->minLength || length > set->maxLength)
+    {
+        return SIMPLE_KEYWORD_NONE;
+    }
+
+    hash = SimpleLexer_Hash(text, length, set->seed);
+    slot = &set->slots[SimpleKeywordSet_Slot(set, hash,
+        set->displacements[SimpleKeywordSet_Bucket(set, hash)])];
+    return slot->length == length && memcmp(slot->text, text, length) == 0
+        ? slot->keyword
+        : SIMPLE_KEYWORD_NONE;
+}
+
+void SimpleKeywordSet_Destroy(SimpleKeywordSet* set)
+{
+    SimpleLexerAllocator allocator;
+
+    assert(set != NULL);
+
+    if (set->slots != NULL)
+    {
+        set->allocator.deallocate(set->allocator.context, set->slots,
+            set->numKeywords * sizeof(*set->slots));
+    }
+    if (set->displacements != NULL)
+    {
+        set->allocator.deallocate(set->allocator.context, set->displacements,
+            set->numBuckets * sizeof(*set->displacements));
+    }
+    allocator = set->allocator;
+    (void) SimpleKeywordSet_Init(set, &allocator, NULL, 0);
+}
+
+const SimpleLexerDialect SimpleLexer_DefaultDialect = {
+    {
+        ['\0'] = SIMPLE_LEXER_CLASS_SPACE,
+        ['\t'] = SIMPLE_LEXER_CLASS_SPACE,
+        ['\n'] = SIMPLE_LEXER_CLASS_NEWLINE,
+        ['\v'] = SIMPLE_LEXER_CLASS_SPACE,
+        ['\f'] = SIMPLE_LEXER_CLASS_SPACE,
+        ['\r'] = SIMPLE_LEXER_CLASS_SPACE,
+        [' '] = SIMPLE_LEXER_CLASS_SPACE,
+        ['"'] = SIMPLE_LEXER_CLASS_QUOTE,
+        ['\\'] = SIMPLE_LEXER_CLASS_BACKSLASH,
+        ['#'] = SIMPLE_LEXER_CLASS_HASH
+    },
+    {
+        ['a'] = '\a',
+        ['b'] = '\b',
+        ['f'] = '\f',
+        ['n'] = '\n',
+        ['r'] = '\r',
+        ['t'] = '\t',
+        ['v'] = '\v'
+    },
+    { '"', '\\', '#' },
+    { '"', '\\' },
+    3,
+    2
+};
+
+/*
+ * Give each byte in `bytes` the class `byteClass` in `dialect` and list it
+ * among the bytes that interrupt runs of unquoted token text and, if
+ * `quotedStop` is nonzero, quoted token text.  This returns nonzero if any
+ * of the bytes are special already.
+ */
+static int SimpleLexerDialect_Classify(
+    SimpleLexerDialect* restrict dialect,
+    const char* restrict bytes,
+    size_t numBytes,
+    unsigned char byteClass,
+    int quotedStop)
+{
+    size_t index;
+    unsigned char byte;
+
+    for (index = 0; index < numBytes; ++index)
+    {
+        byte = (unsigned char)bytes[index];
+        if (dialect->classes[byte] != SIMPLE_LEXER_CLASS_OTHER)
+        {
+            return 1;
+        }
+        dialect->classes[byte] = byteClass;
+
+        /* Counts past the maximum mean that there are too many stops. */
+        if (dialect->numUnquotedStops < SIMPLE_LEXER_DIALECT_MAX_STOPS)
+        {
+            dialect->unquotedStops[dialect->numUnquotedStops] = byte;
+        }
+        if (dialect->numUnquotedStops <= SIMPLE_LEXER_DIALECT_MAX_STOPS)
+        {
+            ++dialect->numUnquotedStops;
+        }
+        if (quotedStop)
+        {
+            if (dialect->numQuotedStops < SIMPLE_LEXER_DIALECT_MAX_STOPS)
+            {
+                dialect->quotedStops[dialect->numQuotedStops] = byte;
+            }
+            if (dialect->numQuotedStops <= SIMPLE_LEXER_DIALECT_MAX_STOPS)
+            {
+                ++dialect->numQuotedStops;
+            }
+        }
+    }
+    return 0;
+}
+
+int SimpleLexerDialect_Init(
+    SimpleLexerDialect* restrict dialect,
+    const char* restrict quotes,
+    const char* restrict comments,
+    const char* restrict delimiters,
+    int escape,
+    const char* restrict escapes)
+{
+    size_t index;
+    size_t numEscapes;
+    char escapeByte;
+
+    assert(dialect != NULL);
+    assert(escape >= -1 && escape <= UCHAR_MAX);
+
+    /* Start with whitespace alone: the default dialect's space and newline
+       classes are the same in every dialect. */
+    (void) memset(dialect, 0, sizeof(*dialect));
+    for (index = 0; index < 256; ++index)
+    {
+        if (SimpleLexer_DefaultDialect.classes[index]
+            == SIMPLE_LEXER_CLASS_SPACE
+            || SimpleLexer_DefaultDialect.classes[index]
+            == SIMPLE_LEXER_CLASS_NEWLINE)
+        {
+            dialect->classes[index] =
+                SimpleLexer_DefaultDialect.classes[index];
+        }
+    }
+
+    if (SimpleLexerDialect_Classify(dialect, quotes,
+            quotes != NULL ? strlen(quotes) : 0, SIMPLE_LEXER_CLASS_QUOTE, 1)
+        || SimpleLexerDialect_Classify(dialect, comments,
+            comments != NULL ? strlen(comments) : 0, SIMPLE_LEXER_CLASS_HASH,
+            0)
+        || SimpleLexerDialect_Classify(dialect, delimiters,
+            delimiters != NULL ? strlen(delimiters) : 0,
+            SIMPLE_LEXER_CLASS_SPACE, 0))
+    {
+        return 1;
+    }
+    if (escape != -1)
+    {
+        escapeByte = (char)escape;
+        if (SimpleLexerDialect_Classify(dialect, &escapeByte, 1,
+            SIMPLE_LEXER_CLASS_BACKSLASH, 1))
+        {
+            return 1;
+        }
+    }
+
+    if (escapes == NULL)
+    {
+        (void) memcpy(dialect->escapes, SimpleLexer_DefaultDialect.escapes,
+            sizeof(dialect->escapes));
+    }
+    else
+    {
+        numEscapes = strlen(escapes);
+        if (numEscapes % 2 != 0)
+        {
+            return 1;
+        }
+        for (index = 0; index < numEscapes; index += 2)
+        {
+            dialect->escapes[(unsigned char)escapes[index]] =
+                escapes[index + 1];
+        }
+    }
+    return 0;
+}
+
+void SimpleLexer_SetDialect(
+    SimpleLexer* restrict lexer,
+    const SimpleLexerDialect* restrict dialect)
+{
+    size_t index;
+
+    assert(lexer != NULL);
+    assert(lexer->currentPosition.offset == 0);
+
+    lexer->dialect = dialect != NULL ? dialect : &SimpleLexer_DefaultDialect;
+
+    /* Lexers put in the quoted state by hand expect the first quote. */
+    for (index = 0; index < 256; ++index)
+    {
+        if (lexer->dialect->classes[index] == SIMPLE_LEXER_CLASS_QUOTE)
+        {
+            lexer->quote = (char)index;
+            break;
+        }
+    }
+}
+
+#define SIMPLE_LEXER_TRANSITION(action, state) \
+    { SIMPLE_LEXER_##action, SIMPLE_LEXER_STATE_##state }
+
+const SimpleLexerTransition
+SimpleLexer_Transitions[SIMPLE_LEXER_NUMSTATES][SIMPLE_LEXER_NUMCLASSES] = {
+    [SIMPLE_LEXER_STATE_NORMAL] = {
+        [SIMPLE_LEXER_CLASS_OTHER] = SIMPLE_LEXER_TRANSITION(START, TOKEN),
+        [SIMPLE_LEXER_CLASS_SPACE] = SIMPLE_LEXER_TRANSITION(SKIP, NORMAL),
+        [SIMPLE_LEXER_CLASS_NEWLINE] = SIMPLE_LEXER_TRANSITION(SKIP, NORMAL),
+        [SIMPLE_LEXER_CLASS_QUOTE] =
+            SIMPLE_LEXER_TRANSITION(START_QUOTED, QUOTED),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] =
+            SIMPLE_LEXER_TRANSITION(START_ESCAPED, ESCAPING),
+        [SIMPLE_LEXER_CLASS_HASH] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT)
+    },
+    [SIMPLE_LEXER_STATE_TOKEN] = {
+        [SIMPLE_LEXER_CLASS_OTHER] = SIMPLE_LEXER_TRANSITION(APPEND, TOKEN),
+        [SIMPLE_LEXER_CLASS_SPACE] = SIMPLE_LEXER_TRANSITION(FINISH, NORMAL),
+        [SIMPLE_LEXER_CLASS_NEWLINE] = SIMPLE_LEXER_TRANSITION(FINISH, NORMAL),
+        [SIMPLE_LEXER_CLASS_QUOTE] =
+            SIMPLE_LEXER_TRANSITION(FINISH_BEFORE, NORMAL),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] =
+            SIMPLE_LEXER_TRANSITION(ESCAPE, ESCAPING),
+        [SIMPLE_LEXER_CLASS_HASH] = SIMPLE_LEXER_TRANSITION(FINISH, COMMENT)
+    },
+    [SIMPLE_LEXER_STATE_QUOTED] = {
+        [SIMPLE_LEXER_CLASS_OTHER] = SIMPLE_LEXER_TRANSITION(APPEND, QUOTED),
+        [SIMPLE_LEXER_CLASS_SPACE] = SIMPLE_LEXER_TRANSITION(APPEND, QUOTED),
+        [SIMPLE_LEXER_CLASS_NEWLINE] = SIMPLE_LEXER_TRANSITION(APPEND, QUOTED),
+        [SIMPLE_LEXER_CLASS_QUOTE] =
+            SIMPLE_LEXER_TRANSITION(FINISH_QUOTED, NORMAL),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] =
+            SIMPLE_LEXER_TRANSITION(ESCAPE, ESCAPING_QUOTED),
+        [SIMPLE_LEXER_CLASS_HASH] = SIMPLE_LEXER_TRANSITION(APPEND, QUOTED)
+    },
+    [SIMPLE_LEXER_STATE_COMMENT] = {
+        [SIMPLE_LEXER_CLASS_OTHER] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT),
+        [SIMPLE_LEXER_CLASS_SPACE] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT),
+        [SIMPLE_LEXER_CLASS_NEWLINE] = SIMPLE_LEXER_TRANSITION(SKIP, NORMAL),
+        [SIMPLE_LEXER_CLASS_QUOTE] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT),
+        [SIMPLE_LEXER_CLASS_HASH] = SIMPLE_LEXER_TRANSITION(SKIP, COMMENT)
+    },
+    [SIMPLE_LEXER_STATE_ESCAPING] = {
+        [SIMPLE_LEXER_CLASS_OTHER] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN),
+        [SIMPLE_LEXER_CLASS_SPACE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN),
+        [SIMPLE_LEXER_CLASS_NEWLINE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN),
+        [SIMPLE_LEXER_CLASS_QUOTE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN),
+        [SIMPLE_LEXER_CLASS_HASH] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, TOKEN)
+    },
+    [SIMPLE_LEXER_STATE_ESCAPING_QUOTED] = {
+        [SIMPLE_LEXER_CLASS_OTHER] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED),
+        [SIMPLE_LEXER_CLASS_SPACE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED),
+        [SIMPLE_LEXER_CLASS_NEWLINE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED),
+        [SIMPLE_LEXER_CLASS_QUOTE] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED),
+        [SIMPLE_LEXER_CLASS_BACKSLASH] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED),
+        [SIMPLE_LEXER_CLASS_HASH] =
+            SIMPLE_LEXER_TRANSITION(APPEND_ESCAPED, QUOTED)
+    }
+};
+
+/*
+ * These masks select the classes of bytes that interrupt runs of token text.
+ * Unquoted runs stop at anything special.  Quoted runs stop at quotes,
+ * escapes, and '\n' (newlines are part of quoted tokens but change
+ * the lexer's line).
+ */
+#define SIMPLE_LEXER_STOPS_UNQUOTED \
+    (~(1u << SIMPLE_LEXER_CLASS_OTHER))
+#define SIMPLE_LEXER_STOPS_QUOTED \
+    ((1u << SIMPLE_LEXER_CLASS_NEWLINE) | (1u << SIMPLE_LEXER_CLASS_QUOTE) \
+        | (1u << SIMPLE_LEXER_CLASS_BACKSLASH))
+
+/*
+ * Return nonzero if `c` can start a multi-byte UTF-8 whitespace character:
+ * U+0085 and U+00A0 start with 0xC2; U+1680 with 0xE1; U+2000 through
+ * U+205F with 0xE2; and U+3000 with 0xE3.
+ */
+static inline int SimpleLexer_IsUtf8SpaceLead(unsigned char c)
+{
+    return c == 0xC2 || (unsigned char)(c - 0xE1) <= 2;
+}
+
+static inline size_t SimpleLexer_ScanScalar(
+    const char* text,
+    size_t size,
+    const unsigned char* classes,
+    unsigned stops)
+{
+    size_t index;
+
+    for (index = 0; index < size; ++index)
+    {
+        if ((1u << classes[(unsigned char)text[index]]) & stops)
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+#ifdef SIMPLELEXER_SSE2
+
+static inline unsigned SimpleLexer_TrailingZeros(unsigned mask)
+{
+    unsigned count;
+
+    assert(mask != 0);
+#if defined(__GNUC__)
+    count = (unsigned)__builtin_ctz(mask);
+#else
+    for (count = 0; (mask & 1) == 0; mask >>= 1)
+    {
+        ++count;
+    }
+#endif
+    return count;
+}
+
+/*
+ * Select the whitespace (newlines included) and NUL bytes in `bytes`.
+ */
+static inline __m128i SimpleLexer_SpaceMask128(__m128i bytes)
+{
+    __m128i spaces;
+
+    /* '\t' through '\r' are contiguous: (byte - '\t') <= 4, unsigned. */
+    spaces = _mm_sub_epi8(bytes, _mm_set1_epi8('\t'));
+    spaces = _mm_cmpeq_epi8(_mm_min_epu8(spaces, _mm_set1_epi8(4)), spaces);
+    spaces = _mm_or_si128(spaces, _mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')));
+    return _mm_or_si128(spaces, _mm_cmpeq_epi8(bytes, _mm_setzero_si128()));
+}
+
+/*
+ * Select the bytes in `bytes` that can start multi-byte UTF-8 whitespace
+ * characters (see SimpleLexer_IsUtf8SpaceLead()).
+ */
+static inline __m128i SimpleLexer_Utf8SpaceLeadMask128(__m128i bytes)
+{
+    __m128i leads;
+
+    leads = _mm_sub_epi8(bytes, _mm_set1_epi8((char)0xE1));
+    leads = _mm_cmpeq_epi8(_mm_min_epu8(leads, _mm_set1_epi8(2)), leads);
+    return _mm_or_si128(leads,
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)0xC2)));
+}
+
+static inline __m128i SimpleLexer_StopMask128(__m128i bytes, int quoted)
+{
+    __m128i stops;
+
+    stops = _mm_or_si128(
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"')),
+        _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\\')));
+    if (quoted)
+    {
+        return _mm_or_si128(stops, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')));
+    }
+    stops = _mm_or_si128(stops, SimpleLexer_SpaceMask128(bytes));
+    return _mm_or_si128(stops, _mm_cmpeq_epi8(bytes, _mm_set1_epi8('#')));
+}
+
+static size_t SimpleLexer_ScanSse2(const char* text, size_t size, int quoted)
+{
+    size_t index;
+    unsigned mask;
+
+    for (index = 0; index + 16 <= size; index += 16)
+    {
+        mask = (unsigned)_mm_movemask_epi8(SimpleLexer_StopMask128(
+            _mm_loadu_si128((const __m128i*)(text + index)), quoted));
+        if (mask != 0)
+        {
+            return index + SimpleLexer_TrailingZeros(mask);
+        }
+    }
+    return index + SimpleLexer_ScanScalar(text + index, size - index,
+        SimpleLexer_DefaultDialect.classes,
+        quoted ? SIMPLE_LEXER_STOPS_QUOTED : SIMPLE_LEXER_STOPS_UNQUOTED);
+}
+
+/*
+ * This is SimpleLexer_ScanSse2() for dialects other than the default one,
+ * which list the bytes that interrupt runs of token text besides whitespace.
+ */
+static size_t SimpleLexer_ScanDialectSse2(
+    const char* text,
+    size_t size,
+    int quoted,
+    const SimpleLexerDialect* dialect)
+{
+    size_t index;
+    size_t stop;
+    size_t numStops;
+    const unsigned char* stopBytes;
+    __m128i bytes;
+    __m128i stops;
+    unsigned mask;
+
+    stopBytes = quoted ? dialect->quotedStops : dialect->unquotedStops;
+    numStops = quoted ? dialect->numQuotedStops : dialect->numUnquotedStops;
+    assert(numStops <= SIMPLE_LEXER_DIALECT_MAX_STOPS);
+    for (index = 0; index + 16 <= size; index += 16)
+    {
+        bytes = _mm_loadu_si128((const __m128i*)(text + index));
+        stops = quoted
+            ? _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n'))
+            : SimpleLexer_SpaceMask128(bytes);
+        for (stop = 0; stop < numStops; ++stop)
+        {
+            stops = _mm_or_si128(stops,
+                _mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)stopBytes[stop])));
+        }
+        mask = (unsigned)_mm_movemask_epi8(stops);
+        if (mask != 0)
+        {
+            return index + SimpleLexer_TrailingZeros(mask);
+        }
+    }
+    return index + SimpleLexer_ScanScalar(text + index, size - index,
+        dialect->classes,
+        quoted ? SIMPLE_LEXER_STOPS_QUOTED : SIMPLE_LEXER_STOPS_UNQUOTED);
+}
+
+#endif  /* SIMPLELEXER_SSE2 */
+
+#ifdef SIMPLELEXER_AVX2
+
+__attribute__((target("avx2")))
+static size_t SimpleLexer_ScanAvx2(const char* text, size_t size, int quoted)
+{
+    size_t index;
+    unsigned mask;
+    __m256i bytes;
+    __m256i stops;
+    __m256i control;
+
+    for (index = 0; index + 32 <= size; index += 32)
+    {
+        bytes = _mm256_loadu_si256((const __m256i*)(text + index));
+        stops = _mm256_or_si256(
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"')),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\\')));
+        if (quoted)
+        {
+            stops = _mm256_or_si256(stops,
+                _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')));
+        }
+        else
+        {
+            control = _mm256_sub_epi8(bytes, _mm256_set1_epi8('\t'));
+            control = _mm256_cmpeq_epi8(
+                _mm256_min_epu8(control, _mm256_set1_epi8(4)), control);
+            stops = _mm256_or_si256(stops, control);
+            stops = _mm256_or_si256(stops,
+                _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')));
+            stops = _mm256_or_si256(stops,
+                _mm256_cmpeq_epi8(bytes, _mm256_setzero_si256()));
+            stops = _mm256_or_si256(stops,
+                _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('#')));
+        }
+        mask = (unsigned)_mm256_movemask_epi8(stops);
+        if (mask != 0)
+        {
+            return index + SimpleLexer_TrailingZeros(mask);
+        }
+    }
+    return index + SimpleLexer_ScanSse2(text + index, size - index, quoted);
+}
+
+#endif  /* SIMPLELEXER_AVX2 */
+
+/*
+ * Return the index of the first byte in `text` that can start a multi-byte
+ * UTF-8 whitespace character, or `size`.
+ */
+static size_t SimpleLexer_FindUtf8SpaceLead(const char* text, size_t size)
+{
+    size_t index;
+
+    index = 0;
+#ifdef SIMPLELEXER_SSE2
+    for (; index + 16 <= size; index += 16)
+    {
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            SimpleLexer_Utf8SpaceLeadMask128(
+                _mm_loadu_si128((const __m128i*)(text + index))));
+        if (mask != 0)
+        {
+            return index + SimpleLexer_TrailingZeros(mask);
+        }
+    }
+#endif
+    for (; index < size; ++index)
+    {
+        if (SimpleLexer_IsUtf8SpaceLead((unsigned char)text[index]))
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+/*
+ * Return the number of bytes at the start of `text` that can be appended
+ * to the current token verbatim: the index of the first byte that
+ * the main loop of SimpleLexer_GetNextToken() must examine, or `size`.
+ */
+static inline size_t SimpleLexer_ScanTokenRun(
+    const char* text,
+    size_t size,
+    int quoted,
+    const SimpleLexerDialect* dialect)
+{
+    if (dialect != &SimpleLexer_DefaultDialect)
+    {
+#ifdef SIMPLELEXER_SSE2
+        if ((quoted ? dialect->numQuotedStops : dialect->numUnquotedStops)
+            <= SIMPLE_LEXER_DIALECT_MAX_STOPS)
+        {
+            return SimpleLexer_ScanDialectSse2(text, size, quoted, dialect);
+        }
+#endif
+        return SimpleLexer_ScanScalar(text, size, dialect->classes,
+            quoted ? SIMPLE_LEXER_STOPS_QUOTED : SIMPLE_LEXER_STOPS_UNQUOTED);
+    }
+#ifdef SIMPLELEXER_AVX2
+    if (size >= 32 && __builtin_cpu_supports("avx2"))
+    {
+        return SimpleLexer_ScanAvx2(text, size, quoted);
+    }
+#endif
+#ifdef SIMPLELEXER_SSE2
+    return SimpleLexer_ScanSse2(text, size, quoted);
+#else
+    return SimpleLexer_ScanScalar(text, size,
+        SimpleLexer_DefaultDialect.classes,
+        quoted ? SIMPLE_LEXER_STOPS_QUOTED : SIMPLE_LEXER_STOPS_UNQUOTED);
+#endif
+}
+
+/*
+ * This is how SimpleLexer_Utf8SpaceLength() says that it needs more bytes.
+ */
+#define SIMPLE_LEXER_UTF8_INCOMPLETE ((size_t)-1)
+
+/*
+ * Return the length of the multi-byte UTF-8 whitespace character that
+ * `text` starts with, zero if it doesn't start with one, or
+ * SIMPLE_LEXER_UTF8_INCOMPLETE if its `size` bytes are too few to tell.
+ * `text` must start with a byte that SimpleLexer_IsUtf8SpaceLead() accepts.
+ */
+static size_t SimpleLexer_Utf8SpaceLength(
+    const unsigned char* text,
+    size_t size)
+{
+    assert(size != 0);
+    assert(SimpleLexer_IsUtf8SpaceLead(text[0]));
+
+    if (size < 2)
+    {
+        return SIMPLE_LEXER_UTF8_INCOMPLETE;
+    }
+    if (text[0] == 0xC2)
+    {
+        /* U+0085 and U+00A0 */
+        return text[1] == 0x85 || text[1] == 0xA0 ? 2 : 0;
+    }
+    if ((text[0] == 0xE1 && text[1] != 0x9A)
+        || (text[0] == 0xE2 && text[1] != 0x80 && text[1] != 0x81)
+        || (text[0] == 0xE3 && text[1] != 0x80))
+    {
+        return 0;
+    }
+    if (size < 3)
+    {
+        return SIMPLE_LEXER_UTF8_INCOMPLETE;
+    }
+    switch (text[0])
+    {
+        case 0xE1:
+            /* U+1680 */
+            return text[2] == 0x80 ? 3 : 0;
+
+        case 0xE2:
+            /* U+2000 through U+200A, U+2028, U+2029, U+202F, and U+205F */
+            if (text[1] == 0x81)
+            {
+                return text[2] == 0x9F ? 3 : 0;
+            }
+            return text[2] <= 0x8A || text[2] == 0xA8 || text[2] == 0xA9
+                || text[2] == 0xAF ? 3 : 0;
+
+        default:
+            /* U+3000 */
+            return text[2] == 0x80 ? 3 : 0;
+    }
+}
+
+/*
+ * This is where SimpleLexer_ValidateUtf8Scalar() is within a UTF-8
+ * sequence between calls.
+ */
+typedef struct SimpleLexerUtf8State {
+    unsigned char needed;       /* continuation bytes still needed */
+    unsigned char seen;         /* bytes of the sequence so far */
+    unsigned char min;          /* the range of the next byte */
+    unsigned char max;
+} SimpleLexerUtf8State;
+
+/*
+ * Validate text[index, size) as UTF-8 one byte at a time, continuing
+ * the sequence that `state` describes.  Return the index of the first byte
+ * that makes the text invalid or `size`.
+ */
+static size_t SimpleLexer_ValidateUtf8Scalar(
+    const unsigned char* text,
+    size_t index,
+    size_t size,
+    SimpleLexerUtf8State* state)
+{
+    unsigned char byte;
+
+    for (; index < size; ++index)
+    {
+        byte = text[index];
+        if (state->needed != 0)
+        {
+            if (byte < state->min || byte > state->max)
+            {
+                return index;
+            }
+            --state->needed;
+            ++state->seen;
+            state->min = 0x80;
+            state->max = 0xBF;
+            continue;
+        }
+        if (byte < 0x80)
+        {
+            continue;
+        }
+
+        /* Lead bytes' ranges for their first continuation bytes exclude
+           overlong encodings (0xE0 0x80-0x9F and 0xF0 0x80-0x8F),
+           surrogates (0xED 0xA0-0xBF), and code points past U+10FFFF. */
+        state->seen = 1;
+        state->min = 0x80;
+        state->max = 0xBF;
+        if (byte < 0xC2)
+        {
+            return index;
+        }
+        else if (byte < 0xE0)
+        {
+            state->needed = 1;
+        }
+        else if (byte < 0xF0)
+        {
+            state->needed = 2;
+            state->min = byte == 0xE0 ? 0xA0 : 0x80;
+            state->max = byte == 0xED ? 0x9F : 0xBF;
+        }
+        else if (byte < 0xF5)
+        {
+            state->needed = 3;
+            state->min = byte == 0xF0 ? 0x90 : 0x80;
+            state->max = byte == 0xF4 ? 0x8F : 0xBF;
+        }
+        else
+        {
+            return index;
+        }
+    }
+    return size;
+}
+
+#ifdef SIMPLELEXER_AVX2
+
+/*
+ * Return `bytes` shifted by `n` bytes into the stream, with the last `n`
+ * bytes of `previous` in front.
+ */
+#define SIMPLE_LEXER_PREVIOUS_BYTES256(bytes, previous, n) \
+    _mm256_alignr_epi8((bytes), \
+        _mm256_permute2x128_si256((previous), (bytes), 0x21), 16 - (n))
+
+/*
+ * Look up the nibbles in `nibbles` in a 16-entry table.
+ */
+#define SIMPLE_LEXER_LOOKUP256(nibbles, t0, t1, t2, t3, t4, t5, t6, t7, \
+        t8, t9, t10, t11, t12, t13, t14, t15) \
+    _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_setr_epi8( \
+        (char)(t0), (char)(t1), (char)(t2), (char)(t3), \
+        (char)(t4), (char)(t5), (char)(t6), (char)(t7), \
+        (char)(t8), (char)(t9), (char)(t10), (char)(t11), \
+        (char)(t12), (char)(t13), (char)(t14), (char)(t15))), \
+        (nibbles))
+
+/*
+ * Return the length of a prefix of `text` that is valid UTF-8 and ends
+ * at the start of a sequence, checking 32 bytes at a time with the
+ * nibble-lookup algorithm of Keiser and Lemire ("Validating UTF-8 In Less
+ * Than One Instruction Per Byte").  Each byte's high nibble and its
+ * predecessor's nibbles select bit sets of the errors that the pair might
+ * be part of, and errors are the bits that all three share.  Continuations
+ * of three- and four-byte sequences are checked separately.
+ */
+__attribute__((target("avx2")))
+static size_t SimpleLexer_ValidateUtf8Avx2(
+    const unsigned char* text,
+    size_t size)
+{
+    enum {
+        TOO_SHORT = 1 << 0,     /* a lead without enough continuations */
+        TOO_LONG = 1 << 1,      /* a continuation after ASCII */
+        OVERLONG_3 = 1 << 2,    /* 0xE0 0x80-0x9F */
+        TOO_LARGE = 1 << 3,     /* past U+10FFFF */
+        SURROGATE = 1 << 4,     /* 0xED 0xA0-0xBF */
+        OVERLONG_2 = 1 << 5,    /* 0xC0-0xC1 */
+        TOO_LARGE_1000 = 1 << 6, /* 0xF5-0xFF 0x80-0x8F */
+        OVERLONG_4 = 1 << 6,    /* 0xF0 0x80-0x8F */
+        TWO_CONTS = 1 << 7,     /* a continuation after a continuation */
+        CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS
+    };
+    size_t index;
+    size_t back;
+    __m256i bytes;
+    __m256i previous;
+    __m256i previous1;
+    __m256i nibbles;
+    __m256i errors;
+    __m256i incomplete;
+    __m256i continuations;
+
+    previous = _mm256_setzero_si256();
+    incomplete = _mm256_setzero_si256();
+    for (index = 0; index + 32 <= size; index += 32)
+    {
+        bytes = _mm256_loadu_si256((const __m256i*)(text + index));
+        if (_mm256_movemask_epi8(bytes) == 0)
+        {
+            /* ASCII is valid unless the last block left a lead hanging. */
+            if (!_mm256_testz_si256(incomplete, incomplete))
+            {
+                break;
+            }
+            previous = bytes;
+            continue;
+        }
+
+        previous1 = SIMPLE_LEXER_PREVIOUS_BYTES256(bytes, previous, 1);
+        nibbles = _mm256_and_si256(_mm256_srli_epi16(previous1, 4),
+            _mm256_set1_epi8(0x0F));
+        errors = SIMPLE_LEXER_LOOKUP256(nibbles,
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+            TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+            TOO_SHORT | OVERLONG_2,
+            TOO_SHORT,
+            TOO_SHORT | OVERLONG_3 | SURROGATE,
+            TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+        nibbles = _mm256_and_si256(previous1, _mm256_set1_epi8(0x0F));
+        errors = _mm256_and_si256(errors, SIMPLE_LEXER_LOOKUP256(nibbles,
+            CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+            CARRY | OVERLONG_2,
+            CARRY,
+            CARRY,
+            CARRY | TOO_LARGE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+            CARRY | TOO_LARGE | TOO_LARGE_1000,
+            CARRY | TOO_LARGE | TOO_LARGE_1000));
+        nibbles = _mm256_and_si256(_mm256_srli_epi16(bytes, 4),
+            _mm256_set1_epi8(0x0F));
+        errors = _mm256_and_si256(errors, SIMPLE_LEXER_LOOKUP256(nibbles,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000
+                | OVERLONG_4,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+            TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT));
+
+        /* The second and third continuations of three- and four-byte
+           sequences are TWO_CONTS errors above, so cancel those. */
+        continuations = _mm256_or_si256(
+            _mm256_subs_epu8(SIMPLE_LEXER_PREVIOUS_BYTES256(bytes, previous, 2),
+                _mm256_set1_epi8((char)(0xE0 - 0x80))),
+            _mm256_subs_epu8(SIMPLE_LEXER_PREVIOUS_BYTES256(bytes, previous, 3),
+                _mm256_set1_epi8((char)(0xF0 - 0x80))));
+        errors = _mm256_xor_si256(errors, _mm256_and_si256(continuations,
+            _mm256_set1_epi8((char)0x80)));
+        if (!_mm256_testz_si256(errors, errors))
+        {
+            break;
+        }
+
+        /* Leads in the last three bytes might need the next block. */
+        incomplete = _mm256_subs_epu8(bytes, _mm256_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)));
+        previous = bytes;
+    }
+
+    /* The blocks before `index` are valid but for their last sequence,
+       which might continue past `index`, so back up to its lead. */
+    for (back = 1; back <= 3 && back <= index; ++back)
+    {
+        if ((text[index - back] & 0xC0) != 0x80)
+        {
+            return text[index - back] >= 0xC0 ? index - back : index;
+        }
+    }
+    return index;
+}
+
+#endif  /* SIMPLELEXER_AVX2 */
+
+/*
+ * Return the length of a prefix of `text` that is valid UTF-8 and ends
+ * at the start of a sequence, as fast as the processor can check it.
+ * This can stop early, which merely leaves more for the scalar validator.
+ */
+static size_t SimpleLexer_ValidateUtf8Simd(
+    const unsigned char* text,
+    size_t size)
+{
+    size_t index;
+
+    index = 0;
+#ifdef SIMPLELEXER_AVX2
+    if (size >= 32 && __builtin_cpu_supports("avx2"))
+    {
+        return SimpleLexer_ValidateUtf8Avx2(text, size);
+    }
+#endif
+#ifdef SIMPLELEXER_SSE2
+    /* Skip ASCII, which is always valid. */
+    for (; index + 16 <= size; index += 16)
+    {
+        if (_mm_movemask_epi8(
+            _mm_loadu_si128((const __m128i*)(text + index))) != 0)
+        {
+            break;
+        }
+    }
+#endif
+    (void) text;
+    (void) size;
+    return index;
+}
+
+/*
+ * Validate text[0, size) as UTF-8, continuing the sequence that `state`
+ * describes.  Return the index of the first byte that makes the text
+ * invalid or `size`.
+ */
+static size_t SimpleLexer_ValidateUtf8Stream(
+    const unsigned char* text,
+    size_t size,
+    SimpleLexerUtf8State* state)
+{
+    size_t index;
+    size_t end;
+
+    index = 0;
+    while (index < size)
+    {
+        if (state->needed == 0)
+        {
+            index += SimpleLexer_ValidateUtf8Simd(text + index, size - index);
+        }
+
+        /* Check whatever the vectorized validator stopped at a block
+           at a time so that it can take over again afterwards. */
+        end = size - index < 64 ? size : index + 64;
+        index = SimpleLexer_ValidateUtf8Scalar(text, index, end, state);
+        if (index != end)
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+size_t SimpleLexer_ValidateUtf8(const char* text, size_t size)
+{
+    SimpleLexerUtf8State state;
+    size_t index;
+
+    assert(text != NULL || size == 0);
+
+    state.needed = 0;
+    index = SimpleLexer_ValidateUtf8Stream((const unsigned char*)text, size,
+        &state);
+
+    /* Leave out the invalid or unfinished sequence's first bytes. */
+    if (state.needed != 0)
+    {
+        index -= state.seen;
+    }
+    return index;
+}
+
+static inline void SimpleLexer_AdvanceLine(SimpleLexer* lexer)
+{
+    ++lexer->currentPosition.line;
+    lexer->numColumnsInPreviousLine = lexer->currentPosition.column;
+    lexer->currentPosition.column = 1;
+    lexer->columnBytesNeeded = 0;
+}
+
+/*
+ * the East Asian wide and fullwidth code points (as in Markus Kuhn's
+ * wcwidth(), plus the emoji blocks), sorted
+ */
+static const uint32_t SimpleLexer_WideRanges[][2] = {
+    { 0x1100, 0x115F },     /* Hangul Jamo initial consonants */
+    { 0x2329, 0x232A },     /* angle brackets */
+    { 0x2E80, 0x303E },     /* CJK radicals through CJK punctuation */
+    { 0x3041, 0x33FF },     /* kana through CJK compatibility */
+    { 0x3400, 0x4DBF },     /* CJK Unified Ideographs Extension A */
+    { 0x4E00, 0x9FFF },     /* CJK Unified Ideographs */
+    { 0xA000, 0xA4CF },     /* Yi */
+    { 0xAC00, 0xD7A3 },     /* Hangul syllables */
+    { 0xF900, 0xFAFF },     /* CJK compatibility ideographs */
+    { 0xFE10, 0xFE19 },     /* vertical forms */
+    { 0xFE30, 0xFE6F },     /* CJK compatibility forms */
+    { 0xFF00, 0xFF60 },     /* fullwidth forms */
+    { 0xFFE0, 0xFFE6 },
+    { 0x1F300, 0x1F64F },   /* pictographs and emoticons */
+    { 0x1F900, 0x1F9FF },   /* supplemental pictographs */
+    { 0x20000, 0x2FFFD },   /* CJK ideographs, supplementary plane */
+    { 0x30000, 0x3FFFD }
+};
+
+/*
+ * Return nonzero if `codePoint` takes two columns of display width.
+ */
+static int SimpleLexer_IsWide(uint32_t codePoint)
+{
+    size_t low;
+    size_t high;
+    size_t middle;
+
+    low = 0;
+    high = sizeof(SimpleLexer_WideRanges) / sizeof(SimpleLexer_WideRanges[0]);
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (codePoint > SimpleLexer_WideRanges[middle][1])
+        {
+            low = middle + 1;
+        }
+        else if (codePoint < SimpleLexer_WideRanges[middle][0])
+        {
+            high = middle;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Advance the lexer's column past the byte `c`, which isn't a newline,
+ * for lexers whose columns don't simply count bytes.  Characters are
+ * counted at their first bytes; wide ones count again at their last.
+ */
+static void SimpleLexer_AdvanceColumn(SimpleLexer* lexer, unsigned char c)
+{
+    size_t column;
+
+    column = lexer->currentPosition.column;
+    if (c == '\t' && lexer->tabWidth != 0)
+    {
+        lexer->currentPosition.column =
+            column + lexer->tabWidth - (column - 1) % lexer->tabWidth;
+        lexer->columnBytesNeeded = 0;
+        return;
+    }
+    if (lexer->columns == SIMPLE_LEXER_COLUMN_BYTES)
+    {
+        lexer->currentPosition.column = column + 1;
+        return;
+    }
+    if ((c & 0xC0) == 0x80)
+    {
+        if (lexer->columnBytesNeeded != 0)
+        {
+            lexer->columnCodePoint = lexer->columnCodePoint << 6 | (c & 0x3F);
+            if (--lexer->columnBytesNeeded == 0
+                && SimpleLexer_IsWide(lexer->columnCodePoint))
+            {
+                lexer->currentPosition.column = column + 1;
+            }
+        }
+        return;
+    }
+
+    /* Only three- and four-byte sequences encode wide characters. */
+    lexer->currentPosition.column = column + 1;
+    lexer->columnBytesNeeded = 0;
+    if (lexer->columns == SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH && c >= 0xE0)
+    {
+        lexer->columnBytesNeeded = c >= 0xF0 ? 3 : 2;
+        lexer->columnCodePoint = c & (c >= 0xF0 ? 0x07 : 0x0F);
+    }
+}
+
+#ifdef SIMPLELEXER_SSE2
+
+static inline unsigned SimpleLexer_PopCount(unsigned mask)
+{
+#if defined(__GNUC__)
+    return (unsigned)__builtin_popcount(mask);
+#else
+    unsigned count;
+
+    for (count = 0; mask != 0; mask &= mask - 1)
+    {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+#endif  /* SIMPLELEXER_SSE2 */
+
+/*
+ * Advance the lexer's column past the `size` bytes of `text`, which contain
+ * no newlines, for lexers whose columns don't simply count bytes.
+ * Blocks of 16 bytes without tabs or wide characters' first bytes are
+ * counted all at once: their columns are their bytes that aren't UTF-8
+ * continuation bytes.
+ */
+static void SimpleLexer_CountColumns(
+    SimpleLexer* restrict lexer,
+    const char* restrict text,
+    size_t size)
+{
+    size_t index;
+    size_t end;
+#ifdef SIMPLELEXER_SSE2
+    __m128i bytes;
+    __m128i stops;
+    __m128i tabs;
+    __m128i wideLeads;
+    int codePoints;
+
+    tabs = _mm_set1_epi8(lexer->tabWidth != 0 ? '\t' : '\n');
+    wideLeads = _mm_set1_epi8(
+        (char)(lexer->columns == SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH
+            ? 0xE0 : 0xFF));
+    codePoints = lexer->columns != SIMPLE_LEXER_COLUMN_BYTES;
+#endif
+
+    index = 0;
+    while (index < size)
+    {
+#ifdef SIMPLELEXER_SSE2
+        for (; index + 16 <= size && lexer->columnBytesNeeded == 0;
+            index += 16)
+        {
+            bytes = _mm_loadu_si128((const __m128i*)(text + index));
+            stops = _mm_or_si128(_mm_cmpeq_epi8(bytes, tabs),
+                _mm_cmpeq_epi8(_mm_max_epu8(bytes, wideLeads), bytes));
+            if (_mm_movemask_epi8(stops) != 0)
+            {
+                break;
+            }
+            lexer->currentPosition.column += 16;
+            if (codePoints)
+            {
+                /* Continuation bytes are the signed bytes below -64. */
+                lexer->currentPosition.column -= SimpleLexer_PopCount(
+                    (unsigned)_mm_movemask_epi8(_mm_cmplt_epi8(bytes,
+                        _mm_set1_epi8(-64))));
+            }
+        }
+#endif
+        end = size - index < 16 ? size : index + 16;
+        for (; index < end; ++index)
+        {
+            SimpleLexer_AdvanceColumn(lexer, (unsigned char)text[index]);
+        }
+    }
+}
+
+/*
+ * Return what SimpleLexer_Lex() should get as `trackLines`: zero if the
+ * lexer doesn't track lines, one if its columns count bytes, or two if
+ * they count something else.
+ */
+static inline int SimpleLexer_LineTracking(const SimpleLexer* lexer)
+{
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_LINES)
+    {
+        return 0;
+    }
+    return lexer->columns == SIMPLE_LEXER_COLUMN_BYTES && lexer->tabWidth == 0
+        ? 1 : 2;
+}
+
+/*
+ * Consume the byte `c` at the lexer's current position in its input.
+ */
+static inline void SimpleLexer_Consume(
+    SimpleLexer* lexer,
+    char c,
+    int trackLines)
+{
+    if (trackLines)
+    {
+        if (c == '\n')
+        {
+            SimpleLexer_AdvanceLine(lexer);
+        }
+        else if (trackLines > 1)
+        {
+            SimpleLexer_AdvanceColumn(lexer, (unsigned char)c);
+        }
+        else
+        {
+            ++lexer->currentPosition.column;
+        }
+    }
+    ++lexer->inputIndex;
+}
+
+/*
+ * Consume the `length`-byte UTF-8 whitespace character at the lexer's
+ * current position in its input.
+ */
+static inline void SimpleLexer_ConsumeUtf8Space(
+    SimpleLexer* lexer,
+    size_t length,
+    int trackLines)
+{
+    if (trackLines > 1)
+    {
+        SimpleLexer_CountColumns(lexer, lexer->input + lexer->inputIndex,
+            length);
+    }
+    else if (trackLines)
+    {
+        lexer->currentPosition.column += length;
+    }
+    lexer->inputIndex += length;
+}
+
+/*
+ * Set aside the rest of the lexer's input, which starts with what might be
+ * a multi-byte whitespace character, until the next input shows what it is.
+ * The bytes are consumed, but the lexer's currentPosition stays before them.
+ */
+static SimpleLexerError SimpleLexer_HoldUtf8(SimpleLexer* lexer)
+{
+    SimpleLexerError error;
+    size_t size;
+
+    size = lexer->inputSize - lexer->inputIndex;
+    assert(size != 0 && size <= sizeof(lexer->utf8Held));
+
+    /* Views can't include bytes that might not be token text. */
+    if (lexer->tokenIsView)
+    {
+        error = SimpleLexer_MaterializeView(lexer);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+    }
+
+    (void) memcpy(lexer->utf8Held, lexer->input + lexer->inputIndex, size);
+    lexer->numUtf8Held = (unsigned char)size;
+    lexer->inputIndex = lexer->inputSize;
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Add the bytes that SimpleLexer_HoldUtf8() set aside to the current token,
+ * starting one if necessary, because they aren't whitespace after all.
+ */
+static SimpleLexerError SimpleLexer_ReleaseUtf8(
+    SimpleLexer* lexer,
+    int trackLines)
+{
+    SimpleLexerError error;
+
+    if (lexer->state == SIMPLE_LEXER_STATE_NORMAL)
+    {
+        SimpleLexer_StartToken(lexer, 0, 0);
+        if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+        {
+            lexer->tokenStart.offset -= lexer->numUtf8Held;
+        }
+        lexer->tokenIsView = 0;
+        lexer->state = SIMPLE_LEXER_STATE_TOKEN;
+    }
+    assert(lexer->state == SIMPLE_LEXER_STATE_TOKEN);
+    assert(!lexer->tokenIsView);
+
+    while (lexer->numUtf8Held != 0)
+    {
+        error = SimpleLexer_AppendToBuffer(lexer, (char)lexer->utf8Held[0]);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+        if (trackLines > 1)
+        {
+            SimpleLexer_AdvanceColumn(lexer, lexer->utf8Held[0]);
+        }
+        else if (trackLines)
+        {
+            ++lexer->currentPosition.column;
+        }
+        lexer->utf8Held[0] = lexer->utf8Held[1];
+        --lexer->numUtf8Held;
+    }
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Decide whether the bytes that SimpleLexer_HoldUtf8() set aside and the
+ * start of the lexer's new input are whitespace.  This returns
+ * SIMPLE_LEXER_OK if they finished a token, SIMPLE_LEXER_EOF if lexing
+ * should go on, or an error.
+ */
+static SimpleLexerError SimpleLexer_ResolveUtf8(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict outToken,
+    int trackLines)
+{
+    unsigned char bytes[3];
+    size_t numBytes;
+    size_t length;
+    SimpleLexerError error;
+
+    assert(lexer->numUtf8Held != 0);
+
+    (void) memcpy(bytes, lexer->utf8Held, lexer->numUtf8Held);
+    numBytes = lexer->numUtf8Held;
+    while (numBytes < sizeof(bytes)
+        && lexer->inputIndex + (numBytes - lexer->numUtf8Held)
+            < lexer->inputSize)
+    {
+        bytes[numBytes] = (unsigned char)lexer->input[lexer->inputIndex
+            + (numBytes - lexer->numUtf8Held)];
+        ++numBytes;
+    }
+
+    length = SimpleLexer_Utf8SpaceLength(bytes, numBytes);
+    if (length == SIMPLE_LEXER_UTF8_INCOMPLETE)
+    {
+        /* This input is too short to tell, too. */
+        (void) memcpy(lexer->utf8Held, bytes, numBytes);
+        lexer->inputIndex += numBytes - lexer->numUtf8Held;
+        lexer->numUtf8Held = (unsigned char)numBytes;
+        return SIMPLE_LEXER_EOF;
+    }
+    if (length == 0)
+    {
+        error = SimpleLexer_ReleaseUtf8(lexer, trackLines);
+        return error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error;
+    }
+
+    /* The whitespace starts at the lexer's current position, but its held
+       bytes came from the last input, so the token ends before them. */
+    error = SIMPLE_LEXER_EOF;
+    if (lexer->state == SIMPLE_LEXER_STATE_TOKEN)
+    {
+        SimpleLexer_FinishToken(lexer, outToken, 0, trackLines);
+        if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+        {
+            outToken->span.end.offset -= lexer->numUtf8Held;
+        }
+        lexer->state = SIMPLE_LEXER_STATE_NORMAL;
+        error = SIMPLE_LEXER_OK;
+    }
+    if (trackLines > 1)
+    {
+        SimpleLexer_CountColumns(lexer, (const char*)bytes, length);
+    }
+    else if (trackLines)
+    {
+        lexer->currentPosition.column += length;
+    }
+    lexer->inputIndex += length - lexer->numUtf8Held;
+    lexer->numUtf8Held = 0;
+    return error;
+}
+
+/*
+ * Validate a lexer's new input as UTF-8, continuing any sequence that the
+ * last input ended in the middle of, and stop the input (by shrinking
+ * inputSize) at the first invalid sequence, if any.
+ */
+static void SimpleLexer_ValidateUtf8Input(SimpleLexer* lexer)
+{
+    SimpleLexerUtf8State state;
+    size_t index;
+
+    state.needed = lexer->utf8Needed;
+    state.seen = lexer->utf8Seen;
+    state.min = lexer->utf8Min;
+    state.max = lexer->utf8Max;
+    index = SimpleLexer_ValidateUtf8Stream(
+        (const unsigned char*)lexer->input, lexer->inputSize, &state);
+
+    lexer->utf8InputSize = lexer->inputSize;
+    if (index != lexer->inputSize)
+    {
+        /* Stop before the invalid sequence if it starts in this input.
+           The next input starts afresh. */
+        if (state.needed != 0)
+        {
+            index = state.seen <= index ? index - state.seen : 0;
+        }
+        lexer->inputSize = index;
+        state.needed = 0;
+    }
+    lexer->utf8Needed = state.needed;
+    lexer->utf8Seen = state.seen;
+    lexer->utf8Min = state.min;
+    lexer->utf8Max = state.max;
+}
+
+void SimpleLexer_SetInput(
+    SimpleLexer* restrict lexer,
+    const char* restrict text,
+    size_t textSize)
+{
+    assert(lexer != NULL);
+    assert(text != NULL);
+
+#ifdef SIMPLELEXER_STATS
+    ++lexer->stats.numInputs;
+    if (lexer->state != SIMPLE_LEXER_STATE_NORMAL
+        && lexer->state != SIMPLE_LEXER_STATE_COMMENT)
+    {
+        lexer->tokenSpansInputs = 1;
+    }
+#endif
+
+    /* Positions continue from wherever the previous input was left. */
+    lexer->inputOffset += lexer->inputIndex;
+    lexer->input = text;
+    lexer->inputSize = textSize;
+    lexer->inputIndex = 0;
+    if (lexer->utf8)
+    {
+        SimpleLexer_ValidateUtf8Input(lexer);
+    }
+    SIMPLE_LEXER_PROBE3(input, lexer->inputOffset, textSize, lexer->state);
+}
+
+/*
+ * This is the body of SimpleLexer_GetNextToken().  It's inlined into
+ * the functions that lex many tokens per call so that the compiler can keep
+ * the lexer's state in registers between tokens.  Lines and columns are
+ * tracked only if `trackLines` is nonzero, which callers pass as a constant
+ * so that the compiler can drop the bookkeeping from lexers that don't
+ * track lines.  It's more than one if columns don't simply count bytes
+ * (see SimpleLexer_LineTracking()).  Likewise, `utf8` is nonzero only for
+ * lexers in UTF-8 mode.
+ * (GCC won't inline a function this big unless it's told to.)
+ */
+#if defined(__GNUC__)
+__attribute__((always_inline))
+#endif
+static inline SimpleLexerError SimpleLexer_Lex(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict outToken,
+    int trackLines,
+    int utf8)
+{
+    char c;
+    char escaped;
+    size_t run;
+    size_t runStart;
+    const unsigned char* classes;
+    const SimpleLexerTransition* transition;
+    SimpleLexerError error;
+
+    assert(lexer != NULL);
+    assert(lexer->buffer != NULL);
+    assert(outToken != NULL);
+
+    classes = lexer->dialect->classes;
+    if (lexer->finished) {
+        return SIMPLE_LEXER_EOF;
+    }
+
+    if (utf8 && lexer->numUtf8Held != 0
+        && lexer->inputIndex < lexer->inputSize)
+    {
+        error = SimpleLexer_ResolveUtf8(lexer, outToken, trackLines);
+        if (error != SIMPLE_LEXER_EOF)
+        {
+            return error;
+        }
+    }
+
+    while (lexer->inputIndex < lexer->inputSize)
+    {
+        assert(lexer->input != NULL);
+
+        /* Consume runs of bytes that need no individual attention in bulk:
+           comment text up to the next newline and plain token text up to
+           the next delimiter, quotation mark, or backslash. */
+        if (lexer->state == SIMPLE_LEXER_STATE_COMMENT)
+        {
+            const char* newline = memchr(lexer->input + lexer->inputIndex,
+                '\n', lexer->inputSize - lexer->inputIndex);
+            run = newline != NULL
+                ? (size_t)(newline - (lexer->input + lexer->inputIndex))
+                : lexer->inputSize - lexer->inputIndex;
+            if (trackLines > 1)
+            {
+                SimpleLexer_CountColumns(lexer,
+                    lexer->input + lexer->inputIndex, run);
+            }
+            else if (trackLines)
+            {
+                lexer->currentPosition.column += run;
+            }
+            lexer->inputIndex += run;
+            SIMPLE_LEXER_COUNT(lexer, numCommentBytes, run);
+            if (newline == NULL)
+            {
+                break;
+            }
+        }
+        else if (lexer->state == SIMPLE_LEXER_STATE_TOKEN
+            || lexer->state == SIMPLE_LEXER_STATE_QUOTED)
+        {
+            run = SimpleLexer_ScanTokenRun(lexer->input + lexer->inputIndex,
+                lexer->inputSize - lexer->inputIndex,
+                lexer->state == SIMPLE_LEXER_STATE_QUOTED, lexer->dialect);
+
+            /* In UTF-8 mode, unquoted runs also stop at bytes that might
+               start multi-byte whitespace. */
+            if (utf8 && lexer->state == SIMPLE_LEXER_STATE_TOKEN)
+            {
+                run = SimpleLexer_FindUtf8SpaceLead(
+                    lexer->input + lexer->inputIndex, run);
+            }
+            if (run != 0)
+            {
+                runStart = lexer->inputIndex;
+                error = SimpleLexer_AppendRunToBuffer(lexer, run);
+                if (trackLines > 1)
+                {
+                    SimpleLexer_CountColumns(lexer, lexer->input + runStart,
+                        lexer->inputIndex - runStart);
+                }
+                else if (trackLines)
+                {
+                    lexer->currentPosition.column +=
+                        lexer->inputIndex - runStart;
+                }
+                if (error != SIMPLE_LEXER_OK)
+                {
+                    return error;
+                }
+                if (lexer->inputIndex == lexer->inputSize)
+                {
+                    break;
+                }
+            }
+        }
+
+        /* c is at position lexer->currentPosition.
+           Don't advance lexer->currentPosition until we've consumed c.
+           The lexer's state changes only if what it does with c succeeds. */
+        c = lexer->input[lexer->inputIndex];
+
+        /* Multi-byte whitespace acts like ' ' between and after unquoted
+           tokens' bytes.  If it's cut off by the end of the input, set its
+           bytes aside until the next input. */
+        if (utf8 && SimpleLexer_IsUtf8SpaceLead((unsigned char)c)
+            && classes[(unsigned char)c] == SIMPLE_LEXER_CLASS_OTHER
+            && (lexer->state == SIMPLE_LEXER_STATE_NORMAL
+                || lexer->state == SIMPLE_LEXER_STATE_TOKEN))
+        {
+            run = SimpleLexer_Utf8SpaceLength(
+                (const unsigned char*)lexer->input + lexer->inputIndex,
+                lexer->inputSize - lexer->inputIndex);
+            if (run == SIMPLE_LEXER_UTF8_INCOMPLETE)
+            {
+                error = SimpleLexer_HoldUtf8(lexer);
+                if (error != SIMPLE_LEXER_OK)
+                {
+                    return error;
+                }
+                break;
+            }
+            if (run != 0)
+            {
+                if (lexer->state == SIMPLE_LEXER_STATE_TOKEN)
+                {
+                    SimpleLexer_FinishToken(lexer, outToken, 0, trackLines);
+                    lexer->state = SIMPLE_LEXER_STATE_NORMAL;
+                    SimpleLexer_ConsumeUtf8Space(lexer, run, trackLines);
+                    return SIMPLE_LEXER_OK;
+                }
+                SimpleLexer_ConsumeUtf8Space(lexer, run, trackLines);
+                continue;
+            }
+        }
+
+        transition = &SimpleLexer_Transitions[lexer->state]
+            [classes[(unsigned char)c]];
+#ifdef SIMPLELEXER_STATS
+        if (transition->nextState == SIMPLE_LEXER_STATE_COMMENT
+            && lexer->state != SIMPLE_LEXER_STATE_COMMENT)
+        {
+            ++lexer->stats.numCommentBytes;
+        }
+#endif
+
+        switch (transition->action)
+        {
+            case SIMPLE_LEXER_SKIP:
+                break;
+
+            case SIMPLE_LEXER_START:
+                SimpleLexer_StartToken(lexer, 0, 0);
+                lexer->state = SIMPLE_LEXER_STATE_TOKEN;
+                /* fall through */
+            case SIMPLE_LEXER_APPEND:
+                error = SimpleLexer_AppendInputChar(lexer, c);
+                if (error != SIMPLE_LEXER_OK)
+                {
+                    return error;
+                }
+                break;
+
+            case SIMPLE_LEXER_START_QUOTED:
+                SimpleLexer_StartToken(lexer, 1, 0);
+                lexer->quote = c;
+                break;
+
+            case SIMPLE_LEXER_START_ESCAPED:
+                SimpleLexer_StartToken(lexer, 0, 1);
+                break;
+
+            case SIMPLE_LEXER_ESCAPE:
+                lexer->tokenEscaped = 1;
+                if (lexer->tokenIsView)
+                {
+                    error = SimpleLexer_MaterializeView(lexer);
+                    if (error != SIMPLE_LEXER_OK)
+                    {
+                        return error;
+                    }
+                }
+                break;
+
+            case SIMPLE_LEXER_APPEND_ESCAPED:
+                escaped = lexer->dialect->escapes[(unsigned char)c];
+                error = SimpleLexer_AppendToBuffer(lexer,
+                    escaped != 0 ? escaped : c);
+                if (error != SIMPLE_LEXER_OK)
+                {
+                    return error;
+                }
+                SIMPLE_LEXER_COUNT(lexer, numEscapes, 1);
+                break;
+
+            case SIMPLE_LEXER_FINISH:
+                SimpleLexer_FinishToken(lexer, outToken, 0, trackLines);
+                lexer->state = transition->nextState;
+                SimpleLexer_Consume(lexer, c, trackLines);
+                return SIMPLE_LEXER_OK;
+
+            case SIMPLE_LEXER_FINISH_BEFORE:
+                SimpleLexer_FinishToken(lexer, outToken, 0, trackLines);
+                lexer->state = transition->nextState;
+                return SIMPLE_LEXER_OK;
+
+            case SIMPLE_LEXER_FINISH_QUOTED:
+                /* Other quotes are plain text inside quoted tokens. */
+                if (c != lexer->quote)
+                {
+                    error = SimpleLexer_AppendInputChar(lexer, c);
+                    if (error != SIMPLE_LEXER_OK)
+                    {
+                        return error;
+                    }
+                    SimpleLexer_Consume(lexer, c, trackLines);
+                    continue;
+                }
+                SimpleLexer_FinishToken(lexer, outToken, 1, trackLines);
+                lexer->state = transition->nextState;
+                SimpleLexer_Consume(lexer, c, trackLines);
+                return SIMPLE_LEXER_OK;
+        }
+
+        lexer->state = transition->nextState;
+        SimpleLexer_Consume(lexer, c, trackLines);
+    }
+
+    /* The next input replaces this one, so views can't outlive it. */
+    if (lexer->tokenIsView)
+    {
+        error = SimpleLexer_MaterializeView(lexer);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
+    }
+
+    /* UTF-8 mode ends inputs early at invalid sequences. */
+    if (utf8 && lexer->inputSize != lexer->utf8InputSize)
+    {
+        return SIMPLE_LEXER_INVALID_UTF8;
+    }
+    return SIMPLE_LEXER_EOF;
+}
+
+/*
+ * Fire the error probe if `error` is a lexing error.
+ */
+static inline void SimpleLexer_ProbeError(
+    const SimpleLexer* lexer,
+    SimpleLexerError error)
+{
+    (void) lexer;
+    if (error != SIMPLE_LEXER_OK && error != SIMPLE_LEXER_EOF
+        && error != SIMPLE_LEXER_STOPPED
+        && error != SIMPLE_LEXER_PARTIAL_TOKEN)
+    {
+        SIMPLE_LEXER_PROBE4(error, lexer->inputOffset + lexer->inputIndex,
+            lexer->tokenIsView
+                ? lexer->inputIndex - lexer->tokenInputIndex
+                : lexer->bufferLength,
+            lexer->state, error);
+    }
+}
+
+/*
+ * Lex via the variant of SimpleLexer_Lex() that suits the lexer's position
+ * tracking, then bring the lexer's current offset up to date.
+ */
+static inline SimpleLexerError SimpleLexer_LexTracked(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict outToken)
+{
+    SimpleLexerError error;
+
+    if (lexer->utf8 || SimpleLexer_LineTracking(lexer) > 1)
+    {
+        error = SimpleLexer_Lex(lexer, outToken,
+            SimpleLexer_LineTracking(lexer), lexer->utf8);
+    }
+    else if (lexer->positionTracking == SIMPLE_LEXER_TRACK_LINES)
+    {
+        error = SimpleLexer_Lex(lexer, outToken, 1, 0);
+    }
+    else
+    {
+        error = SimpleLexer_Lex(lexer, outToken, 0, 0);
+    }
+    error = SimpleLexer_FragmentIfTooLarge(lexer, outToken, error);
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+    {
+        lexer->currentPosition.offset = lexer->inputOffset + lexer->inputIndex
+            - lexer->numUtf8Held;
+    }
+    SIMPLE_LEXER_COUNT(lexer, numTokensTooLarge,
+        error == SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    SimpleLexer_ProbeError(lexer, error);
+    return error;
+}
+
+SimpleLexerError SimpleLexer_GetNextToken(
+    SimpleLexer* restrict lexer,
     SimpleToken* restrict outToken)
 {
-    char c;
+    return SimpleLexer_LexTracked(lexer, outToken);
+}
+
+/*
+ * This is what lexing a token can change in a lexer besides its token buffer,
+ * which lexing only appends to (and grows).  SimpleLexer_GetTokens() saves
+ * it so that it can un-lex tokens that don't fit in its caller's arena.
+ */
+typedef struct SimpleLexerSnapshot {
+    TextPosition currentPosition;
+    size_t numColumnsInPreviousLine;
+    TextPosition tokenStart;
+    SimpleLexerState state;
+    char startedEscaped;
+    char tokenEscaped;
+    char tokenIsView;
+    char tokenFragmented;
+    char quote;
+    size_t bufferLength;
+    size_t inputIndex;
+    size_t tokenInputIndex;
+    unsigned char numUtf8Held;
+    unsigned char utf8Held[2];
+    uint32_t columnCodePoint;
+    unsigned char columnBytesNeeded;
+#ifdef SIMPLELEXER_STATS
+    SimpleLexerStats stats;
+    char tokenSpansInputs;
+#endif
+} SimpleLexerSnapshot;
+
+static void SimpleLexer_Save(
+    const SimpleLexer* restrict lexer,
+    SimpleLexerSnapshot* restrict snapshot)
+{
+    snapshot->currentPosition = lexer->currentPosition;
+    snapshot->numColumnsInPreviousLine = lexer->numColumnsInPreviousLine;
+    snapshot->tokenStart = lexer->tokenStart;
+    snapshot->state = lexer->state;
+    snapshot->startedEscaped = lexer->startedEscaped;
+    snapshot->tokenEscaped = lexer->tokenEscaped;
+    snapshot->tokenIsView = lexer->tokenIsView;
+    snapshot->tokenFragmented = lexer->tokenFragmented;
+    snapshot->quote = lexer->quote;
+    snapshot->bufferLength = lexer->bufferLength;
+    snapshot->inputIndex = lexer->inputIndex;
+    snapshot->tokenInputIndex = lexer->tokenInputIndex;
+    snapshot->numUtf8Held = lexer->numUtf8Held;
+    snapshot->utf8Held[0] = lexer->utf8Held[0];
+    snapshot->utf8Held[1] = lexer->utf8Held[1];
+    snapshot->columnCodePoint = lexer->columnCodePoint;
+    snapshot->columnBytesNeeded = lexer->columnBytesNeeded;
+#ifdef SIMPLELEXER_STATS
+    snapshot->stats = lexer->stats;
+    snapshot->tokenSpansInputs = lexer->tokenSpansInputs;
+#endif
+}
+
+static void SimpleLexer_Restore(
+    SimpleLexer* restrict lexer,
+    const SimpleLexerSnapshot* restrict snapshot)
+{
+    lexer->currentPosition = snapshot->currentPosition;
+    lexer->numColumnsInPreviousLine = snapshot->numColumnsInPreviousLine;
+    lexer->tokenStart = snapshot->tokenStart;
+    lexer->state = snapshot->state;
+    lexer->startedEscaped = snapshot->startedEscaped;
+    lexer->tokenEscaped = snapshot->tokenEscaped;
+    lexer->tokenIsView = snapshot->tokenIsView;
+    lexer->tokenFragmented = snapshot->tokenFragmented;
+    lexer->quote = snapshot->quote;
+    lexer->bufferLength = snapshot->bufferLength;
+    lexer->inputIndex = snapshot->inputIndex;
+    lexer->tokenInputIndex = snapshot->tokenInputIndex;
+    lexer->numUtf8Held = snapshot->numUtf8Held;
+    lexer->utf8Held[0] = snapshot->utf8Held[0];
+    lexer->utf8Held[1] = snapshot->utf8Held[1];
+    lexer->columnCodePoint = snapshot->columnCodePoint;
+    lexer->columnBytesNeeded = snapshot->columnBytesNeeded;
+#ifdef SIMPLELEXER_STATS
+    lexer->stats = snapshot->stats;
+    lexer->tokenSpansInputs = snapshot->tokenSpansInputs;
+#endif
+}
+
+SimpleLexerError SimpleLexer_GetTokens(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict tokens,
+    size_t maxTokens,
+    char* restrict textArena,
+    size_t textArenaSize,
+    size_t* restrict numTokens)
+{
+    SimpleLexerError error;
+    SimpleLexerSnapshot saved;
+    int isSaved;
+    size_t count;
+    size_t arenaLength;
+
+    assert(lexer != NULL);
+    assert(tokens != NULL);
+    assert(textArena != NULL);
+    assert(numTokens != NULL);
+
+    error = SIMPLE_LEXER_OK;
+    arenaLength = 0;
+    SimpleLexer_Save(lexer, &saved);
+    for (count = 0; count < maxTokens; ++count)
+    {
+        /* If the next token might not fit in the rest of the arena,
+           save the lexer's state so that the token can be un-lexed.
+           (The state before the first token was saved above.) */
+        isSaved = textArenaSize - arenaLength < lexer->maxBufferCapacity;
+        if (isSaved && count != 0)
+        {
+            SimpleLexer_Save(lexer, &saved);
+        }
+
+        error = SimpleLexer_LexTracked(lexer, &tokens[count]);
+        if (error == SIMPLE_LEXER_PARTIAL_TOKEN)
+        {
+            error = SIMPLE_LEXER_OK;
+        }
+        if (error != SIMPLE_LEXER_OK)
+        {
+            break;
+        }
+
+        if (!tokens[count].isView)
+        {
+            if (tokens[count].length >= textArenaSize - arenaLength)
+            {
+                assert(isSaved);
+                SimpleLexer_Restore(lexer, &saved);
+                if (count == 0)
+                {
+                    error = SIMPLE_LEXER_TOKEN_TOO_LARGE;
+                    SIMPLE_LEXER_COUNT(lexer, numTokensTooLarge, 1);
+                    SimpleLexer_ProbeError(lexer, error);
+                }
+                break;
+            }
+
+            (void) memcpy(textArena + arenaLength, tokens[count].text,
+                tokens[count].length + 1);
+            tokens[count].text = textArena + arenaLength;
+            arenaLength += tokens[count].length + 1;
+        }
+    }
+
+    *numTokens = count;
+    return error;
+}
+
+/*
+ * This is the body of SimpleLexer_PushTokens(), specialized like
+ * SimpleLexer_Lex(), which is inlined into its loop so that the lexer
+ * doesn't return to a caller between tokens.  (It has to be inlined into
+ * its callers, too, for the specialization to stick.)
+ */
+#if defined(__GNUC__)
+__attribute__((always_inline))
+#endif
+static inline SimpleLexerError SimpleLexer_Push(
+    SimpleLexer* lexer,
+    SimpleTokenHandler handler,
+    void* context,
+    int trackLines,
+    int utf8)
+{
+    SimpleToken token;
+    SimpleLexerError error;
+
+    /* Fragments go to the handler like tokens. */
+    while ((error = SimpleLexer_Lex(lexer, &token, trackLines, utf8))
+        == SIMPLE_LEXER_OK
+        || SimpleLexer_FragmentIfTooLarge(lexer, &token, error)
+            == SIMPLE_LEXER_PARTIAL_TOKEN)
+    {
+        /* Handlers might look at the lexer's position. */
+        if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+        {
+            lexer->currentPosition.offset = lexer->inputOffset
+                + lexer->inputIndex - lexer->numUtf8Held;
+        }
+        if (handler(context, &token))
+        {
+            return SIMPLE_LEXER_STOPPED;
+        }
+    }
+    return error;
+}
+
+SimpleLexerError SimpleLexer_PushTokens(
+    SimpleLexer* lexer,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    SimpleLexerError error;
+    char tokenViews;
+
+    assert(lexer != NULL);
+    assert(handler != NULL);
+
+    /* Only tokens started here are affected, and all of them are finished
+       before this returns unless lexing fails. */
+    tokenViews = lexer->tokenViews;
+    lexer->tokenViews = 1;
+    if (lexer->utf8 || SimpleLexer_LineTracking(lexer) > 1)
+    {
+        error = SimpleLexer_Push(lexer, handler, context,
+            SimpleLexer_LineTracking(lexer), lexer->utf8);
+    }
+    else if (lexer->positionTracking == SIMPLE_LEXER_TRACK_LINES)
+    {
+        error = SimpleLexer_Push(lexer, handler, context, 1, 0);
+    }
+    else
+    {
+        error = SimpleLexer_Push(lexer, handler, context, 0, 0);
+    }
+    lexer->tokenViews = tokenViews;
+
+    if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+    {
+        lexer->currentPosition.offset = lexer->inputOffset + lexer->inputIndex
+            - lexer->numUtf8Held;
+    }
+    SIMPLE_LEXER_COUNT(lexer, numTokensTooLarge,
+        error == SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    SimpleLexer_ProbeError(lexer, error);
+    return error;
+}
+
+SimpleLexerError SimpleLexer_Feed(
+    SimpleLexer* lexer,
+    const char* text,
+    size_t textSize,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    SimpleLexer_SetInput(lexer, text, textSize);
+    return SimpleLexer_PushTokens(lexer, handler, context);
+}
+
+SimpleLexerError SimpleLexer_Finish(
+    SimpleLexer* restrict lexer,
+    SimpleToken* restrict finalToken)
+{
+    int error;
+    size_t length;
+    SimpleLexerState state;
+
+    assert(lexer != NULL);
+    assert(finalToken != NULL);
+
+    if (lexer->finished)
+    {
+        return SIMPLE_LEXER_EOF;
+    }
+
+    /* Bytes set aside in case they were whitespace were cut off. */
+    if (lexer->numUtf8Held != 0)
+    {
+        error = SimpleLexer_ReleaseUtf8(lexer,
+            SimpleLexer_LineTracking(lexer));
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return SimpleLexer_FragmentIfTooLarge(lexer, finalToken, error);
+        }
+        if (lexer->positionTracking != SIMPLE_LEXER_TRACK_NOTHING)
+        {
+            lexer->currentPosition.offset =
+                lexer->inputOffset + lexer->inputIndex;
+        }
+    }
+
+    error = SIMPLE_LEXER_OK;
+
+    if (lexer->state == SIMPLE_LEXER_STATE_ESCAPING
+        || lexer->state == SIMPLE_LEXER_STATE_ESCAPING_QUOTED)
+    {
+        error = SIMPLE_LEXER_ESCAPING_EOF;
+    }
+
+    if (lexer->state == SIMPLE_LEXER_STATE_QUOTED
+        || lexer->state == SIMPLE_LEXER_STATE_ESCAPING_QUOTED)
+    {
+        error = SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN;
+    }
+
+    if (error == SIMPLE_LEXER_OK && lexer->utf8Needed != 0)
+    {
+        error = SIMPLE_LEXER_INVALID_UTF8;
+    }
+
+    length = 0;
+    state = lexer->state;
+    if (lexer->bufferLength != 0
+        || (lexer->tokenIsView && lexer->inputIndex != lexer->tokenInputIndex)
+        || lexer->tokenFragmented)
+    {
+        SimpleLexer_FinishToken(lexer, finalToken, 0,
+            SimpleLexer_LineTracking(lexer));
+        length = finalToken->length;
+    }
+    else if (error == SIMPLE_LEXER_OK)
+    {
+        error = SIMPLE_LEXER_EOF;
+    }
+
+    lexer->finished = 1;
+    SIMPLE_LEXER_PROBE4(finish, lexer->inputOffset + lexer->inputIndex,
+        length, state, error);
+    (void) length;
+    (void) state;
+
+    return error;
+}
+
+void SimpleLexer_GetStats(
+    const SimpleLexer* restrict lexer,
+    SimpleLexerStats* restrict stats)
+{
+    assert(lexer != NULL);
+    assert(stats != NULL);
+
+#ifdef SIMPLELEXER_STATS
+    *stats = lexer->stats;
+    stats->numBytes += lexer->inputOffset + lexer->inputIndex;
+#else
+    (void) lexer;
+    (void) memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+void SimpleLexer_ResetStats(SimpleLexer* lexer)
+{
+    assert(lexer != NULL);
+
+#ifdef SIMPLELEXER_STATS
+    /* SimpleLexer_GetStats() adds all of the stream's bytes, so start
+       numBytes (unsigned, so it wraps) below zero by those seen so far. */
+    (void) memset(&lexer->stats, 0, sizeof(lexer->stats));
+    lexer->stats.numBytes -= lexer->inputOffset + lexer->inputIndex;
+#else
+    (void) lexer;
+#endif
+}
+
+void SimpleLexerStats_Merge(
+    SimpleLexerStats* restrict dest,
+    const SimpleLexerStats* restrict source)
+{
+    size_t bucket;
+
+    assert(dest != NULL);
+    assert(source != NULL);
+
+    dest->numBytes += source->numBytes;
+    dest->numInputs += source->numInputs;
+    dest->numQuotedTokens += source->numQuotedTokens;
+    dest->numUnquotedTokens += source->numUnquotedTokens;
+    dest->numStartedEscapedTokens += source->numStartedEscapedTokens;
+    dest->numEscapes += source->numEscapes;
+    dest->numCommentBytes += source->numCommentBytes;
+    dest->numSpanningTokens += source->numSpanningTokens;
+    dest->numTokensTooLarge += source->numTokensTooLarge;
+    dest->numFragments += source->numFragments;
+    for (bucket = 0; bucket < SIMPLE_LEXER_STATS_NUM_BUCKETS; ++bucket)
+    {
+        dest->tokenLengths[bucket] += source->tokenLengths[bucket];
+    }
+}
+
+/*
+ * Give a word that SimpleLexer_SplitLine() lexed a slot in `words` and point
+ * the lexer's buffer just past the word's NUL, where the next word goes.
+ */
+static void SimpleLexer_KeepSplitWord(
+    SimpleLexer* restrict lexer,
+    const SimpleToken* restrict token,
+    char** restrict words,
+    size_t* restrict numWords,
+    char* restrict end)
+{
+    char* next;
+
+    assert(!token->isView);
+    assert(token->text == lexer->buffer);
+
+    words[*numWords] = token->text;
+    ++*numWords;
+
+    next = token->text + token->length + 1;
+    lexer->buffer = next;
+    lexer->bufferCapacity = (size_t)(end - next);
+    lexer->maxBufferCapacity = lexer->bufferCapacity;
+}
+
+SimpleLexerError SimpleLexer_SplitLine(
+    const char* restrict text,
+    size_t size,
+    int* restrict argc,
+    char*** restrict argv)
+{
+    SimpleLexer lexer;
+    SimpleToken token;
+    SimpleLexerError error;
+    size_t maxWords;
+    size_t slotsSize;
+    size_t textCapacity;
+    size_t numWords;
+    char** words;
+    char* wordText;
+
+    assert(text != NULL || size == 0);
+    assert(argc != NULL);
+    assert(argv != NULL);
+
+    *argc = 0;
+    *argv = NULL;
+
+    /* Words need at least one byte each, and unquoted words need whitespace
+       or quotes after them, so the densest text alternates one-byte words
+       with empty quoted ones (a""b""c), packing two words into three bytes.
+       Each word's text is no longer than its bytes, so the strings, NULs
+       included, fit in `size` bytes plus one per word.  (The one extra byte
+       keeps the lexer's buffer nonempty.) */
+    maxWords = size - size / 3;
+    if (maxWords >= INT_MAX || maxWords >= SIZE_MAX / sizeof(char*))
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    slotsSize = (maxWords + 1) * sizeof(char*);
+    if (size >= SIZE_MAX - maxWords
+        || size + maxWords + 1 > SIZE_MAX - slotsSize)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    textCapacity = size + maxWords + 1;
+
+    words = (char**)malloc(slotsSize + textCapacity);
+    if (words == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    wordText = (char*)(words + maxWords + 1);
+
+    /* The lexer writes each word's text straight into the block. */
+    SimpleLexer_Init(&lexer, wordText, textCapacity);
+    SimpleLexer_SetPositionTracking(&lexer, SIMPLE_LEXER_TRACK_NOTHING);
+    SimpleLexer_SetInput(&lexer, text, size);
+
+    numWords = 0;
+    while ((error = SimpleLexer_GetNextToken(&lexer, &token))
+        == SIMPLE_LEXER_OK)
+    {
+        assert(numWords < maxWords);
+        SimpleLexer_KeepSplitWord(&lexer, &token, words, &numWords,
+            wordText + textCapacity);
+    }
+    if (error == SIMPLE_LEXER_EOF)
+    {
+        error = SimpleLexer_Finish(&lexer, &token);
+        if (error == SIMPLE_LEXER_OK)
+        {
+            assert(numWords < maxWords);
+            SimpleLexer_KeepSplitWord(&lexer, &token, words, &numWords,
+                wordText + textCapacity);
+            error = SIMPLE_LEXER_EOF;
+        }
+    }
+    if (error != SIMPLE_LEXER_EOF)
+    {
+        free(words);
+        return error;
+    }
+
+    words[numWords] = NULL;
+    *argc = (int)numWords;
+    *argv = words;
+    return SIMPLE_LEXER_EOF;
+}
+
+/*
+ * Grow the splitter's block so that it has at least `minSlots` pointers and
+ * `minTextCapacity` bytes for strings, moving the record's words into it.
+ */
+static SimpleLexerError SimpleLineSplitter_Grow(
+    SimpleLineSplitter* splitter,
+    size_t minSlots,
+    size_t minTextCapacity)
+{
+    const SimpleLexerAllocator* allocator;
+    size_t numSlots;
+    size_t textCapacity;
+    size_t word;
+    char** block;
+    char* text;
+    char* oldText;
+
+    assert(splitter != NULL);
+
+    numSlots = splitter->numSlots < 8 ? 8 : splitter->numSlots;
+    while (numSlots < minSlots)
+    {
+        if (numSlots > SIZE_MAX / 2)
+        {
+            return SIMPLE_LEXER_OUT_OF_MEMORY;
+        }
+        numSlots *= 2;
+    }
+
+    textCapacity = splitter->textCapacity < 64 ? 64 : splitter->textCapacity;
+    while (textCapacity < minTextCapacity)
+    {
+        if (textCapacity > SIZE_MAX / 2)
+        {
+            return SIMPLE_LEXER_OUT_OF_MEMORY;
+        }
+        textCapacity *= 2;
+    }
+
+    if (numSlots > SIZE_MAX / sizeof(char*)
+        || textCapacity > SIZE_MAX - numSlots * sizeof(char*))
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+
+    allocator = &splitter->lexer.allocator;
+    block = (char**)allocator->allocate(allocator->context,
+        numSlots * sizeof(char*) + textCapacity);
+    if (block == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    text = (char*)(block + numSlots);
+
+    if (splitter->block != NULL)
+    {
+        oldText = (char*)(splitter->block + splitter->numSlots);
+        (void) memcpy(text, oldText, splitter->textSize);
+        for (word = 0; word < splitter->numWords; ++word)
+        {
+            block[word] = text + (splitter->block[word] - oldText);
+        }
+        allocator->deallocate(allocator->context, splitter->block,
+            splitter->numSlots * sizeof(char*) + splitter->textCapacity);
+    }
+
+    splitter->block = block;
+    splitter->numSlots = numSlots;
+    splitter->textCapacity = textCapacity;
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Copy a word to the end of the splitter's record.
+ */
+static SimpleLexerError SimpleLineSplitter_AddWord(
+    SimpleLineSplitter* restrict splitter,
+    const SimpleToken* restrict token)
+{
+    SimpleLexerError error;
+    char* text;
 
-    assert(lexer != NULL);
-    assert(lexer->buffer != NULL);
-    assert(outToken != NULL);
+    assert(splitter != NULL);
+    assert(token != NULL);
 
-    if (lexer->finished || lexer->inputIndex >= lexer->inputSize) {
-        return SIMPLE_LEXER_EOF;
+    if (splitter->numWords >= INT_MAX
+        || token->length >= SIZE_MAX - splitter->textSize)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    if (splitter->numWords + 2 > splitter->numSlots
+        || token->length >= splitter->textCapacity - splitter->textSize)
+    {
+        error = SimpleLineSplitter_Grow(splitter, splitter->numWords + 2,
+            splitter->textSize + token->length + 1);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            return error;
+        }
     }
-    assert(lexer->input != NULL);
 
-    for (c = lexer->input[lexer->inputIndex];
-        lexer->inputIndex < lexer->inputSize;
-        c = lexer->input[++lexer->inputIndex])
+    text = (char*)(splitter->block + splitter->numSlots) + splitter->textSize;
+    (void) memcpy(text, token->text, token->length);
+    text[token->length] = '\0';
+    splitter->block[splitter->numWords] = text;
+    ++splitter->numWords;
+    splitter->textSize += token->length + 1;
+    splitter->lastLine = token->span.end.line;
+    return SIMPLE_LEXER_OK;
+}
+
+/*
+ * Forget the record that the splitter last returned, if any, and add the
+ * word that it set aside, if any, to the next record.
+ */
+static SimpleLexerError SimpleLineSplitter_StartRecord(
+    SimpleLineSplitter* splitter)
+{
+    SimpleLexerError error;
+
+    if (splitter->returned)
     {
-        /* c is at position lexer->currentPosition.
-           Don't advance lexer->currentPosition until we've consumed c. */
+        splitter->numWords = 0;
+        splitter->textSize = 0;
+        splitter->returned = 0;
+    }
 
-        if (lexer->inComment)
+    if (splitter->hasPending)
+    {
+        error = SimpleLineSplitter_AddWord(splitter, &splitter->pending);
+        if (error != SIMPLE_LEXER_OK)
         {
-            if (c == '\n')
-            {
-                lexer->inComment = 0;
-            }
+            return error;
         }
-        else if (lexer->escaping)
-        {
-            assert(lexer->inToken);
+        splitter->hasPending = 0;
+    }
+    return SIMPLE_LEXER_OK;
+}
 
-            char decodedChar;
-            switch (c)
-            {
-                case 'a': decodedChar = '\a'; break;
-                case 'b': decodedChar = '\b'; break;
-                case 'f': decodedChar = '\f'; break;
-                case 'n': decodedChar = '\n'; break;
-                case 'r': decodedChar = '\r'; break;
-                case 't': decodedChar = '\t'; break;
-                case 'v': decodedChar = '\v'; break;
-                default: decodedChar = c; break;
-            }
+/*
+ * Add a word to the splitter's record or, if the word is on a later line,
+ * set it aside for the next record.  This returns SIMPLE_LEXER_EOF if the
+ * word completed the record.  The lexer's buffer holds set-aside words
+ * until the next lexing call, which happens only after
+ * SimpleLineSplitter_StartRecord() copies them.
+ */
+static SimpleLexerError SimpleLineSplitter_TakeWord(
+    SimpleLineSplitter* restrict splitter,
+    const SimpleToken* restrict token)
+{
+    SimpleLexerError error;
 
-            if (SimpleLexer_AppendToBuffer(lexer, decodedChar))
-            {
-                return SIMPLE_LEXER_TOKEN_TOO_LARGE;
-            }
-            lexer->escaping = 0;
-        }
-        else if (c == '\n')
+    if (splitter->numWords != 0
+        && token->span.start.line > splitter->lastLine)
+    {
+        splitter->pending = *token;
+        splitter->hasPending = 1;
+        return SIMPLE_LEXER_EOF;
+    }
+
+    error = SimpleLineSplitter_AddWord(splitter, token);
+    if (error != SIMPLE_LEXER_OK)
+    {
+        /* Retry the word during the next call. */
+        splitter->pending = *token;
+        splitter->hasPending = 1;
+    }
+    return error;
+}
+
+/*
+ * Store the splitter's record in `argc` and `argv`.
+ */
+static void SimpleLineSplitter_ReturnRecord(
+    SimpleLineSplitter* restrict splitter,
+    int* restrict argc,
+    char*** restrict argv)
+{
+    assert(splitter->numWords != 0);
+
+    splitter->block[splitter->numWords] = NULL;
+    *argc = (int)splitter->numWords;
+    *argv = splitter->block;
+    splitter->returned = 1;
+}
+
+int SimpleLineSplitter_Init(
+    SimpleLineSplitter* restrict splitter,
+    const SimpleLexerAllocator* restrict allocator,
+    size_t maxWordSize)
+{
+    assert(splitter != NULL);
+    assert(maxWordSize != 0);
+
+    if (SimpleLexer_InitGrowable(&splitter->lexer, allocator,
+            maxWordSize < 64 ? maxWordSize : 64, maxWordSize) != 0)
+    {
+        return 1;
+    }
+
+    splitter->block = NULL;
+    splitter->numSlots = 0;
+    splitter->textCapacity = 0;
+    SimpleLineSplitter_Reset(splitter);
+    return 0;
+}
+
+void SimpleLineSplitter_SetInput(
+    SimpleLineSplitter* restrict splitter,
+    const char* restrict text,
+    size_t size)
+{
+    assert(splitter != NULL);
+
+    SimpleLexer_SetInput(&splitter->lexer, text, size);
+}
+
+SimpleLexerError SimpleLineSplitter_Next(
+    SimpleLineSplitter* restrict splitter,
+    int* restrict argc,
+    char*** restrict argv)
+{
+    SimpleLexer* lexer;
+    SimpleToken token;
+    SimpleLexerError error;
+
+    assert(splitter != NULL);
+    assert(argc != NULL);
+    assert(argv != NULL);
+
+    error = SimpleLineSplitter_StartRecord(splitter);
+    if (error != SIMPLE_LEXER_OK)
+    {
+        return error;
+    }
+
+    lexer = &splitter->lexer;
+    while ((error = SimpleLexer_GetNextToken(lexer, &token))
+        == SIMPLE_LEXER_OK)
+    {
+        error = SimpleLineSplitter_TakeWord(splitter, &token);
+        if (error == SIMPLE_LEXER_EOF)
         {
-            if (lexer->inToken)
-            {
-                if (lexer->tokenIsQuoted)
-                {
-                    if (SimpleLexer_AppendToBuffer(lexer, c))
-                    {
-                        return SIMPLE_LEXER_TOKEN_TOO_LARGE;
-                    }
-                }
-                else
-                {
-                    SimpleLexer_FinishToken(lexer, outToken, 0);
-                    SimpleLexer_AdvanceLine(lexer);
-                    ++lexer->inputIndex;
-                    return SIMPLE_LEXER_OK;
-                }
-            }
+            SimpleLineSplitter_ReturnRecord(splitter, argc, argv);
+            return SIMPLE_LEXER_OK;
         }
-        else if (isspace(c) || c == '\0')
+        if (error != SIMPLE_LEXER_OK)
         {
-            if (lexer->inToken)
-            {
-                if (lexer->tokenIsQuoted)
-                {
-                    if (SimpleLexer_AppendToBuffer(lexer, c))
-                    {
-                        return SIMPLE_LEXER_TOKEN_TOO_LARGE;
-                    }
-                }
-                else
-                {
-                    SimpleLexer_FinishToken(lexer, outToken, 0);
-                    ++lexer->currentPosition.column;
-                    ++lexer->inputIndex;
-                    return SIMPLE_LEXER_OK;
-                }
-            }
+            return error;
         }
-        else if (c == '"')
+    }
+
+    /* A newline that the lexer consumed outside of any word since the
+       record's last word ends the record without waiting for the rest of
+       the next word, if any. */
+    if (error == SIMPLE_LEXER_EOF && splitter->numWords != 0
+        && (lexer->state == SIMPLE_LEXER_STATE_NORMAL
+            || lexer->state == SIMPLE_LEXER_STATE_COMMENT
+            ? lexer->currentPosition.line
+            : lexer->tokenStart.line) > splitter->lastLine)
+    {
+        SimpleLineSplitter_ReturnRecord(splitter, argc, argv);
+        return SIMPLE_LEXER_OK;
+    }
+    return error;
+}
+
+SimpleLexerError SimpleLineSplitter_Finish(
+    SimpleLineSplitter* restrict splitter,
+    int* restrict argc,
+    char*** restrict argv)
+{
+    SimpleToken token;
+    SimpleLexerError error;
+
+    assert(splitter != NULL);
+    assert(argc != NULL);
+    assert(argv != NULL);
+
+    error = SimpleLineSplitter_StartRecord(splitter);
+    if (error != SIMPLE_LEXER_OK)
+    {
+        return error;
+    }
+
+    if (!splitter->lexer.finished)
+    {
+        token.text = NULL;
+        splitter->finishError = SimpleLexer_Finish(&splitter->lexer, &token);
+        if (token.text != NULL)
         {
-            if (lexer->inToken)
+            error = SimpleLineSplitter_TakeWord(splitter, &token);
+            if (error == SIMPLE_LEXER_EOF)
             {
-                if (lexer->tokenIsQuoted)
-                {
-                    SimpleLexer_FinishToken(lexer, outToken, 1);
-                    ++lexer->currentPosition.column;
-                    ++lexer->inputIndex;
-                }
-                else
-                {
-                    SimpleLexer_FinishToken(lexer, outToken, 0);
-                }
+                SimpleLineSplitter_ReturnRecord(splitter, argc, argv);
                 return SIMPLE_LEXER_OK;
             }
-            else
+            if (error != SIMPLE_LEXER_OK)
             {
-                SimpleLexer_StartToken(lexer, 1, 0);
+                return error;
             }
         }
-        else if (c == '\\')
+    }
+
+    error = splitter->finishError;
+    splitter->finishError = SIMPLE_LEXER_EOF;
+    if (splitter->numWords == 0)
+    {
+        *argc = 0;
+        *argv = NULL;
+        return error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error;
+    }
+
+    SimpleLineSplitter_ReturnRecord(splitter, argc, argv);
+    return error == SIMPLE_LEXER_EOF ? SIMPLE_LEXER_OK : error;
+}
+
+void SimpleLineSplitter_Reset(SimpleLineSplitter* splitter)
+{
+    assert(splitter != NULL);
+
+    SimpleLexer_Reset(&splitter->lexer);
+    splitter->textSize = 0;
+    splitter->numWords = 0;
+    splitter->lastLine = 0;
+    splitter->hasPending = 0;
+    splitter->returned = 0;
+    splitter->finishError = SIMPLE_LEXER_EOF;
+}
+
+void SimpleLineSplitter_Destroy(SimpleLineSplitter* splitter)
+{
+    const SimpleLexerAllocator* allocator;
+
+    assert(splitter != NULL);
+
+    if (splitter->block != NULL)
+    {
+        allocator = &splitter->lexer.allocator;
+        allocator->deallocate(allocator->context, splitter->block,
+            splitter->numSlots * sizeof(char*) + splitter->textCapacity);
+        splitter->block = NULL;
+    }
+    SimpleLexer_Destroy(&splitter->lexer);
+}
+
+/*
+ * This is the most bytes that a varint-encoded newline distance can take.
+ */
+#define SIMPLE_LINE_INDEX_MAX_VARINT_SIZE ((sizeof(size_t) * 8 + 6) / 7)
+
+void SimpleLineIndex_Init(
+    SimpleLineIndex* restrict index,
+    const SimpleLexerAllocator* restrict allocator)
+{
+    assert(index != NULL);
+
+    index->blocks = NULL;
+    index->numBlocks = 0;
+    index->blockCapacity = 0;
+    index->deltas = NULL;
+    index->deltasSize = 0;
+    index->deltasCapacity = 0;
+    index->numNewlines = 0;
+    index->lastNewline = 0;
+    index->size = 0;
+    index->allocator = allocator != NULL
+        ? *allocator
+        : SimpleLexer_StandardAllocator;
+}
+
+/*
+ * Record a newline at the stream offset `offset`, which must follow
+ * all of the newlines already in the index.
+ */
+static int SimpleLineIndex_AddNewline(SimpleLineIndex* index, size_t offset)
+{
+    SimpleLineIndexBlock* blocks;
+    unsigned char* deltas;
+    size_t distance;
+
+    if (index->numNewlines % SIMPLE_LINE_INDEX_BLOCK_LINES == 0)
+    {
+        if (index->numBlocks == index->blockCapacity)
         {
-            lexer->escaping = 1;
-            if (!lexer->inToken)
+            blocks = SimpleLexer_GrowArray(&index->allocator, index->blocks,
+                &index->blockCapacity, sizeof(*blocks), 16);
+            if (blocks == NULL)
             {
-                SimpleLexer_StartToken(lexer, 0, 1);
+                return 1;
             }
+            index->blocks = blocks;
         }
-        else if (c == '#')
+        index->blocks[index->numBlocks].firstNewline = offset;
+        index->blocks[index->numBlocks].deltasStart = index->deltasSize;
+        ++index->numBlocks;
+    }
+    else
+    {
+        if (index->deltasCapacity - index->deltasSize
+            < SIMPLE_LINE_INDEX_MAX_VARINT_SIZE)
         {
-            if (lexer->inToken && lexer->tokenIsQuoted)
-            {
-                if (SimpleLexer_AppendToBuffer(lexer, c))
-                {
-                    return SIMPLE_LEXER_TOKEN_TOO_LARGE;
-                }
-            }
-            else
+            deltas = SimpleLexer_GrowArray(&index->allocator, index->deltas,
+                &index->deltasCapacity, 1, 1024);
+            if (deltas == NULL)
             {
-                lexer->inComment = 1;
-                if (lexer->bufferLength != 0)
-                {
-                    SimpleLexer_FinishToken(lexer, outToken, 0);
-                    ++lexer->currentPosition.column;
-                    ++lexer->inputIndex;
-                    return SIMPLE_LEXER_OK;
-                }
+                return 1;
             }
+            index->deltas = deltas;
         }
-        else
+        distance = offset - index->lastNewline;
+        while (distance >= 0x80)
         {
-            if (!lexer->inToken)
-            {
-                SimpleLexer_StartToken(lexer, 0, 0);
-            }
-            if (SimpleLexer_AppendToBuffer(lexer, c))
-            {
-                return SIMPLE_LEXER_TOKEN_TOO_LARGE;
-            }
+            index->deltas[index->deltasSize++] =
+                (unsigned char)(distance | 0x80);
+            distance >>= 7;
         }
+        index->deltas[index->deltasSize++] = (unsigned char)distance;
+    }
 
-        /* Advance the lexer's current position in the stream. */
-        if (c == '\n')
+    index->lastNewline = offset;
+    ++index->numNewlines;
+    return 0;
+}
+
+/*
+ * Decode the newline distance at `*position` in `deltas`,
+ * advancing `*position` past it.
+ */
+static inline size_t SimpleLineIndex_Decode(
+    const unsigned char* restrict deltas,
+    size_t* restrict position)
+{
+    size_t distance;
+    unsigned shift;
+    unsigned char byte;
+
+    distance = 0;
+    shift = 0;
+    do
+    {
+        byte = deltas[(*position)++];
+        distance |= (size_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return distance;
+}
+
+/*
+ * Count the indexed newlines before `offset`.  If there are any,
+ * store the offset of the last of them in `lastNewline` and the end of its
+ * distance in the index's deltas in `deltasEnd`; otherwise, store zeros.
+ */
+static size_t SimpleLineIndex_Find(
+    const SimpleLineIndex* restrict index,
+    size_t offset,
+    size_t* restrict lastNewline,
+    size_t* restrict deltasEnd)
+{
+    size_t low;
+    size_t high;
+    size_t middle;
+    size_t block;
+    size_t numInBlock;
+    size_t count;
+    size_t newline;
+    size_t position;
+    size_t next;
+    size_t distance;
+
+    /* Find the first block whose first newline isn't before `offset`. */
+    low = 0;
+    high = index->numBlocks;
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (index->blocks[middle].firstNewline < offset)
         {
-            SimpleLexer_AdvanceLine(lexer);
+            low = middle + 1;
         }
         else
         {
-            ++lexer->currentPosition.column;
+            high = middle;
+        }
+    }
+    if (low == 0)
+    {
+        *lastNewline = 0;
+        *deltasEnd = 0;
+        return 0;
+    }
+
+    /* The newlines before `offset` end in the preceding block. */
+    block = low - 1;
+    numInBlock = index->numNewlines - block * SIMPLE_LINE_INDEX_BLOCK_LINES;
+    if (numInBlock > SIMPLE_LINE_INDEX_BLOCK_LINES)
+    {
+        numInBlock = SIMPLE_LINE_INDEX_BLOCK_LINES;
+    }
+    newline = index->blocks[block].firstNewline;
+    position = index->blocks[block].deltasStart;
+    for (count = 1; count < numInBlock; ++count)
+    {
+        next = position;
+        distance = SimpleLineIndex_Decode(index->deltas, &next);
+        if (newline + distance >= offset)
+        {
+            break;
         }
+        newline += distance;
+        position = next;
     }
 
-    return SIMPLE_LEXER_EOF;
+    *lastNewline = newline;
+    *deltasEnd = position;
+    return block * SIMPLE_LINE_INDEX_BLOCK_LINES + count;
 }
 
-SimpleLexerError SimpleLexer_Finish(
-    SimpleLexer* restrict lexer,
-    SimpleToken* restrict finalToken)
+/*
+ * Forget everything in the index at or after the offset `size`.
+ */
+static void SimpleLineIndex_Cut(SimpleLineIndex* index, size_t size)
 {
-    int error;
+    size_t lastNewline;
+    size_t deltasEnd;
 
-    assert(lexer != NULL);
-    assert(finalToken != NULL);
+    index->numNewlines = SimpleLineIndex_Find(index, size, &lastNewline,
+        &deltasEnd);
+    index->numBlocks = (index->numNewlines + SIMPLE_LINE_INDEX_BLOCK_LINES - 1)
+        / SIMPLE_LINE_INDEX_BLOCK_LINES;
+    index->deltasSize = deltasEnd;
+    index->lastNewline = lastNewline;
+    index->size = size;
+}
 
-    if (lexer->finished)
+/*
+ * Record the newlines in `text`, which starts at the end of the indexed
+ * stream.  Newlines are found 16 bytes at a time if possible.
+ */
+static int SimpleLineIndex_AddNewlines(
+    SimpleLineIndex* restrict index,
+    const char* restrict text,
+    size_t textSize)
+{
+    const char* newline;
+    size_t position;
+#ifdef SIMPLELEXER_SSE2
+    unsigned mask;
+#endif
+
+    position = 0;
+#ifdef SIMPLELEXER_SSE2
+    for (; position + 16 <= textSize; position += 16)
     {
-        return SIMPLE_LEXER_EOF;
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(
+            _mm_loadu_si128((const __m128i*)(text + position)),
+            _mm_set1_epi8('\n')));
+        while (mask != 0)
+        {
+            if (SimpleLineIndex_AddNewline(index, index->size + position
+                + SimpleLexer_TrailingZeros(mask)))
+            {
+                return 1;
+            }
+            mask &= mask - 1;
+        }
     }
+#endif
 
-    error = SIMPLE_LEXER_OK;
+    while (position < textSize
+        && (newline = memchr(text + position, '\n', textSize - position))
+            != NULL)
+    {
+        position = (size_t)(newline - text);
+        if (SimpleLineIndex_AddNewline(index, index->size + position))
+        {
+            return 1;
+        }
+        ++position;
+    }
+    return 0;
+}
+
+SimpleLexerError SimpleLineIndex_Add(
+    SimpleLineIndex* restrict index,
+    const char* restrict text,
+    size_t textSize)
+{
+    assert(index != NULL);
+    assert(text != NULL || textSize == 0);
 
-    if (lexer->escaping)
+    if (SimpleLineIndex_AddNewlines(index, text, textSize))
     {
-        error = SIMPLE_LEXER_ESCAPING_EOF;
+        SimpleLineIndex_Cut(index, index->size);
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
     }
+    index->size += textSize;
+    return SIMPLE_LEXER_OK;
+}
+
+void SimpleLineIndex_Truncate(SimpleLineIndex* index, size_t size)
+{
+    assert(index != NULL);
 
-    if (lexer->inToken && lexer->tokenIsQuoted)
+    if (size < index->size)
     {
-        error = SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN;
+        SimpleLineIndex_Cut(index, size);
+    }
+}
+
+int SimpleLineIndex_GetPosition(
+    const SimpleLineIndex* restrict index,
+    TextPosition* restrict position)
+{
+    size_t count;
+    size_t lastNewline;
+    size_t deltasEnd;
+
+    assert(index != NULL);
+    assert(position != NULL);
+
+    if (position->offset > index->size)
+    {
+        return 1;
     }
 
-    if (lexer->bufferLength != 0)
+    count = SimpleLineIndex_Find(index, position->offset, &lastNewline,
+        &deltasEnd);
+    position->line = count + 1;
+    position->column = count != 0
+        ? position->offset - lastNewline
+        : position->offset + 1;
+    return 0;
+}
+
+int SimpleLineIndex_GetLineStart(
+    const SimpleLineIndex* restrict index,
+    size_t line,
+    size_t* restrict offset)
+{
+    size_t newlineIndex;
+    size_t newline;
+    size_t position;
+    size_t remaining;
+
+    assert(index != NULL);
+    assert(offset != NULL);
+
+    if (line == 0 || line - 1 > index->numNewlines)
     {
-        SimpleLexer_FinishToken(lexer, finalToken, 0);
+        return 1;
     }
-    else if (error == SIMPLE_LEXER_OK)
+    if (line == 1)
     {
-        error = SIMPLE_LEXER_EOF;
+        *offset = 0;
+        return 0;
     }
 
-    lexer->finished = 1;
+    /* Line N starts just after the stream's (N - 1)th newline. */
+    newlineIndex = line - 2;
+    newline = index->blocks[newlineIndex / SIMPLE_LINE_INDEX_BLOCK_LINES]
+        .firstNewline;
+    position = index->blocks[newlineIndex / SIMPLE_LINE_INDEX_BLOCK_LINES]
+        .deltasStart;
+    for (remaining = newlineIndex % SIMPLE_LINE_INDEX_BLOCK_LINES;
+        remaining != 0; --remaining)
+    {
+        newline += SimpleLineIndex_Decode(index->deltas, &position);
+    }
+    *offset = newline + 1;
+    return 0;
+}
 
-    return error;
+void SimpleLineIndex_Reset(SimpleLineIndex* index)
+{
+    assert(index != NULL);
+
+    index->numBlocks = 0;
+    index->deltasSize = 0;
+    index->numNewlines = 0;
+    index->lastNewline = 0;
+    index->size = 0;
 }
 
+void SimpleLineIndex_Destroy(SimpleLineIndex* index)
+{
+    SimpleLexerAllocator allocator;
+
+    assert(index != NULL);
+
+    if (index->blocks != NULL)
+    {
+        index->allocator.deallocate(index->allocator.context, index->blocks,
+            index->blockCapacity * sizeof(*index->blocks));
+    }
+    if (index->deltas != NULL)
+    {
+        index->allocator.deallocate(index->allocator.context, index->deltas,
+            index->deltasCapacity);
+    }
+    allocator = index->allocator;
+    SimpleLineIndex_Init(index, &allocator);
+}
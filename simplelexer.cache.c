@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "simplelexer.cache.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define SIMPLE_TOKEN_CACHE_BYTE_ORDER UINT64_C(0x0102030405060708)
+
+static const char SimpleTokenCache_Magic[8] = "SLXTOKC";
+
+/*
+ * Hash `length` bytes of `text` sixteen bytes at a time in two independent
+ * lanes.  This detects changes to the source text, not tampering.
+ */
+static uint64_t SimpleTokenCache_Hash(
+    const char* text,
+    size_t length,
+    uint64_t seed)
+{
+    uint64_t lanes[2];
+    uint64_t words[2];
+
+    lanes[0] = seed ^ length;
+    lanes[1] = ~seed;
+    for (; length >= 16; text += 16, length -= 16)
+    {
+        (void) memcpy(words, text, 16);
+        lanes[0] = (lanes[0] ^ words[0]) * UINT64_C(0xff51afd7ed558ccd);
+        lanes[0] ^= lanes[0] >> 32;
+        lanes[1] = (lanes[1] ^ words[1]) * UINT64_C(0xc4ceb9fe1a85ec53);
+        lanes[1] ^= lanes[1] >> 29;
+    }
+    words[0] = 0;
+    words[1] = 0;
+    (void) memcpy(words, text, length);
+    lanes[0] = (lanes[0] ^ words[0]) * UINT64_C(0xff51afd7ed558ccd);
+    lanes[1] = (lanes[1] ^ words[1]) * UINT64_C(0xc4ceb9fe1a85ec53);
+    lanes[0] ^= (lanes[1] << 31) | (lanes[1] >> 33);
+    lanes[0] *= UINT64_C(0x9e3779b97f4a7c15);
+    return lanes[0] ^ (lanes[0] >> 29);
+}
+
+/*
+ * Hash what determines which tokens `lexer` produces from a text.
+ */
+static uint64_t SimpleTokenCache_HashLanguage(const SimpleLexer* lexer)
+{
+    uint64_t hash;
+    uint64_t limits[2];
+
+    hash = SimpleTokenCache_Hash((const char*)lexer->dialect->classes,
+        sizeof(lexer->dialect->classes),
+        (uint64_t)lexer->positionTracking | (uint64_t)lexer->utf8 << 8
+            | (uint64_t)lexer->columns << 16
+            | (uint64_t)lexer->tabWidth << 24);
+    hash = SimpleTokenCache_Hash(lexer->dialect->escapes,
+        sizeof(lexer->dialect->escapes), hash);
+
+    /* The token buffer's size decides which tokens are too large and,
+       in fragment mode, where tokens are split. */
+    limits[0] = (uint64_t)lexer->fragments;
+    limits[1] = (uint64_t)lexer->maxBufferCapacity;
+    return SimpleTokenCache_Hash((const char*)limits, sizeof(limits), hash);
+}
+
+/*
+ * This collects the tokens that a lexer produces for a cache file
+ * and optionally passes them on to a handler.
+ */
+typedef struct SimpleTokenCacheBuilder {
+    SimpleLexer* lexer;
+    SimpleCachedToken* tokens;
+    size_t numTokens;
+    size_t tokenCapacity;       /* in tokens */
+    char* strings;
+    size_t stringsSize;
+    size_t stringsCapacity;     /* in bytes */
+    SimpleTokenHandler handler; /* NULL if tokens aren't passed on */
+    void* context;              /* the handler's context */
+    char outOfMemory;           /* set if collecting a token failed, after
+                                   which no more tokens are collected */
+} SimpleTokenCacheBuilder;
+
+/*
+ * Grow the array `*array` of `*capacity` elements of `elementSize` bytes
+ * geometrically so that it holds at least `minCapacity` elements.
+ * This returns nonzero if allocating memory failed.
+ */
+static int SimpleTokenCache_Grow(
+    void** array,
+    size_t* capacity,
+    size_t minCapacity,
+    size_t elementSize)
+{
+    size_t newCapacity;
+    void* newArray;
+
+    if (minCapacity <= *capacity)
+    {
+        return 0;
+    }
+
+    newCapacity = *capacity != 0 ? *capacity : 64;
+    while (newCapacity < minCapacity)
+    {
+        if (newCapacity > SIZE_MAX / 2)
+        {
+            return 1;
+        }
+        newCapacity *= 2;
+    }
+    if (newCapacity > SIZE_MAX / elementSize)
+    {
+        return 1;
+    }
+
+    newArray = realloc(*array, newCapacity * elementSize);
+    if (newArray == NULL)
+    {
+        return 1;
+    }
+    *array = newArray;
+    *capacity = newCapacity;
+    return 0;
+}
+
+/*
+ * Collect `token`.  This returns nonzero if allocating memory failed.
+ */
+static int SimpleTokenCacheBuilder_Collect(
+    SimpleTokenCacheBuilder* restrict builder,
+    const SimpleToken* restrict token)
+{
+    SimpleCachedToken* record;
+
+    if (SimpleTokenCache_Grow((void**)&builder->tokens,
+            &builder->tokenCapacity, builder->numTokens + 1,
+            sizeof(*builder->tokens))
+        || token->length >= SIZE_MAX - builder->stringsSize
+        || SimpleTokenCache_Grow((void**)&builder->strings,
+            &builder->stringsCapacity,
+            builder->stringsSize + token->length + 1, 1))
+    {
+        return 1;
+    }
+
+    record = &builder->tokens[builder->numTokens];
+    (void) memset(record, 0, sizeof(*record));
+    record->text = builder->stringsSize;
+    record->length = token->length;
+    record->startLine = token->span.start.line;
+    record->startColumn = token->span.start.column;
+    record->startOffset = token->span.start.offset;
+    record->endLine = token->span.end.line;
+    record->endColumn = token->span.end.column;
+    record->endOffset = token->span.end.offset;
+
+    /* The lexer's flag still describes the token that it just finished. */
+    record->flags = (token->quoted ? SIMPLE_CACHED_TOKEN_QUOTED : 0)
+        | (token->startedEscaped ? SIMPLE_CACHED_TOKEN_STARTED_ESCAPED : 0)
+        | (builder->lexer->tokenEscaped ? SIMPLE_CACHED_TOKEN_ESCAPED : 0)
+        | (token->firstFragment ? SIMPLE_CACHED_TOKEN_FIRST_FRAGMENT : 0)
+        | (token->lastFragment ? SIMPLE_CACHED_TOKEN_LAST_FRAGMENT : 0);
+    ++builder->numTokens;
+
+    (void) memcpy(builder->strings + builder->stringsSize, token->text,
+        token->length);
+    builder->strings[builder->stringsSize + token->length] = '\0';
+    builder->stringsSize += token->length + 1;
+    return 0;
+}
+
+/*
+ * Collect `token`, then pass it on to the builder's handler, if any.
+ * Builders without handlers stop lexing if they can't collect tokens;
+ * the others keep passing tokens on.  This is a SimpleTokenHandler.
+ */
+static int SimpleTokenCacheBuilder_Add(void* context, const SimpleToken* token)
+{
+    SimpleTokenCacheBuilder* builder = context;
+
+    if (!builder->outOfMemory
+        && SimpleTokenCacheBuilder_Collect(builder, token))
+    {
+        builder->outOfMemory = 1;
+    }
+    return builder->handler != NULL
+        ? builder->handler(builder->context, token)
+        : builder->outOfMemory;
+}
+
+/*
+ * Lex all `size` bytes of `text` with the builder's lexer, collecting
+ * the tokens, and finish the lexer.  This returns what SimpleLexer_LexFd()
+ * would.
+ */
+static SimpleLexerError SimpleTokenCacheBuilder_Lex(
+    SimpleTokenCacheBuilder* restrict builder,
+    const char* restrict text,
+    size_t size)
+{
+    SimpleLexerError error;
+    SimpleToken token;
+
+    error = SimpleLexer_Feed(builder->lexer, text, size,
+        SimpleTokenCacheBuilder_Add, builder);
+    if (error == SIMPLE_LEXER_EOF)
+    {
+        /* In fragment mode, the final token can come in fragments, too. */
+        do
+        {
+            token.text = NULL;
+            error = SimpleLexer_Finish(builder->lexer, &token);
+            if (token.text != NULL
+                && SimpleTokenCacheBuilder_Add(builder, &token))
+            {
+                return SIMPLE_LEXER_STOPPED;
+            }
+        } while (error == SIMPLE_LEXER_PARTIAL_TOKEN);
+        if (error == SIMPLE_LEXER_OK)
+        {
+            error = SIMPLE_LEXER_EOF;
+        }
+    }
+    return error;
+}
+
+static void SimpleTokenCacheBuilder_Destroy(SimpleTokenCacheBuilder* builder)
+{
+    free(builder->tokens);
+    free(builder->strings);
+}
+
+static int SimpleTokenCache_WriteAll(int fd, const void* data, size_t size)
+{
+    const char* bytes = data;
+    ssize_t written;
+
+    while (size != 0)
+    {
+        written = write(fd, bytes, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return 1;
+        }
+        bytes += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+/*
+ * Write the builder's tokens to a temporary file beside `path`, then rename
+ * the temporary file to `path` so that readers never see partial caches.
+ * `error` is what lexing `text` ended with.  This returns nonzero and sets
+ * errno if writing failed.
+ */
+static int SimpleTokenCacheBuilder_Save(
+    const SimpleTokenCacheBuilder* restrict builder,
+    const char* restrict path,
+    const char* restrict text,
+    size_t size,
+    SimpleLexerError error)
+{
+    SimpleTokenCacheHeader header;
+    char* temporaryPath;
+    size_t pathLength;
+    int fd;
+    int result;
+    int savedErrno;
+
+    (void) memset(&header, 0, sizeof(header));
+    (void) memcpy(header.magic, SimpleTokenCache_Magic, sizeof(header.magic));
+    header.version = SIMPLE_TOKEN_CACHE_VERSION;
+    header.recordSize = sizeof(SimpleCachedToken);
+    header.byteOrder = SIMPLE_TOKEN_CACHE_BYTE_ORDER;
+    header.sourceSize = size;
+    header.sourceHash = SimpleTokenCache_Hash(text, size, 0);
+    header.languageHash = SimpleTokenCache_HashLanguage(builder->lexer);
+    header.numTokens = builder->numTokens;
+    header.stringsSize = builder->stringsSize;
+    header.error = (uint32_t)error;
+
+    pathLength = strlen(path);
+    temporaryPath = malloc(pathLength + sizeof(".XXXXXX"));
+    if (temporaryPath == NULL)
+    {
+        return 1;
+    }
+    (void) memcpy(temporaryPath, path, pathLength);
+    (void) memcpy(temporaryPath + pathLength, ".XXXXXX", sizeof(".XXXXXX"));
+
+    fd = mkstemp(temporaryPath);
+    if (fd < 0)
+    {
+        savedErrno = errno;
+        free(temporaryPath);
+        errno = savedErrno;
+        return 1;
+    }
+
+    result = SimpleTokenCache_WriteAll(fd, &header, sizeof(header))
+        || SimpleTokenCache_WriteAll(fd, builder->tokens,
+            builder->numTokens * sizeof(*builder->tokens))
+        || SimpleTokenCache_WriteAll(fd, builder->strings,
+            builder->stringsSize);
+    savedErrno = errno;
+    if (close(fd) != 0 && result == 0)
+    {
+        savedErrno = errno;
+        result = 1;
+    }
+    if (result == 0 && rename(temporaryPath, path) != 0)
+    {
+        savedErrno = errno;
+        result = 1;
+    }
+    if (result != 0)
+    {
+        (void) unlink(temporaryPath);
+    }
+
+    free(temporaryPath);
+    errno = savedErrno;
+    return result;
+}
+
+SimpleLexerError SimpleTokenCache_Write(
+    const char* restrict path,
+    SimpleLexer* restrict lexer,
+    const char* restrict text,
+    size_t size)
+{
+    SimpleTokenCacheBuilder builder;
+    SimpleLexerError error;
+
+    assert(path != NULL);
+    assert(lexer != NULL);
+    assert(text != NULL);
+
+    (void) memset(&builder, 0, sizeof(builder));
+    builder.lexer = lexer;
+    error = SimpleTokenCacheBuilder_Lex(&builder, text, size);
+    if (builder.outOfMemory)
+    {
+        error = SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    else if ((error == SIMPLE_LEXER_EOF || error == SIMPLE_LEXER_ESCAPING_EOF
+            || error == SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN)
+        && SimpleTokenCacheBuilder_Save(&builder, path, text, size, error))
+    {
+        error = SIMPLE_LEXER_IO_ERROR;
+    }
+    SimpleTokenCacheBuilder_Destroy(&builder);
+    return error;
+}
+
+/*
+ * Return nonzero if the mapped cache file `file` is intact and holds
+ * the tokens that `lexer` would produce from the `size` bytes of `text`.
+ */
+static int SimpleTokenCache_Matches(
+    const SimpleMappedFile* restrict file,
+    const SimpleLexer* restrict lexer,
+    const char* restrict text,
+    size_t size)
+{
+    const SimpleTokenCacheHeader* header;
+    const SimpleCachedToken* tokens;
+    const char* strings;
+    size_t index;
+    size_t recordsSize;
+
+    /* Check the header first: it's cheap, unlike hashing the text. */
+    if (file->size < sizeof(*header))
+    {
+        return 0;
+    }
+    header = (const SimpleTokenCacheHeader*)file->data;
+    if (memcmp(header->magic, SimpleTokenCache_Magic,
+            sizeof(header->magic)) != 0
+        || header->version != SIMPLE_TOKEN_CACHE_VERSION
+        || header->recordSize != sizeof(SimpleCachedToken)
+        || header->byteOrder != SIMPLE_TOKEN_CACHE_BYTE_ORDER
+        || header->sourceSize != size
+        || (header->error != SIMPLE_LEXER_EOF
+            && header->error != SIMPLE_LEXER_ESCAPING_EOF
+            && header->error != SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN)
+        || header->languageHash != SimpleTokenCache_HashLanguage(lexer)
+        || header->numTokens > (file->size - sizeof(*header))
+            / sizeof(SimpleCachedToken))
+    {
+        return 0;
+    }
+    recordsSize = (size_t)header->numTokens * sizeof(SimpleCachedToken);
+    if (header->stringsSize != file->size - sizeof(*header) - recordsSize
+        || header->sourceHash != SimpleTokenCache_Hash(text, size, 0))
+    {
+        return 0;
+    }
+
+    /* Every token's text must be NUL-terminated within the blob. */
+    tokens = (const SimpleCachedToken*)(file->data + sizeof(*header));
+    strings = file->data + sizeof(*header) + recordsSize;
+    for (index = 0; index < header->numTokens; ++index)
+    {
+        if (tokens[index].text >= header->stringsSize
+            || tokens[index].length
+                >= header->stringsSize - tokens[index].text
+            || strings[tokens[index].text + tokens[index].length] != '\0')
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int SimpleTokenCache_Open(
+    SimpleTokenCache* restrict cache,
+    const char* restrict path,
+    const SimpleLexer* restrict lexer,
+    const char* restrict text,
+    size_t size)
+{
+    const SimpleTokenCacheHeader* header;
+
+    assert(cache != NULL);
+    assert(path != NULL);
+    assert(lexer != NULL);
+    assert(text != NULL);
+
+    if (SimpleLexer_OpenMapped(&cache->file, path))
+    {
+        return 1;
+    }
+    if (!SimpleTokenCache_Matches(&cache->file, lexer, text, size))
+    {
+        SimpleLexer_CloseMapped(&cache->file);
+        return 1;
+    }
+
+    /* Mappings are page-aligned, so the records are aligned, too. */
+    header = (const SimpleTokenCacheHeader*)cache->file.data;
+    cache->tokens = (const SimpleCachedToken*)
+        (cache->file.data + sizeof(*header));
+    cache->numTokens = (size_t)header->numTokens;
+    cache->strings = (const char*)(cache->tokens + cache->numTokens);
+    cache->error = (SimpleLexerError)header->error;
+    return 0;
+}
+
+void SimpleTokenCache_GetToken(
+    const SimpleTokenCache* restrict cache,
+    size_t index,
+    SimpleToken* restrict token)
+{
+    const SimpleCachedToken* record;
+
+    assert(cache != NULL);
+    assert(index < cache->numTokens);
+    assert(token != NULL);
+
+    record = &cache->tokens[index];
+    token->text = (char*)(cache->strings + record->text);
+    token->length = (size_t)record->length;
+    token->span.start.line = (size_t)record->startLine;
+    token->span.start.column = (size_t)record->startColumn;
+    token->span.start.offset = (size_t)record->startOffset;
+    token->span.end.line = (size_t)record->endLine;
+    token->span.end.column = (size_t)record->endColumn;
+    token->span.end.offset = (size_t)record->endOffset;
+    token->quoted = (record->flags & SIMPLE_CACHED_TOKEN_QUOTED) != 0;
+    token->startedEscaped =
+        (record->flags & SIMPLE_CACHED_TOKEN_STARTED_ESCAPED) != 0;
+    token->isView = 0;
+    token->firstFragment =
+        (record->flags & SIMPLE_CACHED_TOKEN_FIRST_FRAGMENT) != 0;
+    token->lastFragment =
+        (record->flags & SIMPLE_CACHED_TOKEN_LAST_FRAGMENT) != 0;
+    token->symbol = SIMPLE_SYMBOL_NONE;
+    token->keyword = SIMPLE_KEYWORD_NONE;
+}
+
+void SimpleTokenCache_Close(SimpleTokenCache* cache)
+{
+    assert(cache != NULL);
+
+    SimpleLexer_CloseMapped(&cache->file);
+    cache->tokens = NULL;
+    cache->numTokens = 0;
+    cache->strings = NULL;
+}
+
+SimpleLexerError SimpleLexer_LexCached(
+    SimpleLexer* lexer,
+    const char* path,
+    const char* text,
+    size_t size,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    SimpleTokenCache cache;
+    SimpleTokenCacheBuilder builder;
+    SimpleToken token;
+    SimpleLexerError error;
+    size_t index;
+    int isWhole;
+
+    assert(lexer != NULL);
+    assert(path != NULL);
+    assert(text != NULL);
+    assert(handler != NULL);
+
+    if (SimpleTokenCache_Open(&cache, path, lexer, text, size) == 0)
+    {
+        error = cache.error;
+        for (index = 0; index < cache.numTokens; ++index)
+        {
+            SimpleTokenCache_GetToken(&cache, index, &token);
+
+            /* As when lexing, fragments' texts aren't their tokens'. */
+            isWhole = token.firstFragment && token.lastFragment;
+            if (lexer->symbols != NULL && isWhole)
+            {
+                token.symbol = SimpleSymbolTable_Intern(lexer->symbols,
+                    token.text, token.length);
+            }
+            if (lexer->keywords != NULL && isWhole
+                && (cache.tokens[index].flags & (SIMPLE_CACHED_TOKEN_QUOTED
+                    | SIMPLE_CACHED_TOKEN_ESCAPED)) == 0)
+            {
+                token.keyword = SimpleKeywordSet_Find(lexer->keywords,
+                    token.text, token.length);
+            }
+            if (handler(context, &token))
+            {
+                error = SIMPLE_LEXER_STOPPED;
+                break;
+            }
+        }
+        SimpleTokenCache_Close(&cache);
+        return error;
+    }
+
+    /* The cache is missing or stale, so lex the text and replace it. */
+    (void) memset(&builder, 0, sizeof(builder));
+    builder.lexer = lexer;
+    builder.handler = handler;
+    builder.context = context;
+    error = SimpleTokenCacheBuilder_Lex(&builder, text, size);
+    if (!builder.outOfMemory
+        && (error == SIMPLE_LEXER_EOF || error == SIMPLE_LEXER_ESCAPING_EOF
+            || error == SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN))
+    {
+        (void) SimpleTokenCacheBuilder_Save(&builder, path, text, size, error);
+    }
+    SimpleTokenCacheBuilder_Destroy(&builder);
+    return error;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a cache of lexed token streams in a compact binary format that can
+ * be mapped into memory and read without copying or lexing anything.
+ * Unlike the rest of SimpleLexer, it depends on POSIX (open(), mmap(),
+ * rename(), and friends) and on simplelexer.file.c.
+ *
+ * A cache file holds, in the writer's byte order:
+ *
+ *    o  a SimpleTokenCacheHeader, which identifies the source text by its
+ *       size and a 64-bit hash of its contents and the language that it was
+ *       lexed in by a hash of the lexer's dialect, position tracking, and
+ *       token buffer size and fragment mode;
+ *
+ *    o  `numTokens` SimpleCachedToken records; and
+ *
+ *    o  a blob of `stringsSize` bytes holding the tokens' NUL-terminated
+ *       texts.
+ *
+ * Readers reject files written on machines with other byte orders
+ * or structure layouts, so such files are merely cache misses.
+ */
+
+#ifndef __SIMPLELEXER_CACHE_H
+#define __SIMPLELEXER_CACHE_H
+
+#include "simplelexer.file.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * This is the version of the cache format that this code reads and writes.
+ */
+#define SIMPLE_TOKEN_CACHE_VERSION 2
+
+typedef struct SimpleTokenCacheHeader {
+    char magic[8];              /* "SLXTOKC" and a NUL */
+    uint32_t version;           /* SIMPLE_TOKEN_CACHE_VERSION */
+    uint32_t recordSize;        /* sizeof(SimpleCachedToken) */
+    uint64_t byteOrder;         /* 0x0102030405060708 in the writer's order */
+    uint64_t sourceSize;        /* the source text's size in bytes */
+    uint64_t sourceHash;        /* a hash of the source text */
+    uint64_t languageHash;      /* a hash of the lexer's language */
+    uint64_t numTokens;         /* the number of token records */
+    uint64_t stringsSize;       /* the size of the string blob in bytes */
+    uint32_t error;             /* what lexing the source ended with:
+                                   SIMPLE_LEXER_EOF or an error that
+                                   SimpleLexer_Finish() returns */
+    uint32_t reserved;          /* zero */
+} SimpleTokenCacheHeader;
+
+/*
+ * These are the bits of SimpleCachedToken's flags.
+ */
+#define SIMPLE_CACHED_TOKEN_QUOTED 1u           /* see SimpleToken */
+#define SIMPLE_CACHED_TOKEN_STARTED_ESCAPED 2u  /* see SimpleToken */
+#define SIMPLE_CACHED_TOKEN_ESCAPED 4u          /* the token contains escape
+                                                   sequences */
+#define SIMPLE_CACHED_TOKEN_FIRST_FRAGMENT 8u   /* see SimpleToken */
+#define SIMPLE_CACHED_TOKEN_LAST_FRAGMENT 16u   /* see SimpleToken */
+
+/*
+ * This is a token in a cache file.  Its span is the one that the lexer
+ * produced for it.
+ */
+typedef struct SimpleCachedToken {
+    uint64_t text;              /* the token's offset in the string blob */
+    uint64_t length;            /* the token's length, excluding its NUL */
+    uint64_t startLine;
+    uint64_t startColumn;
+    uint64_t startOffset;
+    uint64_t endLine;
+    uint64_t endColumn;
+    uint64_t endOffset;
+    uint32_t flags;             /* SIMPLE_CACHED_TOKEN_* bits */
+    uint32_t reserved;          /* zero */
+} SimpleCachedToken;
+
+/*
+ * This is an open cache file.  Its tokens and strings point into
+ * the file's memory mapping.
+ *
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleTokenCache {
+    SimpleMappedFile file;
+    const SimpleCachedToken* tokens;
+    size_t numTokens;
+    const char* strings;
+    SimpleLexerError error;     /* what lexing the source ended with */
+} SimpleTokenCache;
+
+/*
+ * Lex all `size` bytes of `text` with `lexer` and write the tokens to a cache
+ * file at `path`, replacing any file there atomically.  The lexer must be
+ * freshly initialized (or reset), and it's finished afterwards.  Its dialect,
+ * position tracking, maximum token buffer size, and fragment mode are
+ * recorded so that only lexers that would produce the same tokens use
+ * the cache.  In fragment mode, fragments are cached as separate tokens.
+ *
+ * This returns SIMPLE_LEXER_EOF if it lexed the whole text without errors
+ * and SIMPLE_LEXER_ESCAPING_EOF or SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN
+ * if SimpleLexer_Finish() did; the cache records these errors.  It returns
+ * SIMPLE_LEXER_IO_ERROR (with errno set) if writing failed and any other
+ * lexing errors as SimpleLexer_GetNextToken() returns them, in which cases
+ * it writes nothing.
+ */
+extern SimpleLexerError SimpleTokenCache_Write(
+    const char* SIMPLELEXER_RESTRICT path,
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size);
+
+/*
+ * Map the cache file at `path` if it holds the tokens that `lexer` would
+ * produce from the `size` bytes of `text`: if the file is intact and its
+ * source size, source hash, and language match.  The lexer isn't modified.
+ *
+ * This returns zero on success.  It returns nonzero if the file doesn't
+ * match or can't be used, setting errno if it couldn't be opened or mapped.
+ * Close opened caches via SimpleTokenCache_Close().
+ */
+extern int SimpleTokenCache_Open(
+    SimpleTokenCache* SIMPLELEXER_RESTRICT cache,
+    const char* SIMPLELEXER_RESTRICT path,
+    const SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size);
+
+/*
+ * Store the cache's token at `index` in `token`.  The token's text points
+ * into the cache's read-only mapping, so it's valid until the cache is
+ * closed and must not be modified.  The text is NUL-terminated, and it's
+ * not in the lexed text, so the token's isView field is zero.  Its
+ * symbol and keyword are SIMPLE_SYMBOL_NONE and SIMPLE_KEYWORD_NONE.
+ */
+extern void SimpleTokenCache_GetToken(
+    const SimpleTokenCache* SIMPLELEXER_RESTRICT cache,
+    size_t index,
+    SimpleToken* SIMPLELEXER_RESTRICT token);
+
+/*
+ * Unmap a cache opened by SimpleTokenCache_Open().
+ */
+extern void SimpleTokenCache_Close(SimpleTokenCache* cache);
+
+/*
+ * Pass each token that `lexer` would produce from the `size` bytes of `text`
+ * to `handler`, reading them from the cache file at `path` if it matches
+ * (see SimpleTokenCache_Open()).  Tokens read from the cache are interned in
+ * and classified by the lexer's symbol table and keywords, if any, except
+ * for fragments, as when lexing; the lexer is otherwise unused.  Their texts
+ * are valid only until `handler` returns, as lexers' token buffers are
+ * (see SimpleTokenCache_GetToken()).
+ *
+ * If the cache doesn't match, this lexes the text with `lexer` (which must be
+ * freshly initialized or reset) instead and, if lexing reaches the end of
+ * the text, rewrites the cache.  Failing to rewrite the cache isn't an error.
+ *
+ * This returns what SimpleLexer_LexFd() would for the text, except that
+ * it never returns SIMPLE_LEXER_IO_ERROR.
+ */
+extern SimpleLexerError SimpleLexer_LexCached(
+    SimpleLexer* lexer,
+    const char* path,
+    const char* text,
+    size_t size,
+    SimpleTokenHandler handler,
+    void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SIMPLELEXER_CACHE_H */
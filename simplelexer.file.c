@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "simplelexer.file.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* the size of the chunks read from files that can't be mapped */
+#define SIMPLE_LEXER_FILE_CHUNK_SIZE (64 * 1024)
+
+/*
+ * Map `size` bytes of the regular file `fd` and advise the kernel
+ * that they'll be read once from front to back.
+ */
+static int SimpleLexer_MapFd(
+    SimpleMappedFile* restrict file,
+    int fd,
+    size_t size)
+{
+    void* data;
+
+    /* mmap() rejects empty mappings. */
+    if (size == 0)
+    {
+        file->data = "";
+        file->size = 0;
+        return 0;
+    }
+
+    data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        return 1;
+    }
+
+    /* These are only hints, so ignore failures. */
+    (void) posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    (void) posix_madvise(data, size, POSIX_MADV_WILLNEED);
+
+    file->data = data;
+    file->size = size;
+    return 0;
+}
+
+/*
+ * Store the size of `fd` in `size` if it's a nonempty regular file that can be
+ * mapped and zero otherwise.  This returns nonzero if fstat() failed.
+ */
+static int SimpleLexer_GetMappableSize(int fd, size_t* size)
+{
+    struct stat status;
+
+    if (fstat(fd, &status) != 0)
+    {
+        return 1;
+    }
+
+    /* Some special files (for example, those in Linux's /proc) claim to be
+       empty regular files but aren't, so they're read like pipes. */
+    if (!S_ISREG(status.st_mode) || status.st_size <= 0
+        || (uintmax_t)status.st_size > SIZE_MAX)
+    {
+        *size = 0;
+        return 0;
+    }
+
+    *size = (size_t)status.st_size;
+    return 0;
+}
+
+int SimpleLexer_OpenMapped(
+    SimpleMappedFile* restrict file,
+    const char* restrict path)
+{
+    int fd;
+    int result;
+    int savedErrno;
+    struct stat status;
+
+    assert(file != NULL);
+    assert(path != NULL);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    result = fstat(fd, &status);
+    if (result == 0 && !S_ISREG(status.st_mode))
+    {
+        errno = ENODEV;
+        result = 1;
+    }
+    else if (result == 0 && (uintmax_t)status.st_size > SIZE_MAX)
+    {
+        errno = EFBIG;
+        result = 1;
+    }
+    if (result == 0)
+    {
+        result = SimpleLexer_MapFd(file, fd, (size_t)status.st_size);
+    }
+
+    savedErrno = errno;
+    (void) close(fd);
+    errno = savedErrno;
+    return result;
+}
+
+void SimpleLexer_CloseMapped(SimpleMappedFile* file)
+{
+    assert(file != NULL);
+
+    if (file->size != 0)
+    {
+        (void) munmap((void*)file->data, file->size);
+    }
+    file->data = NULL;
+    file->size = 0;
+}
+
+/*
+ * Finish the lexer and pass its final token, if any, to `handler`.
+ */
+static SimpleLexerError SimpleLexer_HandleFinalToken(
+    SimpleLexer* lexer,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    SimpleLexerError error;
+    SimpleToken token;
+
+    /* In fragment mode, the final token can come in fragments, too. */
+    do
+    {
+        token.text = NULL;
+        error = SimpleLexer_Finish(lexer, &token);
+        if (token.text != NULL && handler(context, &token))
+        {
+            return SIMPLE_LEXER_STOPPED;
+        }
+    } while (error == SIMPLE_LEXER_PARTIAL_TOKEN);
+    return error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error;
+}
+
+static SimpleLexerError SimpleLexer_LexStream(
+    SimpleLexer* lexer,
+    int fd,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    char* chunk;
+    ssize_t chunkSize;
+    SimpleLexerError error;
+
+    chunk = malloc(SIMPLE_LEXER_FILE_CHUNK_SIZE);
+    if (chunk == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+
+    for (;;)
+    {
+        chunkSize = read(fd, chunk, SIMPLE_LEXER_FILE_CHUNK_SIZE);
+        if (chunkSize < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            error = SIMPLE_LEXER_IO_ERROR;
+            break;
+        }
+        if (chunkSize == 0)
+        {
+            error = SimpleLexer_HandleFinalToken(lexer, handler, context);
+            break;
+        }
+
+        error = SimpleLexer_Feed(lexer, chunk, (size_t)chunkSize, handler,
+            context);
+        if (error != SIMPLE_LEXER_EOF)
+        {
+            break;
+        }
+    }
+
+    free(chunk);
+    return error;
+}
+
+SimpleLexerError SimpleLexer_LexFd(
+    SimpleLexer* lexer,
+    int fd,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    SimpleMappedFile file;
+    SimpleLexerError error;
+    size_t size;
+    char tokenViews;
+
+    assert(lexer != NULL);
+    assert(handler != NULL);
+
+    if (SimpleLexer_GetMappableSize(fd, &size) != 0)
+    {
+        return SIMPLE_LEXER_IO_ERROR;
+    }
+
+    /* Views are for this call only: the caller's setting comes back. */
+    tokenViews = lexer->tokenViews;
+    SimpleLexer_SetTokenViews(lexer, 1);
+    if (size == 0 || SimpleLexer_MapFd(&file, fd, size) != 0)
+    {
+        error = SimpleLexer_LexStream(lexer, fd, handler, context);
+    }
+    else
+    {
+        error = SimpleLexer_Feed(lexer, file.data, file.size, handler,
+            context);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            error = SimpleLexer_HandleFinalToken(lexer, handler, context);
+        }
+        SimpleLexer_CloseMapped(&file);
+    }
+
+    SimpleLexer_SetTokenViews(lexer, tokenViews);
+    return error;
+}
+
+SimpleLexerError SimpleLexer_LexFile(
+    SimpleLexer* lexer,
+    const char* path,
+    SimpleTokenHandler handler,
+    void* context)
+{
+    int fd;
+    int savedErrno;
+    SimpleLexerError error;
+
+    assert(path != NULL);
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return SIMPLE_LEXER_IO_ERROR;
+    }
+
+    error = SimpleLexer_LexFd(lexer, fd, handler, context);
+
+    savedErrno = errno;
+    (void) close(fd);
+    errno = savedErrno;
+    return error;
+}
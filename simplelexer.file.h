@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * These are drivers that lex whole files.  Unlike the rest of SimpleLexer,
+ * they depend on POSIX (open(), read(), mmap(), and friends).
+ */
+
+#ifndef __SIMPLELEXER_FILE_H
+#define __SIMPLELEXER_FILE_H
+
+#include "simplelexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * This is a read-only memory mapping of a whole regular file.
+ */
+typedef struct SimpleMappedFile {
+    const char* data;           /* the file's contents */
+    size_t size;                /* the file's size in bytes */
+} SimpleMappedFile;
+
+/*
+ * Map the regular file at `path` into memory for sequential reading.
+ *
+ * This returns zero on success.  It returns nonzero and sets errno
+ * if the file can't be opened or mapped.  (errno is ENODEV if the file
+ * isn't a regular file.)  Close mapped files via SimpleLexer_CloseMapped().
+ */
+extern int SimpleLexer_OpenMapped(
+    SimpleMappedFile* SIMPLELEXER_RESTRICT file,
+    const char* SIMPLELEXER_RESTRICT path);
+
+/*
+ * Unmap a file mapped by SimpleLexer_OpenMapped().
+ */
+extern void SimpleLexer_CloseMapped(SimpleMappedFile* file);
+
+/*
+ * Lex all of the text that can be read from the file descriptor `fd`
+ * with `lexer`, passing each token to `handler`, then finish the lexer.
+ * The lexer must be freshly initialized (or reset).
+ *
+ * This uses token views while it lexes (see SimpleLexer_SetTokenViews()),
+ * so tokens without escape sequences aren't copied at all, and then restores
+ * the lexer's own setting, even if lexing fails.  Regular files are mapped
+ * into memory from their beginnings (regardless of `fd`'s file offset)
+ * and given to the lexer as a single input.  Pipes, sockets,
+ * terminals, and other files that can't be mapped are read in chunks.
+ * This doesn't close `fd`.
+ *
+ * This returns SIMPLE_LEXER_EOF if it lexed the whole stream without errors,
+ * SIMPLE_LEXER_STOPPED if `handler` stopped lexing, SIMPLE_LEXER_IO_ERROR
+ * (with errno set) if reading failed, and any other lexing errors as
+ * SimpleLexer_GetNextToken() and SimpleLexer_Finish() return them.
+ * Like SimpleLexer_Finish(), this passes the final token to `handler` before
+ * returning SIMPLE_LEXER_ESCAPING_EOF or SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN.
+ */
+extern SimpleLexerError SimpleLexer_LexFd(
+    SimpleLexer* lexer,
+    int fd,
+    SimpleTokenHandler handler,
+    void* context);
+
+/*
+ * Like SimpleLexer_LexFd(), but open the file at `path` first.
+ */
+extern SimpleLexerError SimpleLexer_LexFile(
+    SimpleLexer* lexer,
+    const char* path,
+    SimpleTokenHandler handler,
+    void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SIMPLELEXER_FILE_H */
@@ -35,18 +35,27 @@ extern "C" {
 #endif
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*
- * This represents a position (line and column) within a stream of text.
- * Both fields are one-based.
+ * This represents a position (line, column, and byte offset) within a stream
+ * of text.  line and column are one-based, and columns count bytes unless
+ * the lexer that produced the position counts them otherwise (see
+ * SimpleLexer_SetColumns()).  offset is zero-based.  line and column are
+ * zero if the lexer that produced the position doesn't track them (see
+ * SimpleLexer_SetPositionTracking()).
  */
 typedef struct TextPosition {
     size_t line;
     size_t column;
+    size_t offset;
 } TextPosition;
 
 /*
- * This represents a span of text within a file or stream.
+ * This represents a span of text within a file or stream.  Both ends are
+ * inclusive, so the span's text is the end.offset - start.offset + 1 bytes
+ * starting at start.offset.  (Quoted tokens' spans include their quotation
+ * marks.)
  *
  * SimpleLexer guarantees that `start` <= `end`:
  * Either start.line < end.line
@@ -57,6 +66,18 @@ typedef struct TextSpan {
     TextPosition end;
 } TextSpan;
 
+/*
+ * This is the symbol of tokens that weren't interned in a SimpleSymbolTable.
+ * (See SimpleLexer_SetSymbolTable().)
+ */
+#define SIMPLE_SYMBOL_NONE ((uint32_t)0)
+
+/*
+ * This is the keyword of tokens that aren't keywords.
+ * (See SimpleLexer_SetKeywords().)
+ */
+#define SIMPLE_KEYWORD_NONE (-1)
+
 /*
  * a lexed token, including its starting and ending positions within its stream
  */
@@ -75,12 +96,35 @@ typedef struct SimpleToken {
 
     /* nonzero if the token started with an escaped character */
     char startedEscaped;
+
+    /* nonzero if text points into the lexer's input rather than its
+       token buffer (see SimpleLexer_SetTokenViews()), in which case text
+       is NOT NUL-terminated and must not be modified */
+    char isView;
+
+    /* zero if text continues a token whose earlier text the lexer returned
+       in SIMPLE_LEXER_PARTIAL_TOKEN fragments (see SimpleLexer_SetFragments())
+       and nonzero otherwise */
+    char firstFragment;
+
+    /* zero if text is a SIMPLE_LEXER_PARTIAL_TOKEN fragment, which more of
+       its token's text follows, and nonzero otherwise */
+    char lastFragment;
+
+    /* the token's text's ID in the lexer's symbol table or
+       SIMPLE_SYMBOL_NONE (see SimpleLexer_SetSymbolTable()) */
+    uint32_t symbol;
+
+    /* the index of the token's text in the lexer's keyword set or
+       SIMPLE_KEYWORD_NONE (see SimpleLexer_SetKeywords()) */
+    int keyword;
 } SimpleToken;
 
 /*
  * Copy `source` into `dest`.
  * This allocates memory for `dest`'s text buffer
  * using the standard library's malloc().
+ * `dest`'s text is always NUL-terminated, even if `source` is a view.
  * Pass `dest` to SimpleToken_Destroy() to free `dest`'s text buffer.
  *
  * This returns zero if the copy succeeded and nonzero if malloc() failed.
@@ -111,10 +155,394 @@ extern SimpleToken* SimpleToken_Duplicate(const SimpleToken* source);
  */
 extern void SimpleToken_Free(SimpleToken* token);
 
+/*
+ * This is the interface that growable lexers use to allocate their token
+ * buffers.  (See SimpleLexer_InitGrowable().)  Each function receives
+ * `context` as its first argument.
+ */
+typedef struct SimpleLexerAllocator {
+    /* Allocate `size` bytes.  Return NULL on failure. */
+    void* (*allocate)(void* context, size_t size);
+
+    /* Resize `block` from `oldSize` to `newSize` bytes, preserving its
+       contents like the standard library's realloc().  Return NULL on failure,
+       in which case `block` must remain valid. */
+    void* (*reallocate)(
+        void* context,
+        void* block,
+        size_t oldSize,
+        size_t newSize);
+
+    /* Free `block`, which is `size` bytes long. */
+    void (*deallocate)(void* context, void* block, size_t size);
+
+    /* an arbitrary pointer passed to the above functions */
+    void* context;
+} SimpleLexerAllocator;
+
+/*
+ * This SimpleLexerAllocator uses the standard library's
+ * malloc(), realloc(), and free() functions.
+ */
+extern const SimpleLexerAllocator SimpleLexer_StandardAllocator;
+
+/*
+ * This is a region of memory for retaining many tokens cheaply.
+ * It carves copies of tokens out of large blocks with a bump pointer,
+ * keeping each copy's SimpleToken structure next to its text, and
+ * frees all of the copies at once.  Don't pass arena tokens to
+ * SimpleToken_Destroy() or SimpleToken_Free().
+ *
+ * Initialize arenas via SimpleTokenArena_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleTokenArenaBlock SimpleTokenArenaBlock;
+
+typedef struct SimpleTokenArena {
+    SimpleTokenArenaBlock* firstBlock;   /* the arena's oldest block */
+    SimpleTokenArenaBlock* currentBlock; /* the block being filled */
+    char* next;                 /* the current block's first free byte */
+    char* end;                  /* the end of the current block */
+    size_t blockSize;           /* the usual size of a block in bytes */
+    SimpleLexerAllocator allocator; /* allocates the arena's blocks */
+} SimpleTokenArena;
+
+/*
+ * Initialize an empty arena that allocates `blockSize`-byte blocks
+ * (or 64 KiB blocks if `blockSize` is zero) using `allocator`
+ * (or SimpleLexer_StandardAllocator if `allocator` is NULL).
+ * Larger allocations get blocks of their own.
+ */
+extern void SimpleTokenArena_Init(
+    SimpleTokenArena* SIMPLELEXER_RESTRICT arena,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator,
+    size_t blockSize);
+
+/*
+ * Allocate `size` bytes from an arena, suitably aligned for any type.
+ * This returns NULL if the arena's allocator failed or `size` is too large.
+ * Like malloc(1), allocating zero bytes returns a unique non-NULL pointer.
+ */
+extern void* SimpleTokenArena_Allocate(SimpleTokenArena* arena, size_t size);
+
+/*
+ * Like SimpleToken_Copy(), but allocate `dest`'s text from `arena`.
+ * This returns zero if the copy succeeded and nonzero otherwise.
+ */
+extern int SimpleTokenArena_Copy(
+    SimpleTokenArena* SIMPLELEXER_RESTRICT arena,
+    const SimpleToken* SIMPLELEXER_RESTRICT source,
+    SimpleToken* SIMPLELEXER_RESTRICT dest);
+
+/*
+ * Like SimpleToken_Duplicate(), but allocate the new token and its text
+ * next to each other in `arena`.  This returns NULL on failure.
+ */
+extern SimpleToken* SimpleTokenArena_Duplicate(
+    SimpleTokenArena* SIMPLELEXER_RESTRICT arena,
+    const SimpleToken* SIMPLELEXER_RESTRICT source);
+
+/*
+ * Duplicate `numTokens` tokens into one contiguous array in `arena`
+ * followed by the tokens' text.  This returns the array or NULL on failure.
+ * (The array isn't NULL if `numTokens` is zero, but it has no elements.)
+ */
+extern SimpleToken* SimpleTokenArena_DuplicateMany(
+    SimpleTokenArena* SIMPLELEXER_RESTRICT arena,
+    const SimpleToken* SIMPLELEXER_RESTRICT sources,
+    size_t numTokens);
+
+/*
+ * Invalidate everything allocated from an arena in constant time.
+ * The arena keeps its blocks and reuses them for later allocations.
+ */
+extern void SimpleTokenArena_Reset(SimpleTokenArena* arena);
+
+/*
+ * Free all of an arena's blocks, invalidating everything allocated from it.
+ */
+extern void SimpleTokenArena_Destroy(SimpleTokenArena* arena);
+
+/*
+ * This interns strings, giving each distinct string a stable ID (a symbol)
+ * from 1 up, so that retaining a string costs four bytes and comparing
+ * strings is an integer comparison.  Each string's text is stored once,
+ * NUL-terminated, in an arena.  Strings are found via an open-addressing
+ * hash table.
+ *
+ * Lexers can intern their tokens as they lex them:
+ * See SimpleLexer_SetSymbolTable().
+ *
+ * Initialize tables via SimpleSymbolTable_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleSymbol {
+    const char* text;           /* the symbol's NUL-terminated text */
+    size_t length;              /* text's string length */
+    uint32_t hash;              /* text's hash */
+} SimpleSymbol;
+
+typedef struct SimpleSymbolTable {
+    uint32_t* slots;            /* the hash table of symbols, with
+                                   SIMPLE_SYMBOL_NONE in empty slots */
+    size_t numSlots;            /* a power of two, or zero */
+    SimpleSymbol* symbols;      /* the symbols indexed by ID - 1 */
+    size_t numSymbols;
+    size_t symbolCapacity;      /* symbols' capacity in symbols */
+    SimpleTokenArena arena;     /* holds the symbols' text */
+    SimpleLexerAllocator allocator; /* allocates slots and symbols */
+} SimpleSymbolTable;
+
+/*
+ * Initialize an empty table that allocates memory using `allocator`
+ * (or SimpleLexer_StandardAllocator if `allocator` is NULL).
+ */
+extern void SimpleSymbolTable_Init(
+    SimpleSymbolTable* SIMPLELEXER_RESTRICT table,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator);
+
+/*
+ * Return the symbol of the `length`-byte string `text`,
+ * adding the string to the table if it isn't there already.
+ * This returns SIMPLE_SYMBOL_NONE if the table's allocator failed.
+ */
+extern uint32_t SimpleSymbolTable_Intern(
+    SimpleSymbolTable* SIMPLELEXER_RESTRICT table,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t length);
+
+/*
+ * Return the symbol of the `length`-byte string `text`
+ * or SIMPLE_SYMBOL_NONE if it isn't in the table.
+ */
+extern uint32_t SimpleSymbolTable_Find(
+    const SimpleSymbolTable* SIMPLELEXER_RESTRICT table,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t length);
+
+/*
+ * Return the NUL-terminated text of a symbol in the table, storing
+ * its length in `length` if `length` isn't NULL.  The text remains valid
+ * until the table is destroyed.
+ */
+extern const char* SimpleSymbolTable_GetText(
+    const SimpleSymbolTable* SIMPLELEXER_RESTRICT table,
+    uint32_t symbol,
+    size_t* SIMPLELEXER_RESTRICT length);
+
+/*
+ * Free a table's memory, invalidating its symbols' text.
+ */
+extern void SimpleSymbolTable_Destroy(SimpleSymbolTable* table);
+
+/*
+ * This is a fixed set of keywords compiled into a minimal perfect hash
+ * function, which maps each keyword to a distinct slot (and every other
+ * string to some slot), so looking up a string costs one pass of hashing over
+ * it and one comparison, no matter how many keywords there are.
+ *
+ * The hash function uses the "hash, displace, and compress" scheme:
+ * Strings are hashed into buckets of about four keywords, and each bucket
+ * has a displacement that moves its keywords into free slots.
+ *
+ * Lexers can classify their tokens as they lex them:
+ * See SimpleLexer_SetKeywords().
+ *
+ * Initialize keyword sets via SimpleKeywordSet_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleKeyword {
+    const char* text;           /* the keyword (not owned by the set) */
+    size_t length;              /* text's string length */
+    int keyword;                /* the keyword's index in the set */
+} SimpleKeyword;
+
+typedef struct SimpleKeywordSet {
+    SimpleKeyword* slots;       /* the keywords in their hash slots */
+    uint32_t* displacements;    /* the buckets' displacements */
+    size_t numKeywords;
+    size_t numBuckets;
+    uint64_t seed;              /* the seed of the strings' hashes */
+    size_t minLength;           /* the length of the shortest keyword */
+    size_t maxLength;           /* the length of the longest keyword */
+    SimpleLexerAllocator allocator; /* allocates slots and displacements */
+} SimpleKeywordSet;
+
+/*
+ * Compile the `numKeywords` NUL-terminated strings in `keywords` into a
+ * keyword set, allocating memory using `allocator` (or
+ * SimpleLexer_StandardAllocator if `allocator` is NULL).  Keyword i is
+ * keywords[i], so an enum that lists the keywords in the same order
+ * names them.  The set refers to the strings, which must outlive it.
+ *
+ * This returns zero on success and nonzero if the allocator failed
+ * or the keywords contain duplicates.
+ */
+extern int SimpleKeywordSet_Init(
+    SimpleKeywordSet* SIMPLELEXER_RESTRICT set,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator,
+    const char* const* SIMPLELEXER_RESTRICT keywords,
+    size_t numKeywords);
+
+/*
+ * Return the index of the `length`-byte string `text` in the set's keywords
+ * or SIMPLE_KEYWORD_NONE if it isn't a keyword.
+ */
+extern int SimpleKeywordSet_Find(
+    const SimpleKeywordSet* SIMPLELEXER_RESTRICT set,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t length);
+
+/*
+ * Free a keyword set's memory.
+ */
+extern void SimpleKeywordSet_Destroy(SimpleKeywordSet* set);
+
+/*
+ * This is the most bytes (besides whitespace) that can interrupt runs of token
+ * text in a dialect whose lexers scan token text with SIMD instructions.
+ * Lexers scan the text of dialects with more such bytes one byte at a time.
+ */
+#define SIMPLE_LEXER_DIALECT_MAX_STOPS 16
+
+/*
+ * A dialect varies SimpleLexer's language: which bytes quote tokens, start
+ * comments, escape bytes, and separate tokens besides whitespace, and what
+ * escape sequences mean.  Dialects are compiled into tables once and never
+ * change afterwards, so any number of lexers on any number of threads can
+ * share one.  See SimpleLexer_SetDialect().
+ *
+ * Initialize dialects via SimpleLexerDialect_Init().  Dialects own no memory.
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleLexerDialect {
+    unsigned char classes[256]; /* how the lexer treats each byte */
+    char escapes[256];          /* what each byte means after the escape
+                                   byte (zero: the byte itself) */
+
+    /* the special bytes that interrupt runs of unquoted and quoted token text
+       besides whitespace and newlines, respectively (the counts exceed
+       SIMPLE_LEXER_DIALECT_MAX_STOPS if there are too many to list) */
+    unsigned char unquotedStops[SIMPLE_LEXER_DIALECT_MAX_STOPS];
+    unsigned char quotedStops[SIMPLE_LEXER_DIALECT_MAX_STOPS];
+    unsigned char numUnquotedStops;
+    unsigned char numQuotedStops;
+} SimpleLexerDialect;
+
+/*
+ * This is SimpleLexer's own language, which lexers use by default:
+ * '"' quotes tokens, '#' starts comments, '\' escapes bytes (with
+ * the C escape sequences "\a", "\b", "\f", "\n", "\r", "\t", and "\v"),
+ * and only whitespace separates tokens.
+ */
+extern const SimpleLexerDialect SimpleLexer_DefaultDialect;
+
+/*
+ * Compile a dialect.  Every byte in the NUL-terminated strings `quotes`
+ * and `comments` quotes tokens and starts comments, respectively.
+ * A quoted token ends at the same byte that started it.  Bytes in
+ * `delimiters` separate tokens just as whitespace does.  Any of these
+ * strings may be NULL or empty.  `escape` is the byte that escapes
+ * the following byte or -1 if the dialect has no escapes.
+ *
+ * `escapes` lists escape sequences as pairs of bytes: each byte that may
+ * follow the escape byte and the byte that the sequence stands for.
+ * Escaped bytes that aren't listed stand for themselves.  If `escapes` is
+ * NULL, the dialect has the C escape sequences, as the default one does.
+ *
+ * This returns zero on success.  It returns nonzero if a byte appears more
+ * than once among the quotes, comments, delimiters, and escape, if any
+ * of those are whitespace or NUL, or if `escapes` has an odd length.
+ *
+ * For example, this dialect has ' and " quotes and ';' comments, separates
+ * tokens with commas, and has no escapes:
+ *
+ *    SimpleLexerDialect_Init(&dialect, "'\"", ";", ",", -1, NULL);
+ */
+extern int SimpleLexerDialect_Init(
+    SimpleLexerDialect* dialect,
+    const char* quotes,
+    const char* comments,
+    const char* delimiters,
+    int escape,
+    const char* escapes);
+
+/*
+ * These are the states that a SimpleLexer can be in between characters.
+ */
+typedef enum SimpleLexerState {
+    SIMPLE_LEXER_STATE_NORMAL,          /* between tokens */
+    SIMPLE_LEXER_STATE_TOKEN,           /* inside an unquoted token */
+    SIMPLE_LEXER_STATE_QUOTED,          /* inside a quoted token */
+    SIMPLE_LEXER_STATE_COMMENT,         /* inside a comment */
+    SIMPLE_LEXER_STATE_ESCAPING,        /* escaping in an unquoted token */
+    SIMPLE_LEXER_STATE_ESCAPING_QUOTED, /* escaping in a quoted token */
+    SIMPLE_LEXER_NUMSTATES
+} SimpleLexerState;
+
+/*
+ * These are the ways that a SimpleLexer can track its position.
+ * (See SimpleLexer_SetPositionTracking().)
+ */
+typedef enum SimpleLexerPositionTracking {
+    SIMPLE_LEXER_TRACK_LINES,           /* lines, columns, and offsets */
+    SIMPLE_LEXER_TRACK_OFFSETS,         /* only offsets */
+    SIMPLE_LEXER_TRACK_NOTHING          /* nothing: spans are all zeros */
+} SimpleLexerPositionTracking;
+
+/*
+ * These are what a SimpleLexer's columns can count.
+ * (See SimpleLexer_SetColumns().)
+ */
+typedef enum SimpleLexerColumns {
+    SIMPLE_LEXER_COLUMN_BYTES,          /* bytes */
+    SIMPLE_LEXER_COLUMN_CODE_POINTS,    /* UTF-8 code points */
+    SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH   /* code points, but East Asian wide
+                                           characters count twice */
+} SimpleLexerColumns;
+
+/*
+ * This is the number of buckets in SimpleLexerStats' token length histogram:
+ * enough for every power of two that a size_t can hold and zero.
+ */
+#define SIMPLE_LEXER_STATS_NUM_BUCKETS 65
+
+/*
+ * These are counters of what a lexer has done, which show where lexing time
+ * goes: into huge comments, escape-heavy text, giant tokens, or many small
+ * inputs, for example.  Lexers keep them only if SimpleLexer is compiled with
+ * SIMPLELEXER_STATS defined, in which case everything that includes
+ * simplelexer.h must define it, too, because it adds them to SimpleLexer.
+ * Otherwise they cost nothing, and they're all zeros.
+ *
+ * Get a lexer's counters via SimpleLexer_GetStats() and combine the counters
+ * of several lexers (on different threads, for example) via
+ * SimpleLexerStats_Merge().
+ */
+typedef struct SimpleLexerStats {
+    uint64_t numBytes;          /* bytes that the lexer consumed */
+    uint64_t numInputs;         /* calls to SimpleLexer_SetInput() */
+    uint64_t numQuotedTokens;   /* quoted tokens that the lexer produced */
+    uint64_t numUnquotedTokens; /* unquoted tokens that the lexer produced */
+    uint64_t numStartedEscapedTokens;   /* unquoted tokens that started with
+                                   escape sequences */
+    uint64_t numEscapes;        /* escape sequences in tokens */
+    uint64_t numCommentBytes;   /* bytes in comments (excluding the newlines
+                                   that end them) */
+    uint64_t numSpanningTokens; /* tokens that spanned more than one input */
+    uint64_t numTokensTooLarge; /* SIMPLE_LEXER_TOKEN_TOO_LARGE errors */
+    uint64_t numFragments;      /* SIMPLE_LEXER_PARTIAL_TOKEN fragments */
+
+    /* tokenLengths[0] counts empty tokens, and tokenLengths[n] counts tokens
+       whose lengths are at least 2^(n - 1) but less than 2^n */
+    uint64_t tokenLengths[SIMPLE_LEXER_STATS_NUM_BUCKETS];
+} SimpleLexerStats;
+
 /*
  * This is a simple lexer that produces SimpleTokens.  A token is a sequence of
- * characters delimited by whitespace (characters that cause isspace() to return
- * nonzero values).  Backslashes escape the characters that follow them,
+ * characters delimited by whitespace ('\t', '\n', '\v', '\f', '\r', and ' ',
+ * which are what isspace() recognizes in the "C" locale, regardless of
+ * the current locale).  Backslashes escape the characters that follow them,
  * causing them to be included in their tokens literally.  (Single-character
  * C escapes are handled as in C strings.) Double quotation marks ('"')
  * can enclose tokens, which is one way to add whitespace to tokens.
@@ -135,25 +563,72 @@ typedef struct SimpleLexer
     /* the start of the current token */
     TextPosition tokenStart;
 
-    char escaping;              /* set if lexer is escaping a character */
-    char inToken;               /* set if lexer is inside a token */
-    char finishedQuotedToken;   /* set if lexer just finished a
-                                   quoted token */
-    char inComment;             /* set if lexer is inside a comment */
-    char tokenIsQuoted;         /* set if the lexed token was quoted */
+    SimpleLexerState state;     /* where the lexer is in the language */
+    SimpleLexerPositionTracking positionTracking;   /* what the lexer
+                                   records in currentPosition and spans */
     char startedEscaped;        /* set if the lexed token was started
                                    with an escaped character */
+    char tokenEscaped;          /* set if the lexed token contains
+                                   an escaped character */
     char finished;              /* set if lexer finished its stream */
+    char tokenViews;            /* set if tokens may be views into input */
+    char tokenIsView;           /* set if the current token's text is
+                                   still in the input, not the buffer */
+    char fragments;             /* set if tokens too large for the buffer
+                                   are returned in fragments */
+    char tokenFragmented;       /* set if the lexer returned some of the
+                                   current token's text in fragments */
 
-    char* buffer;               /* token text buffer
-                                   (not owned by the lexer) */
+    char* buffer;               /* token text buffer (owned by the lexer
+                                   only if the lexer is growable) */
     size_t bufferLength;        /* current token length */
     size_t bufferCapacity;      /* token text buffer's byte size */
+    size_t maxBufferCapacity;   /* the most that bufferCapacity can grow to
+                                   (bufferCapacity if not growable) */
+    char ownsBuffer;            /* set if the lexer is growable */
+    SimpleLexerAllocator allocator; /* allocates growable lexers' buffers */
 
     const char* input;          /* current text input supplied by user
                                    (not owned by the lexer) */
     size_t inputSize;           /* size of current text input in chars */
     size_t inputIndex;          /* lexer's current location in text input */
+    size_t inputOffset;         /* the stream offset of the input's start */
+    SimpleSymbolTable* symbols; /* where tokens are interned, if anywhere
+                                   (not owned by the lexer) */
+    const SimpleKeywordSet* keywords;   /* the keywords that tokens are
+                                   classified as, if any (not owned by
+                                   the lexer) */
+    const SimpleLexerDialect* dialect;  /* the lexer's language (not owned
+                                   by the lexer) */
+    char quote;                 /* the byte that opened the current
+                                   quoted token */
+    size_t tokenInputIndex;     /* where the current token's text starts
+                                   in the input if it's a view */
+    char utf8;                  /* set if the lexer is in UTF-8 mode */
+    unsigned char utf8Needed;   /* continuation bytes that the last UTF-8
+                                   sequence in the input still needs */
+    unsigned char utf8Seen;     /* bytes of that sequence so far */
+    unsigned char utf8Min;      /* the range of its next continuation byte */
+    unsigned char utf8Max;
+    unsigned char numUtf8Held;  /* bytes of a possible multi-byte space that
+                                   the last input ended in the middle of */
+    unsigned char utf8Held[2];  /* those bytes (consumed, but not yet part
+                                   of currentPosition) */
+    size_t utf8InputSize;       /* the input's size in UTF-8 mode, in which
+                                   inputSize stops at invalid UTF-8 */
+    SimpleLexerColumns columns; /* what the lexer's columns count */
+    size_t tabWidth;            /* the distance between tab stops, or zero
+                                   if tabs are one column wide */
+    uint32_t columnCodePoint;   /* the last three- or four-byte character's
+                                   code point so far, in case it's wide */
+    unsigned char columnBytesNeeded;    /* the continuation bytes that
+                                   columnCodePoint still needs */
+#ifdef SIMPLELEXER_STATS
+    SimpleLexerStats stats;     /* what the lexer has done (numBytes excludes
+                                   the current stream's bytes) */
+    char tokenSpansInputs;      /* set if the current token started in
+                                   an earlier input */
+#endif
 } SimpleLexer;
 
 /*
@@ -176,17 +651,44 @@ typedef enum SimpleLexerError {
     /* the stream ended with an unescaped backslash */
     SIMPLE_LEXER_ESCAPING_EOF,
 
+    /* a growable lexer couldn't grow its token buffer because its
+       allocator failed */
+    SIMPLE_LEXER_OUT_OF_MEMORY,
+
+    /* reading the text stream failed (errno describes the failure) */
+    SIMPLE_LEXER_IO_ERROR,
+
+    /* a SimpleTokenHandler stopped lexing */
+    SIMPLE_LEXER_STOPPED,
+
+    /* a lexer in UTF-8 mode reached a byte sequence that isn't valid UTF-8
+       (see SimpleLexer_SetUtf8()) */
+    SIMPLE_LEXER_INVALID_UTF8,
+
+    /* not an error: the lexer returned a fragment of a token that's too
+       large for its buffer (see SimpleLexer_SetFragments()) */
+    SIMPLE_LEXER_PARTIAL_TOKEN,
+
     /* not a real error code: just number of error codes */
     SIMPLE_LEXER_NUMERRORCODES
 } SimpleLexerError;
 
+/*
+ * Functions that lex whole streams pass each token to a SimpleTokenHandler
+ * along with a caller-supplied context pointer.  The token is valid only
+ * during the call.  Handlers return zero to continue lexing and nonzero
+ * to stop, which makes the lexing function return SIMPLE_LEXER_STOPPED.
+ */
+typedef int (*SimpleTokenHandler)(void* context, const SimpleToken* token);
+
 /*
  * Initialize or reset the specified SimpleLexer.
  * The caller must specify a byte buffer for token text.
  * Note that the caller is responsible for freeing this buffer (if necessary)
  * once lexing is done.  The length of the buffer determines the maximum
  * token size.  The SimpleLexer functions do NOT reallocate the buffer
- * while lexing large tokens.
+ * while lexing large tokens.  (Use SimpleLexer_InitGrowable() for lexers
+ * that do.)
  *
  * `tokenBufferSize` is the size of `tokenBuffer` in bytes, including the
  * terminating NUL byte.  For example, if `tokenBuffer` is 1024 bytes,
@@ -198,6 +700,206 @@ extern void SimpleLexer_Init(
     char* SIMPLELEXER_RESTRICT tokenBuffer,
     size_t tokenBufferSize);
 
+/*
+ * Initialize a growable SimpleLexer, which allocates its own token buffer
+ * using `allocator` (or SimpleLexer_StandardAllocator if `allocator` is NULL).
+ * The buffer starts at `initialBufferSize` bytes and doubles whenever
+ * a token outgrows it, up to `maxBufferSize` bytes.  Only tokens that
+ * don't fit in `maxBufferSize` bytes (including the terminating NUL) cause
+ * SIMPLE_LEXER_TOKEN_TOO_LARGE errors.  If the allocator fails while
+ * growing the buffer, lexing functions return SIMPLE_LEXER_OUT_OF_MEMORY,
+ * and calling them again resumes the same token.
+ *
+ * Growing the buffer moves it, so token text that a lexer returned earlier
+ * is invalid after the lexer lexes another token.
+ *
+ * This returns zero on success and nonzero if the initial allocation failed.
+ * Pass growable lexers to SimpleLexer_Destroy() when you're done with them.
+ */
+extern int SimpleLexer_InitGrowable(
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator,
+    size_t initialBufferSize,
+    size_t maxBufferSize);
+
+/*
+ * Reset a lexer so that it can lex a new stream of text.
+ * The lexer keeps its token buffer and its settings.
+ */
+extern void SimpleLexer_Reset(SimpleLexer* lexer);
+
+/*
+ * Free a growable lexer's token buffer.  This does nothing to other lexers
+ * because the caller owns their buffers.
+ */
+extern void SimpleLexer_Destroy(SimpleLexer* lexer);
+
+/*
+ * Enable or disable zero-copy token views.  Views are disabled by default.
+ *
+ * While views are enabled, SimpleLexer_GetNextToken() and SimpleLexer_Finish()
+ * return tokens whose text points directly into the text given to
+ * SimpleLexer_SetInput() instead of copying it into the lexer's token buffer
+ * whenever that is possible and set the tokens' isView fields.
+ * Such text is NOT NUL-terminated: Use the tokens' lengths.
+ * Tokens containing escape sequences and tokens that span more than one
+ * input still use the token buffer, so their isView fields are zero.
+ * Views aren't limited by the token buffer's size.
+ */
+extern void SimpleLexer_SetTokenViews(SimpleLexer* lexer, int enabled);
+
+/*
+ * Enable or disable fragment mode, which is disabled by default.
+ *
+ * In fragment mode, a token that doesn't fit in the lexer's token buffer
+ * (after a growable lexer's buffer reaches its maximum size) doesn't cause
+ * SIMPLE_LEXER_TOKEN_TOO_LARGE errors.  Instead, whenever the buffer
+ * fills, SimpleLexer_GetNextToken() returns SIMPLE_LEXER_PARTIAL_TOKEN
+ * and a fragment: a token whose text is the token's text so far and
+ * whose lastFragment field is zero.  (The first fragment's firstFragment
+ * field is nonzero, and the rest's are zero.)  The lexer empties its
+ * buffer and continues the same token the next time it's called.  The
+ * token's last fragment comes the way whole tokens do, such as with
+ * SIMPLE_LEXER_OK or from SimpleLexer_Finish(), but its firstFragment
+ * field is zero.  So callers can stream giant tokens somewhere, such as
+ * to files or hash functions, through a small buffer.  Whole tokens'
+ * firstFragment and lastFragment fields are both nonzero.
+ *
+ * Fragments' spans start where their tokens start and end at the lexer's
+ * current position.  Last fragments' spans are their whole tokens' spans.
+ * Fragments aren't interned or classified as keywords, and neither are
+ * last fragments.  SimpleLexer_Finish() can return fragments, too: call it
+ * again after it returns one.  SimpleLexer_GetTokens() batches fragments
+ * like tokens, and SimpleLexer_PushTokens() and the functions that use it
+ * pass them to handlers.
+ */
+extern void SimpleLexer_SetFragments(SimpleLexer* lexer, int enabled);
+
+/*
+ * Intern every token that the lexer returns in `symbols`, storing each
+ * token's ID in its symbol field, or stop interning tokens if `symbols` is
+ * NULL.  The lexer doesn't own the table, which can be shared by lexers
+ * that run one at a time.
+ *
+ * Tokens' text fields are unaffected.  If the table can't grow, tokens'
+ * symbols are SIMPLE_SYMBOL_NONE; lexing continues regardless.
+ */
+extern void SimpleLexer_SetSymbolTable(
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    SimpleSymbolTable* SIMPLELEXER_RESTRICT symbols);
+
+/*
+ * Classify every token that the lexer returns by storing its index in
+ * `keywords` (or SIMPLE_KEYWORD_NONE) in its keyword field, or stop
+ * classifying tokens if `keywords` is NULL.  Quoted tokens and tokens
+ * that contain escape sequences are never keywords, so quoting or escaping
+ * a keyword makes it an ordinary token.  The lexer doesn't own the set.
+ */
+extern void SimpleLexer_SetKeywords(
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    const SimpleKeywordSet* SIMPLELEXER_RESTRICT keywords);
+
+/*
+ * Lex the language described by `dialect` (see SimpleLexerDialect_Init())
+ * or the default language (SimpleLexer_DefaultDialect) if `dialect` is NULL.
+ * The lexer doesn't own the dialect, which must outlive the lexer's use
+ * of it.  Call this after SimpleLexer_Init() or SimpleLexer_Reset() but
+ * before lexing anything.
+ *
+ * Lexers scan runs of token text in the default dialect as fast as they can.
+ * Other dialects cost a comparison per SIMD block for each quote, comment,
+ * and delimiter byte and the escape byte, so dialects with more than
+ * SIMPLE_LEXER_DIALECT_MAX_STOPS of them are scanned a byte at a time.
+ */
+extern void SimpleLexer_SetDialect(
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    const SimpleLexerDialect* SIMPLELEXER_RESTRICT dialect);
+
+/*
+ * Choose what the lexer tracks in its currentPosition and its tokens' spans.
+ * Call this after SimpleLexer_Init() or SimpleLexer_Reset() but before
+ * lexing anything.
+ *
+ * By default, lexers track lines, columns, and byte offsets
+ * (SIMPLE_LEXER_TRACK_LINES), which costs a little bookkeeping for every byte
+ * that they lex.  SIMPLE_LEXER_TRACK_OFFSETS tracks only byte offsets,
+ * leaving lines and columns zero.  (SimpleLexer_ComputeLineAndColumn()
+ * computes them later if they're needed.)  SIMPLE_LEXER_TRACK_NOTHING
+ * leaves tokens' spans and the lexer's currentPosition zeroed.
+ */
+extern void SimpleLexer_SetPositionTracking(
+    SimpleLexer* lexer,
+    SimpleLexerPositionTracking tracking);
+
+/*
+ * Enable or disable UTF-8 mode, in which the lexer validates its stream as
+ * UTF-8 and treats the multi-byte Unicode whitespace characters (U+0085,
+ * U+00A0, U+1680, U+2000 through U+200A, U+2028, U+2029, U+202F, U+205F,
+ * and U+3000) like the ASCII ones, so they separate unquoted tokens.  They're
+ * still token text inside quoted tokens and after escapes.  Lines and
+ * columns are unchanged: only '\n' ends lines, and columns count whatever
+ * SimpleLexer_SetColumns() says (bytes by default).
+ * ASCII text is lexed as quickly as in the default mode.
+ *
+ * When a lexer in UTF-8 mode reaches an invalid byte sequence (including
+ * overlong encodings, surrogates, and code points past U+10FFFF), it
+ * returns SIMPLE_LEXER_INVALID_UTF8 with its currentPosition at the start
+ * of the sequence (or, if the sequence started in an earlier input, at the
+ * first byte that made it invalid) and ignores the rest of the input.
+ * Lexing can resume with another input, such as the rest of the invalid
+ * input after the sequence.
+ *
+ * Call this after SimpleLexer_Init() or SimpleLexer_Reset() but before
+ * SimpleLexer_SetInput().  Lexers aren't in UTF-8 mode by default.
+ */
+extern void SimpleLexer_SetUtf8(SimpleLexer* lexer, int enabled);
+
+/*
+ * Choose what the columns in the lexer's currentPosition and its tokens'
+ * spans count, so that they can match editors' columns.  By default, they
+ * count bytes (SIMPLE_LEXER_COLUMN_BYTES).  SIMPLE_LEXER_COLUMN_CODE_POINTS
+ * counts UTF-8 code points: continuation bytes (0x80 through 0xBF) don't
+ * count.  SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH counts the cells that
+ * terminals display code points in, which is two for East Asian wide and
+ * fullwidth characters, such as CJK ideographs and most emoji, and one for
+ * the rest.  (Combining characters count as one.)  If `tabWidth` isn't
+ * zero, tabs advance to the next tab stop (column 1, tabWidth + 1,
+ * 2 * tabWidth + 1, and so on) instead of to the next column.
+ *
+ * Spans end at the last column that their last characters occupy.  Lexers
+ * count columns a vector of text at a time, falling back to a byte at
+ * a time only around tabs (if tabWidth isn't zero) and three- and four-byte
+ * UTF-8 sequences (if they count display width), so counting code points
+ * costs little.  Columns are counted only with SIMPLE_LEXER_TRACK_LINES.
+ *
+ * Call this after SimpleLexer_Init() or SimpleLexer_Reset() but before
+ * lexing anything.
+ */
+extern void SimpleLexer_SetColumns(
+    SimpleLexer* lexer,
+    SimpleLexerColumns columns,
+    size_t tabWidth);
+
+/*
+ * Return the length of the longest prefix of `text` that is valid UTF-8,
+ * which is `size` if all of `text` is.  (The prefix never ends in the
+ * middle of a multi-byte sequence.)  This is the vectorized validator that
+ * lexers in UTF-8 mode use.
+ */
+extern size_t SimpleLexer_ValidateUtf8(const char* text, size_t size);
+
+/*
+ * Set `position`'s line and column from its offset, given the whole stream
+ * of text that it refers to (`text`, which is `textSize` bytes long).  This
+ * scans the text up to the offset, so it's meant for occasional lookups,
+ * such as positions in error messages.  The results match what lexers that
+ * track lines compute when their columns count bytes.
+ */
+extern void SimpleLexer_ComputeLineAndColumn(
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t textSize,
+    TextPosition* SIMPLELEXER_RESTRICT position);
+
 /*
  * Give the parser a line of text to parse.  The parameters MUST NOT be NULL.
  * Afterwards, call SimpleLexer_GetNextToken() repeatedly to lex tokens.
@@ -227,11 +929,84 @@ extern void SimpleLexer_SetInput(
  *
  *    o  SIMPLE_LEXER_TOKEN_TOO_LARGE: The token being lexed is too large
  *       for the lexer's text buffer.
+ *
+ *    o  SIMPLE_LEXER_PARTIAL_TOKEN: The token being lexed is too large for
+ *       the lexer's text buffer, so outToken is a fragment of it.  (See
+ *       SimpleLexer_SetFragments().)
+ *
+ *    o  SIMPLE_LEXER_OUT_OF_MEMORY: A growable lexer couldn't grow its
+ *       text buffer.
+ *
+ *    o  SIMPLE_LEXER_INVALID_UTF8: The lexer is in UTF-8 mode, and the input
+ *       isn't valid UTF-8.  (See SimpleLexer_SetUtf8().)
  */
 extern SimpleLexerError SimpleLexer_GetNextToken(
     SimpleLexer* SIMPLELEXER_RESTRICT lexer,
     SimpleToken* SIMPLELEXER_RESTRICT outToken);
 
+/*
+ * Lex up to `maxTokens` tokens into the `tokens` array in one call.
+ *
+ * Unlike the token that SimpleLexer_GetNextToken() returns, the text of
+ * each token is copied (with a terminating NUL) into `textArena`, so all
+ * of the tokens remain valid until the caller reuses `textArena`.
+ * (Views stay views: See SimpleLexer_SetTokenViews().)  `textArenaSize` is
+ * the size of `textArena` in bytes.  If a token's text doesn't fit in what
+ * remains of `textArena`, lexing stops just before that token, so the next
+ * call returns it.  Fragments (see SimpleLexer_SetFragments()) are stored
+ * like tokens.
+ *
+ * This stores the number of lexed tokens in `numTokens` and returns
+ * SIMPLE_LEXER_OK if it stopped because `tokens` or `textArena` filled up.
+ * If the first token didn't fit in `textArena`, this returns
+ * SIMPLE_LEXER_TOKEN_TOO_LARGE.  Otherwise it returns whatever
+ * SimpleLexer_GetNextToken() returned after the last stored token:
+ * SIMPLE_LEXER_EOF at the end of the input (call SimpleLexer_SetInput()
+ * or SimpleLexer_Finish() next as usual) or an error code.
+ */
+extern SimpleLexerError SimpleLexer_GetTokens(
+    SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    SimpleToken* SIMPLELEXER_RESTRICT tokens,
+    size_t maxTokens,
+    char* SIMPLELEXER_RESTRICT textArena,
+    size_t textArenaSize,
+    size_t* SIMPLELEXER_RESTRICT numTokens);
+
+/*
+ * Set the lexer's input to `text` (as SimpleLexer_SetInput() does) and pass
+ * each token in it to `handler`.  This is a push-style alternative to calling
+ * SimpleLexer_GetNextToken() in a loop: The whole input is lexed in one tight
+ * loop without returning between tokens.  Tokens are views into `text`
+ * whenever possible regardless of SimpleLexer_SetTokenViews(), so they're
+ * valid only during the handler calls.
+ *
+ * Pushing and pulling share the lexer's state, so they can be mixed freely
+ * on the same stream.  For example, a token that the previous input left
+ * unfinished continues in `text`, and after a handler stops lexing, the rest
+ * of `text` remains the lexer's input, so SimpleLexer_GetNextToken() or
+ * SimpleLexer_PushTokens() can pick up where the handler stopped.
+ * This doesn't finish the lexer: Call SimpleLexer_Finish() at the end of
+ * the stream as usual.
+ *
+ * This returns SIMPLE_LEXER_EOF once it reaches the end of `text`,
+ * SIMPLE_LEXER_STOPPED if `handler` stopped lexing, and errors as
+ * SimpleLexer_GetNextToken() returns them.
+ */
+extern SimpleLexerError SimpleLexer_Feed(
+    SimpleLexer* lexer,
+    const char* text,
+    size_t textSize,
+    SimpleTokenHandler handler,
+    void* context);
+
+/*
+ * Like SimpleLexer_Feed(), but lex the rest of the lexer's current input.
+ */
+extern SimpleLexerError SimpleLexer_PushTokens(
+    SimpleLexer* lexer,
+    SimpleTokenHandler handler,
+    void* context);
+
 /*
  * Get the final token, if any, and shut down the lexer,
  * preventing its use in future SimpleLexer_GetNextToken()
@@ -254,11 +1029,268 @@ extern SimpleLexerError SimpleLexer_GetNextToken(
  *
  *    o  SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN: The stream ended in a quoted token
  *       that wasn't closed with quotation marks ('"').
+ *
+ *    o  SIMPLE_LEXER_INVALID_UTF8: The lexer is in UTF-8 mode, and the stream
+ *       ended in the middle of a multi-byte sequence.
+ *
+ *    o  SIMPLE_LEXER_PARTIAL_TOKEN: `finalToken` is a fragment of the final
+ *       token (see SimpleLexer_SetFragments()), and the lexer isn't finished:
+ *       Call this again for the rest.
  */
 extern SimpleLexerError SimpleLexer_Finish(
     SimpleLexer* SIMPLELEXER_RESTRICT lexer,
     SimpleToken* SIMPLELEXER_RESTRICT finalToken);
 
+/*
+ * Store a snapshot of the lexer's counters (see SimpleLexerStats) in `stats`.
+ * Counters accumulate from the lexer's initialization or the last
+ * SimpleLexer_ResetStats() call, across SimpleLexer_Reset() calls.
+ * The snapshot is all zeros if SIMPLELEXER_STATS isn't defined.
+ */
+extern void SimpleLexer_GetStats(
+    const SimpleLexer* SIMPLELEXER_RESTRICT lexer,
+    SimpleLexerStats* SIMPLELEXER_RESTRICT stats);
+
+/*
+ * Zero the lexer's counters.
+ */
+extern void SimpleLexer_ResetStats(SimpleLexer* lexer);
+
+/*
+ * Add the counters in `source` to those in `dest`.  Merging snapshots of
+ * lexers on different threads into one SimpleLexerStats after the threads
+ * are done yields counters for all of the lexers.
+ */
+extern void SimpleLexerStats_Merge(
+    SimpleLexerStats* SIMPLELEXER_RESTRICT dest,
+    const SimpleLexerStats* SIMPLELEXER_RESTRICT source);
+
+/*
+ * Split `size` bytes of text into words the way a shell splits a command
+ * line, using the default dialect, and store them in `argv` as an array of
+ * `argc` NUL-terminated strings followed by a NULL pointer.  The array and
+ * the strings share one block that this allocates via malloc() before lexing,
+ * so `argv` is freed by passing it to free().  Newlines separate words like
+ * any other whitespace.  (Use a SimpleLineSplitter to split streams into
+ * lines.)  The block is sized for the worst case, the number of words that
+ * fit in `size` bytes, so it can be several times larger than `size`.
+ *
+ * Return SIMPLE_LEXER_EOF if the whole text was split, storing the words in
+ * `argc` and `argv`.  Otherwise, return SIMPLE_LEXER_OUT_OF_MEMORY if
+ * allocating the block failed (or the text might hold more words than fit
+ * in an int) or SIMPLE_LEXER_ESCAPING_EOF or
+ * SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN if the text ended in the middle of
+ * a word, and set `argc` to zero and `argv` to NULL.
+ */
+extern SimpleLexerError SimpleLexer_SplitLine(
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size,
+    int* SIMPLELEXER_RESTRICT argc,
+    char*** SIMPLELEXER_RESTRICT argv);
+
+/*
+ * This splits a stream of text into records, each of which is one or more
+ * lines' worth of words, as SimpleLexer_SplitLine() would split them.
+ * A record ends at the first unescaped, unquoted newline after a word
+ * (including a newline that ends a comment), so quoted words and escaped
+ * newlines can continue a record onto later lines.  Blank lines and lines
+ * that hold only comments yield no records.
+ *
+ * The splitter keeps each record's words in one block holding the pointer
+ * array and the strings, as SimpleLexer_SplitLine() does, but it reuses the
+ * block from record to record, so once the block has grown to fit the
+ * stream's largest record, splitting allocates nothing.
+ *
+ * Initialize splitters via SimpleLineSplitter_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleLineSplitter {
+    SimpleLexer lexer;          /* lexes the stream, tracking lines */
+    char** block;               /* the current record's pointer array,
+                                   followed by its strings */
+    size_t numSlots;            /* the pointer array's capacity, including
+                                   the terminating NULL */
+    size_t textCapacity;        /* the strings' capacity in bytes */
+    size_t textSize;            /* the strings' length in bytes */
+    size_t numWords;            /* the number of words in the record */
+    size_t lastLine;            /* the line that the record's last word
+                                   ended on */
+    SimpleToken pending;        /* a word that starts the next record */
+    char hasPending;            /* set if pending holds a word */
+    char returned;              /* set if the record was returned */
+    SimpleLexerError finishError;   /* what SimpleLexer_Finish() returned */
+} SimpleLineSplitter;
+
+/*
+ * Initialize a splitter whose lexer is growable (see
+ * SimpleLexer_InitGrowable()), limiting words to `maxWordSize` bytes,
+ * including their terminating NULs.  The splitter allocates memory using
+ * `allocator` (or SimpleLexer_StandardAllocator if `allocator` is NULL).
+ *
+ * This returns zero on success and nonzero if allocating memory failed.
+ */
+extern int SimpleLineSplitter_Init(
+    SimpleLineSplitter* SIMPLELEXER_RESTRICT splitter,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator,
+    size_t maxWordSize);
+
+/*
+ * Give the splitter the next part of its stream, as SimpleLexer_SetInput()
+ * does.  The splitter consumes all of each input before returning
+ * SIMPLE_LEXER_EOF, and the input must remain valid until then.
+ */
+extern void SimpleLineSplitter_SetInput(
+    SimpleLineSplitter* SIMPLELEXER_RESTRICT splitter,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size);
+
+/*
+ * Get the stream's next complete record, storing its words in `argc` and
+ * `argv` (which ends with a NULL pointer).  The words remain valid until the
+ * next call to a SimpleLineSplitter function other than
+ * SimpleLineSplitter_SetInput(); don't free them.
+ *
+ * Return SIMPLE_LEXER_OK if this stored a record.  Return SIMPLE_LEXER_EOF
+ * if the splitter consumed its input without completing a record, in which
+ * case the splitter keeps the record's words so far and needs another input.
+ * Return SIMPLE_LEXER_TOKEN_TOO_LARGE or SIMPLE_LEXER_OUT_OF_MEMORY if the
+ * splitter couldn't store a word.  Calling this again after
+ * SIMPLE_LEXER_OUT_OF_MEMORY retries the word.
+ */
+extern SimpleLexerError SimpleLineSplitter_Next(
+    SimpleLineSplitter* SIMPLELEXER_RESTRICT splitter,
+    int* SIMPLELEXER_RESTRICT argc,
+    char*** SIMPLELEXER_RESTRICT argv);
+
+/*
+ * End the stream and get its remaining records, one per call, the last of
+ * which might not end with a newline.  This stores records as
+ * SimpleLineSplitter_Next() does.
+ *
+ * Return SIMPLE_LEXER_OK if this stored a record or SIMPLE_LEXER_EOF if no
+ * records remain.  If the stream ended in the middle of a word, the last
+ * record holds the word so far, and this returns SIMPLE_LEXER_ESCAPING_EOF
+ * or SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN along with it.  (If the record
+ * would be empty, this stores zero and NULL in `argc` and `argv` instead.)
+ * This can also return SIMPLE_LEXER_OUT_OF_MEMORY, as
+ * SimpleLineSplitter_Next() can.
+ */
+extern SimpleLexerError SimpleLineSplitter_Finish(
+    SimpleLineSplitter* SIMPLELEXER_RESTRICT splitter,
+    int* SIMPLELEXER_RESTRICT argc,
+    char*** SIMPLELEXER_RESTRICT argv);
+
+/*
+ * Start a new stream, keeping the splitter's memory for reuse.
+ */
+extern void SimpleLineSplitter_Reset(SimpleLineSplitter* splitter);
+
+/*
+ * Free a splitter's memory.
+ */
+extern void SimpleLineSplitter_Destroy(SimpleLineSplitter* splitter);
+
+/*
+ * This maps byte offsets within a stream of text to lines and columns
+ * (and lines to their starting offsets) in logarithmic time, no matter
+ * which order the lookups come in.  Build it by adding the stream's text
+ * to it as you lex, such as by passing each input to both
+ * SimpleLexer_SetInput() and SimpleLineIndex_Add().  Lines and columns
+ * match what lexers that track lines compute when their columns count bytes.
+ *
+ * Lexers don't feed indexes: SimpleLineIndex_Add() scans its text for
+ * newlines itself, which is a second pass over each input.  (Lexers that
+ * don't track lines skip newlines without recording them.)  Add each input
+ * right before or after lexing it, while it's still in the CPU's caches,
+ * to keep that pass cheap.
+ *
+ * The index stores the offsets of the stream's newlines in blocks of
+ * SIMPLE_LINE_INDEX_BLOCK_LINES newlines.  Each block holds its first
+ * newline's offset; the rest are varint-encoded distances from the
+ * preceding newline, so typical lines take a byte or two.
+ *
+ * Initialize indexes via SimpleLineIndex_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+#define SIMPLE_LINE_INDEX_BLOCK_LINES 64
+
+typedef struct SimpleLineIndexBlock {
+    size_t firstNewline;        /* the offset of the block's first newline */
+    size_t deltasStart;         /* where the block's distances start
+                                   in the index's deltas */
+} SimpleLineIndexBlock;
+
+typedef struct SimpleLineIndex {
+    SimpleLineIndexBlock* blocks;
+    size_t numBlocks;
+    size_t blockCapacity;       /* blocks' capacity in blocks */
+    unsigned char* deltas;      /* the varint-encoded newline distances */
+    size_t deltasSize;          /* deltas' length in bytes */
+    size_t deltasCapacity;      /* deltas' capacity in bytes */
+    size_t numNewlines;         /* the number of newlines in the text */
+    size_t lastNewline;         /* the offset of the last newline */
+    size_t size;                /* the length of the indexed text */
+    SimpleLexerAllocator allocator; /* allocates blocks and deltas */
+} SimpleLineIndex;
+
+/*
+ * Initialize an empty index that allocates memory using `allocator`
+ * (or SimpleLexer_StandardAllocator if `allocator` is NULL).
+ */
+extern void SimpleLineIndex_Init(
+    SimpleLineIndex* SIMPLELEXER_RESTRICT index,
+    const SimpleLexerAllocator* SIMPLELEXER_RESTRICT allocator);
+
+/*
+ * Append `textSize` bytes of text to the indexed stream.
+ *
+ * Return SIMPLE_LEXER_OK on success or SIMPLE_LEXER_OUT_OF_MEMORY if the
+ * index's allocator failed, in which case the index is unchanged.
+ */
+extern SimpleLexerError SimpleLineIndex_Add(
+    SimpleLineIndex* SIMPLELEXER_RESTRICT index,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t textSize);
+
+/*
+ * Forget the indexed stream beyond its first `size` bytes.  Do this before
+ * adding a new input if the lexer didn't consume all of the last input
+ * (see SimpleLexer_SetInput()): Truncate the index to the lexer's
+ * currentPosition.offset.  This does nothing if `size` is at least the
+ * length of the indexed stream.
+ */
+extern void SimpleLineIndex_Truncate(SimpleLineIndex* index, size_t size);
+
+/*
+ * Set `position`'s line and column from its offset, which may be the
+ * length of the indexed stream (the position just past its end).
+ * This returns zero on success and nonzero if the offset lies beyond that.
+ */
+extern int SimpleLineIndex_GetPosition(
+    const SimpleLineIndex* SIMPLELEXER_RESTRICT index,
+    TextPosition* SIMPLELEXER_RESTRICT position);
+
+/*
+ * Store the offset of the first byte of the one-based line `line`
+ * in `offset`.  This returns zero on success and nonzero if the indexed
+ * stream doesn't have that many lines.  (A stream with N newlines has
+ * N + 1 lines, the last of which might be empty.)
+ */
+extern int SimpleLineIndex_GetLineStart(
+    const SimpleLineIndex* SIMPLELEXER_RESTRICT index,
+    size_t line,
+    size_t* SIMPLELEXER_RESTRICT offset);
+
+/*
+ * Forget the indexed stream, keeping the index's memory for reuse.
+ */
+extern void SimpleLineIndex_Reset(SimpleLineIndex* index);
+
+/*
+ * Free an index's memory.
+ */
+extern void SimpleLineIndex_Destroy(SimpleLineIndex* index);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,792 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a header-only C++17 interface to SimpleLexer.  It offers:
+ *
+ *    o  simplelexer::Lexer, which owns a growable SimpleLexer and iterates
+ *       over the tokens of each input that it's given;
+ *
+ *    o  simplelexer::BasicTokenizer, a class template that lexes a whole
+ *       text in memory with a lexing loop specialized at compile time
+ *       for a policy class that picks the comment, quote, and escape
+ *       characters, the escape sequences, and whether to track lines.
+ *
+ * Both produce simplelexer::Tokens, whose text is a std::string_view
+ * that is valid until the next token is lexed.  Like the C functions,
+ * neither throws exceptions while lexing: They report errors, including
+ * running out of memory, via SimpleLexerError codes.  Only Lexer's
+ * constructor throws (std::bad_alloc).
+ */
+
+#ifndef __SIMPLELEXER_HPP
+#define __SIMPLELEXER_HPP
+
+#include "simplelexer.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace simplelexer
+{
+
+/*
+ * This is a lexed token.  Unlike SimpleToken, its text isn't NUL-terminated.
+ */
+struct Token
+{
+    std::string_view text;      /* the token's text */
+    TextSpan span;              /* where the token is in its stream */
+    bool quoted;                /* whether the token was quoted */
+    bool startedEscaped;        /* whether it started with an escape */
+    bool isView;                /* whether text points into the input */
+    bool firstFragment;         /* see SimpleLexer_SetFragments() */
+    bool lastFragment;          /* see SimpleLexer_SetFragments() */
+    std::uint32_t symbol;       /* see SimpleLexer_SetSymbolTable() */
+    int keyword;                /* see SimpleLexer_SetKeywords() */
+
+    static Token FromSimpleToken(const SimpleToken& token) noexcept
+    {
+        Token result;
+
+        result.text = std::string_view(token.text, token.length);
+        result.span = token.span;
+        result.quoted = token.quoted != 0;
+        result.startedEscaped = token.startedEscaped != 0;
+        result.isView = token.isView != 0;
+        result.firstFragment = token.firstFragment != 0;
+        result.lastFragment = token.lastFragment != 0;
+        result.symbol = token.symbol;
+        result.keyword = token.keyword;
+        return result;
+    }
+};
+
+/*
+ * This is an input iterator over the tokens of a `Source`, which is either
+ * a Lexer or a BasicTokenizer.  Incrementing it lexes the next token,
+ * so only one token of a source is valid at a time.  It equals the end
+ * iterator (a default-constructed one) once the source's next() returns false,
+ * after which the source's error() says why.
+ */
+template <typename Source>
+class TokenIterator
+{
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Token;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Token*;
+    using reference = const Token&;
+
+    TokenIterator() noexcept = default;
+
+    explicit TokenIterator(Source& source) noexcept : source_(&source)
+    {
+        ++*this;
+    }
+
+    reference operator*() const noexcept
+    {
+        return token_;
+    }
+
+    pointer operator->() const noexcept
+    {
+        return &token_;
+    }
+
+    TokenIterator& operator++() noexcept
+    {
+        if (!source_->next(token_))
+        {
+            source_ = nullptr;
+        }
+        return *this;
+    }
+
+    void operator++(int) noexcept
+    {
+        ++*this;
+    }
+
+    friend bool operator==(
+        const TokenIterator& left,
+        const TokenIterator& right) noexcept
+    {
+        return left.source_ == right.source_;
+    }
+
+    friend bool operator!=(
+        const TokenIterator& left,
+        const TokenIterator& right) noexcept
+    {
+        return left.source_ != right.source_;
+    }
+
+private:
+    Source* source_ = nullptr;
+    Token token_ = {};
+};
+
+/*
+ * This is a range over a source's remaining tokens for range-based for loops.
+ */
+template <typename Source>
+class TokenRange
+{
+public:
+    explicit TokenRange(Source& source) noexcept : source_(source)
+    {
+    }
+
+    TokenIterator<Source> begin() const noexcept
+    {
+        return TokenIterator<Source>(source_);
+    }
+
+    TokenIterator<Source> end() const noexcept
+    {
+        return TokenIterator<Source>();
+    }
+
+private:
+    Source& source_;
+};
+
+/*
+ * This owns a growable SimpleLexer (see SimpleLexer_InitGrowable()) with
+ * token views enabled and frees its token buffer when it's destroyed.
+ * It lexes streams of inputs just like the lexer that it wraps:
+ *
+ *    simplelexer::Lexer lexer;
+ *
+ *    for (const simplelexer::Token& token : lexer.tokens(chunk))
+ *    {
+ *        // Do something with token.text.
+ *    }
+ *    if (lexer.error() != SIMPLE_LEXER_EOF)
+ *    {
+ *        // The token was too large, or memory ran out.
+ *    }
+ *    ...
+ *    error = lexer.finish(token);
+ *
+ * Use get() to pass the wrapped lexer to the C functions, for example,
+ * to change its settings.
+ */
+class Lexer
+{
+public:
+    /*
+     * Initialize the lexer.  This throws std::bad_alloc if the lexer's
+     * token buffer can't be allocated.
+     */
+    explicit Lexer(
+        std::size_t maxTokenSize = SIZE_MAX,
+        const SimpleLexerAllocator* allocator = nullptr)
+    {
+        if (SimpleLexer_InitGrowable(&lexer_, allocator,
+            maxTokenSize < InitialBufferSize ? maxTokenSize
+                : InitialBufferSize,
+            maxTokenSize) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        SimpleLexer_SetTokenViews(&lexer_, 1);
+    }
+
+    ~Lexer()
+    {
+        SimpleLexer_Destroy(&lexer_);
+    }
+
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
+    SimpleLexer* get() noexcept
+    {
+        return &lexer_;
+    }
+
+    const SimpleLexer* get() const noexcept
+    {
+        return &lexer_;
+    }
+
+    /*
+     * See SimpleLexer_SetInput().  The lexer doesn't copy `text`.
+     */
+    void setInput(std::string_view text) noexcept
+    {
+        SimpleLexer_SetInput(&lexer_, text.data() != nullptr ? text.data()
+            : "", text.size());
+    }
+
+    /*
+     * Lex the next token in the current input via SimpleLexer_GetNextToken().
+     * This returns false, leaving the result in error(), if there isn't one.
+     * Fragments (see SimpleLexer_SetFragments()) count as tokens.
+     */
+    bool next(Token& token) noexcept
+    {
+        SimpleToken simpleToken;
+
+        error_ = SimpleLexer_GetNextToken(&lexer_, &simpleToken);
+        if (error_ != SIMPLE_LEXER_OK && error_ != SIMPLE_LEXER_PARTIAL_TOKEN)
+        {
+            return false;
+        }
+        token = Token::FromSimpleToken(simpleToken);
+        return true;
+    }
+
+    /*
+     * Set the lexer's input to `text` and return a range over its tokens.
+     */
+    TokenRange<Lexer> tokens(std::string_view text) noexcept
+    {
+        setInput(text);
+        return TokenRange<Lexer>(*this);
+    }
+
+    /*
+     * Pass each token in `text` to `handler`, which returns true to stop
+     * lexing, via SimpleLexer_Feed().  `handler` must not throw.
+     */
+    template <typename Handler>
+    SimpleLexerError feed(std::string_view text, Handler&& handler) noexcept
+    {
+        using HandlerType = typename std::remove_reference<Handler>::type;
+
+        error_ = SimpleLexer_Feed(&lexer_,
+            text.data() != nullptr ? text.data() : "", text.size(),
+            [](void* context, const SimpleToken* token) -> int
+            {
+                return (*static_cast<HandlerType*>(context))(
+                    Token::FromSimpleToken(*token)) ? 1 : 0;
+            },
+            const_cast<void*>(static_cast<const void*>(&handler)));
+        return error_;
+    }
+
+    /*
+     * Finish the stream via SimpleLexer_Finish().  If there's a final token,
+     * this stores it in `token`.  Otherwise, `token.text.data()` is null.
+     */
+    SimpleLexerError finish(Token& token) noexcept
+    {
+        SimpleToken simpleToken;
+
+        simpleToken.text = nullptr;
+        error_ = SimpleLexer_Finish(&lexer_, &simpleToken);
+        token = simpleToken.text != nullptr
+            ? Token::FromSimpleToken(simpleToken)
+            : Token();
+        return error_;
+    }
+
+    /*
+     * Return the result of the last call that lexed tokens.
+     */
+    SimpleLexerError error() const noexcept
+    {
+        return error_;
+    }
+
+    /*
+     * Reset the lexer for a new stream via SimpleLexer_Reset().
+     */
+    void reset() noexcept
+    {
+        SimpleLexer_Reset(&lexer_);
+        error_ = SIMPLE_LEXER_OK;
+    }
+
+private:
+    static constexpr std::size_t InitialBufferSize = 256;
+
+    SimpleLexer lexer_;
+    SimpleLexerError error_ = SIMPLE_LEXER_OK;
+};
+
+/*
+ * Policies use this for characters that they don't have.
+ */
+constexpr int None = -1;
+
+/*
+ * This is the policy of SimpleLexer's own language.  Derive policies
+ * from it and hide the members that you want to change:
+ *
+ *    struct IniPolicy : simplelexer::DefaultPolicy
+ *    {
+ *        static constexpr int comment = ';';
+ *        static constexpr int escape = simplelexer::None;
+ *    };
+ *
+ * Characters must be distinct and must not be whitespace.
+ */
+struct DefaultPolicy
+{
+    /* the character that starts comments, which run to the end of line */
+    static constexpr int comment = '#';
+
+    /* the character that opens and closes quoted tokens */
+    static constexpr int quote = '"';
+
+    /* the character that escapes the following character */
+    static constexpr int escape = '\\';
+
+    /* whether spans have lines and columns (offsets are always there) */
+    static constexpr bool trackLines = true;
+
+    /* what an escape character followed by `c` means */
+    static constexpr char unescape(char c) noexcept
+    {
+        switch (c)
+        {
+            case 'a': return '\a';
+            case 'b': return '\b';
+            case 'f': return '\f';
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            case 'v': return '\v';
+            default: return c;
+        }
+    }
+};
+
+namespace detail
+{
+
+enum CharClass : unsigned char
+{
+    Other,
+    Space,                      /* whitespace (but newlines) and NUL */
+    Newline,
+    Quote,
+    Escape,
+    Comment
+};
+
+constexpr bool IsSpace(int c) noexcept
+{
+    return c == '\0' || c == '\t' || c == '\n' || c == '\v' || c == '\f'
+        || c == '\r' || c == ' ';
+}
+
+/*
+ * Return the classes of bytes under `Policy`.  Whitespace is what isspace()
+ * recognizes in the "C" locale, as in SimpleLexer.
+ */
+template <typename Policy>
+constexpr std::array<unsigned char, 256> MakeCharClasses() noexcept
+{
+    std::array<unsigned char, 256> classes = {};
+
+    classes['\0'] = Space;
+    classes['\t'] = Space;
+    classes['\n'] = Newline;
+    classes['\v'] = Space;
+    classes['\f'] = Space;
+    classes['\r'] = Space;
+    classes[' '] = Space;
+    if (Policy::quote != None)
+    {
+        classes[static_cast<unsigned char>(Policy::quote)] = Quote;
+    }
+    if (Policy::escape != None)
+    {
+        classes[static_cast<unsigned char>(Policy::escape)] = Escape;
+    }
+    if (Policy::comment != None)
+    {
+        classes[static_cast<unsigned char>(Policy::comment)] = Comment;
+    }
+    return classes;
+}
+
+template <typename Policy>
+struct CharClasses
+{
+    static_assert(Policy::comment == None
+        || (Policy::comment != Policy::quote
+            && Policy::comment != Policy::escape
+            && !IsSpace(Policy::comment)),
+        "the comment character must be distinct and not whitespace");
+    static_assert(Policy::quote == None
+        || (Policy::quote != Policy::escape && !IsSpace(Policy::quote)),
+        "the quote character must be distinct and not whitespace");
+    static_assert(Policy::escape == None || !IsSpace(Policy::escape),
+        "the escape character must not be whitespace");
+
+    static constexpr std::array<unsigned char, 256> Table =
+        MakeCharClasses<Policy>();
+};
+
+}  // namespace detail
+
+/*
+ * This lexes a whole text in memory under `Policy` (see DefaultPolicy).
+ * With DefaultPolicy, its tokens and spans are exactly what a SimpleLexer
+ * tracking lines would return for the text as its only input, followed
+ * by SimpleLexer_Finish().  Everything that the policy leaves out, such as
+ * comments or line tracking, is compiled out of its lexing loop.
+ *
+ * Tokens without escape sequences are views into the text.  The others'
+ * texts live in the tokenizer, which reuses its buffer.  Neither symbols
+ * nor keywords are supported, so those fields are always
+ * SIMPLE_SYMBOL_NONE and SIMPLE_KEYWORD_NONE.
+ *
+ *    simplelexer::BasicTokenizer<IniPolicy> tokenizer(text);
+ *
+ *    for (const simplelexer::Token& token : tokenizer.tokens())
+ *    {
+ *        ...
+ *    }
+ *    if (tokenizer.error() != SIMPLE_LEXER_EOF)
+ *    {
+ *        // The text ended inside a quoted token or an escape sequence.
+ *    }
+ */
+template <typename Policy = DefaultPolicy>
+class BasicTokenizer
+{
+public:
+    explicit BasicTokenizer(std::string_view text) noexcept
+        : begin_(text.data()),
+          position_(text.data()),
+          end_(text.data() + text.size())
+    {
+    }
+
+    /*
+     * Lex the next token.  This returns false if there are no more.
+     * Then error() is SIMPLE_LEXER_EOF if the text was well-formed and
+     * SIMPLE_LEXER_ESCAPING_EOF or SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN
+     * as SimpleLexer_Finish() returns them otherwise.  (As with
+     * SimpleLexer_Finish(), the last token before such errors might be
+     * incomplete.)  error() is SIMPLE_LEXER_OUT_OF_MEMORY if decoding
+     * a token's escape sequences ran out of memory.
+     */
+    bool next(Token& token) noexcept
+    {
+        unsigned char charClass;
+
+        if (error_ != SIMPLE_LEXER_OK)
+        {
+            return false;
+        }
+
+        /* Skip whitespace and comments. */
+        for (;;)
+        {
+            if (position_ == end_)
+            {
+                error_ = SIMPLE_LEXER_EOF;
+                return false;
+            }
+            charClass = ClassOf(*position_);
+            if (charClass == detail::Space || charClass == detail::Newline)
+            {
+                Consume(*position_);
+            }
+            else if (Policy::comment != None && charClass == detail::Comment)
+            {
+                const void* newline = std::memchr(position_, '\n',
+                    static_cast<std::size_t>(end_ - position_));
+                Skip(newline != nullptr
+                    ? static_cast<const char*>(newline) - position_
+                    : end_ - position_);
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        token.span.start = Here();
+        token.quoted = charClass == detail::Quote;
+        token.startedEscaped = charClass == detail::Escape;
+        token.firstFragment = true;
+        token.lastFragment = true;
+        token.symbol = SIMPLE_SYMBOL_NONE;
+        token.keyword = SIMPLE_KEYWORD_NONE;
+        try
+        {
+            if (Policy::quote != None && charClass == detail::Quote)
+            {
+                Consume(*position_);
+                return Lex<true>(token);
+            }
+            return Lex<false>(token);
+        }
+        catch (const std::bad_alloc&)
+        {
+            error_ = SIMPLE_LEXER_OUT_OF_MEMORY;
+            return false;
+        }
+    }
+
+    /*
+     * Return why next() last returned false or SIMPLE_LEXER_OK if it hasn't.
+     */
+    SimpleLexerError error() const noexcept
+    {
+        return error_;
+    }
+
+    /*
+     * Return a range over the remaining tokens.
+     */
+    TokenRange<BasicTokenizer> tokens() noexcept
+    {
+        return TokenRange<BasicTokenizer>(*this);
+    }
+
+private:
+    static unsigned char ClassOf(char c) noexcept
+    {
+        return detail::CharClasses<Policy>::Table[
+            static_cast<unsigned char>(c)];
+    }
+
+    /*
+     * Consume the byte `c` at the current position.
+     */
+    void Consume(char c) noexcept
+    {
+        if constexpr (Policy::trackLines)
+        {
+            if (c == '\n')
+            {
+                ++line_;
+                previousLineColumns_ = column_;
+                column_ = 1;
+            }
+            else
+            {
+                ++column_;
+            }
+        }
+        ++position_;
+    }
+
+    /*
+     * Consume `count` bytes, none of which are newlines.
+     */
+    void Skip(std::ptrdiff_t count) noexcept
+    {
+        if constexpr (Policy::trackLines)
+        {
+            column_ += static_cast<std::size_t>(count);
+        }
+        position_ += count;
+    }
+
+    TextPosition Here() const noexcept
+    {
+        TextPosition here;
+
+        here.line = line_;
+        here.column = column_;
+        here.offset = static_cast<std::size_t>(position_ - begin_);
+        return here;
+    }
+
+    /*
+     * Return the position of the byte before the current position,
+     * which ends the current token.
+     */
+    TextPosition BeforeHere() const noexcept
+    {
+        TextPosition before;
+
+        before.line = line_;
+        before.column = column_;
+        if constexpr (Policy::trackLines)
+        {
+            if (column_ != 1)
+            {
+                --before.column;
+            }
+            else if (line_ > 1)
+            {
+                --before.line;
+                before.column = previousLineColumns_;
+            }
+        }
+        before.offset = static_cast<std::size_t>(position_ - begin_) - 1;
+        return before;
+    }
+
+    /*
+     * Store the token that starts at `start` and ends just before
+     * the current position.  Its text is `text_` if it was `escaped`.
+     */
+    void SetText(Token& token, const char* start, bool escaped) noexcept
+    {
+        token.text = escaped
+            ? std::string_view(text_)
+            : std::string_view(start,
+                static_cast<std::size_t>(position_ - start));
+        token.isView = !escaped;
+    }
+
+    /*
+     * Store the final token, if there is one, and the error that ends
+     * the text.
+     */
+    bool FinishText(
+        Token& token,
+        const char* start,
+        bool escaped,
+        SimpleLexerError error) noexcept
+    {
+        error_ = error;
+        SetText(token, start, escaped);
+        if (token.text.empty())
+        {
+            return false;
+        }
+        token.span.end = BeforeHere();
+        return true;
+    }
+
+    /*
+     * Lex the rest of a token.  Runs of ordinary bytes are consumed in bulk.
+     * Unquoted tokens stop at anything but ordinary bytes and escapes,
+     * and quoted tokens' runs stop at quotation marks, escapes, and
+     * (if lines are tracked) newlines.
+     */
+    template <bool Quoted>
+    bool Lex(Token& token)
+    {
+        const char* start;
+        const char* run;
+        unsigned char charClass;
+        bool escaped;
+
+        start = position_;
+        escaped = false;
+        for (;;)
+        {
+            for (run = position_; run != end_; ++run)
+            {
+                charClass = ClassOf(*run);
+                if (Quoted
+                    ? charClass == detail::Quote
+                        || charClass == detail::Escape
+                        || (Policy::trackLines
+                            && charClass == detail::Newline)
+                    : charClass != detail::Other)
+                {
+                    break;
+                }
+            }
+            if (escaped)
+            {
+                text_.append(position_, static_cast<std::size_t>(
+                    run - position_));
+            }
+            Skip(run - position_);
+
+            if (position_ == end_)
+            {
+                return FinishText(token, start, escaped, Quoted
+                    ? SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN
+                    : SIMPLE_LEXER_EOF);
+            }
+
+            charClass = ClassOf(*position_);
+            if (charClass == detail::Escape)
+            {
+                if (!escaped)
+                {
+                    text_.assign(start, static_cast<std::size_t>(
+                        position_ - start));
+                    escaped = true;
+                }
+                Consume(*position_);
+                if (position_ == end_)
+                {
+                    return FinishText(token, start, escaped, Quoted
+                        ? SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN
+                        : SIMPLE_LEXER_ESCAPING_EOF);
+                }
+                text_ += Policy::unescape(*position_);
+                Consume(*position_);
+            }
+            else if (Quoted && charClass == detail::Newline)
+            {
+                if (escaped)
+                {
+                    text_ += '\n';
+                }
+                Consume('\n');
+            }
+            else if (Quoted)
+            {
+                /* The closing quotation mark ends the token. */
+                SetText(token, start, escaped);
+                token.span.end = Here();
+                Consume(*position_);
+                return true;
+            }
+            else
+            {
+                /* Delimiters end unquoted tokens without being consumed. */
+                SetText(token, start, escaped);
+                token.span.end = BeforeHere();
+                return true;
+            }
+        }
+    }
+
+    const char* begin_;
+    const char* position_;
+    const char* end_;
+    std::size_t line_ = Policy::trackLines ? 1 : 0;
+    std::size_t column_ = Policy::trackLines ? 1 : 0;
+    std::size_t previousLineColumns_ = 0;
+    SimpleLexerError error_ = SIMPLE_LEXER_OK;
+    std::string text_;          /* the current token's decoded text */
+};
+
+using Tokenizer = BasicTokenizer<DefaultPolicy>;
+
+}  // namespace simplelexer
+
+#endif  /* __SIMPLELEXER_HPP */
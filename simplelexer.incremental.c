@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "simplelexer.incremental.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the initial size of the stream lexers' growable token buffers */
+#define SIMPLE_TOKEN_STREAM_BUFFER_SIZE 256
+
+/* the smallest number of entries that streams allocate */
+#define SIMPLE_TOKEN_STREAM_MIN_CAPACITY 64
+
+/*
+ * Add `offsetShift` to an entry's offsets and `lineShift` to its lines.
+ * Shifting by minus the text's size and last line makes the entry's
+ * positions relative to the end of the text.  (Unsigned arithmetic wraps
+ * around, so shifting back restores them.)
+ */
+static void SimpleTokenStream_Shift(
+    SimpleTokenStreamEntry* entry,
+    size_t offsetShift,
+    size_t lineShift)
+{
+    entry->token.span.start.offset += offsetShift;
+    entry->token.span.end.offset += offsetShift;
+    entry->end.offset += offsetShift;
+    entry->token.span.start.line += lineShift;
+    entry->token.span.end.line += lineShift;
+    entry->end.line += lineShift;
+}
+
+/*
+ * Move the gap so that it starts at the `index`th entry.
+ */
+static void SimpleTokenStream_MoveGap(SimpleTokenStream* stream, size_t index)
+{
+    SimpleTokenStreamEntry* entries;
+
+    entries = stream->entries;
+    while (stream->gapStart > index)
+    {
+        --stream->gapStart;
+        --stream->gapEnd;
+        entries[stream->gapEnd] = entries[stream->gapStart];
+        SimpleTokenStream_Shift(&entries[stream->gapEnd], 0 - stream->size,
+            0 - stream->lastLine);
+    }
+    while (stream->gapStart < index)
+    {
+        entries[stream->gapStart] = entries[stream->gapEnd];
+        SimpleTokenStream_Shift(&entries[stream->gapStart], stream->size,
+            stream->lastLine);
+        ++stream->gapStart;
+        ++stream->gapEnd;
+    }
+}
+
+/*
+ * Return the offset of the end of the `index`th entry's token.
+ */
+static size_t SimpleTokenStream_GetEndOffset(
+    const SimpleTokenStream* stream,
+    size_t index)
+{
+    if (index < stream->gapStart)
+    {
+        return stream->entries[index].end.offset;
+    }
+    return stream->entries[index + stream->gapEnd - stream->gapStart]
+        .end.offset + stream->size;
+}
+
+/*
+ * Append an entry to the entries before the gap.
+ */
+static int SimpleTokenStream_Insert(
+    SimpleTokenStream* restrict stream,
+    const SimpleTokenStreamEntry* restrict entry)
+{
+    SimpleTokenStreamEntry* entries;
+    size_t capacity;
+    size_t numAfterGap;
+
+    if (stream->gapStart == stream->gapEnd)
+    {
+        capacity = stream->capacity > SIMPLE_TOKEN_STREAM_MIN_CAPACITY / 2
+            ? stream->capacity * 2
+            : SIMPLE_TOKEN_STREAM_MIN_CAPACITY;
+        if (capacity > SIZE_MAX / sizeof(*entries))
+        {
+            return 1;
+        }
+        entries = realloc(stream->entries, capacity * sizeof(*entries));
+        if (entries == NULL)
+        {
+            return 1;
+        }
+
+        numAfterGap = stream->capacity - stream->gapEnd;
+        (void) memmove(entries + capacity - numAfterGap,
+            entries + stream->gapEnd, numAfterGap * sizeof(*entries));
+        stream->entries = entries;
+        stream->capacity = capacity;
+        stream->gapEnd = capacity - numAfterGap;
+    }
+
+    stream->entries[stream->gapStart++] = *entry;
+    return 0;
+}
+
+/*
+ * Free the text of an entry's token if the token isn't a view.
+ */
+static void SimpleTokenStream_DestroyEntry(SimpleTokenStreamEntry* entry)
+{
+    if (entry->token.text != NULL)
+    {
+        SimpleToken_Destroy(&entry->token);
+    }
+}
+
+/*
+ * Remove the entry after the gap.
+ */
+static void SimpleTokenStream_Drop(SimpleTokenStream* stream)
+{
+    assert(stream->gapEnd < stream->capacity);
+
+    SimpleTokenStream_DestroyEntry(&stream->entries[stream->gapEnd++]);
+}
+
+/*
+ * Remove all of the stream's entries.
+ */
+static void SimpleTokenStream_Clear(SimpleTokenStream* stream)
+{
+    SimpleTokenStream_MoveGap(stream, 0);
+    while (stream->gapEnd < stream->capacity)
+    {
+        SimpleTokenStream_Drop(stream);
+    }
+    stream->size = 0;
+    stream->lastLine = 1;
+    stream->error = SIMPLE_LEXER_EOF;
+}
+
+SimpleLexerError SimpleTokenStream_Init(
+    SimpleTokenStream* restrict stream,
+    const char* restrict text,
+    size_t size)
+{
+    SimpleTokenRange changed;
+
+    assert(stream != NULL);
+    assert(text != NULL || size == 0);
+
+    stream->entries = NULL;
+    stream->capacity = 0;
+    stream->gapStart = 0;
+    stream->gapEnd = 0;
+    stream->text = NULL;
+    stream->size = 0;
+    stream->lastLine = 1;
+    stream->error = SIMPLE_LEXER_EOF;
+    return SimpleTokenStream_Update(stream, text, size, 0, 0, size, &changed);
+}
+
+/*
+ * Take a checkpoint of `lexer`, which just lexed a token.
+ */
+static void SimpleTokenStream_Checkpoint(
+    const SimpleLexer* restrict lexer,
+    SimpleLexerCheckpoint* restrict checkpoint)
+{
+    checkpoint->offset = lexer->inputOffset + lexer->inputIndex;
+    checkpoint->line = lexer->currentPosition.line;
+    checkpoint->column = lexer->currentPosition.column;
+    checkpoint->numColumnsInPreviousLine = lexer->numColumnsInPreviousLine;
+    checkpoint->state = lexer->finished
+        ? SIMPLE_LEXER_NUMSTATES
+        : lexer->state;
+}
+
+SimpleLexerError SimpleTokenStream_Update(
+    SimpleTokenStream* restrict stream,
+    const char* restrict text,
+    size_t size,
+    size_t editStart,
+    size_t oldEditEnd,
+    size_t newEditEnd,
+    SimpleTokenRange* restrict changed)
+{
+    static const SimpleLexerCheckpoint start = {
+        0, 1, 1, 0, SIMPLE_LEXER_STATE_NORMAL
+    };
+    SimpleLexer lexer;
+    SimpleLexerCheckpoint checkpoint;
+    SimpleTokenStreamEntry entry;
+    SimpleTokenStreamEntry* old;
+    SimpleToken token;
+    SimpleLexerError error;
+    size_t low;
+    size_t high;
+    size_t middle;
+    size_t oldSize;
+
+    assert(stream != NULL);
+    assert(text != NULL || size == 0);
+    assert(changed != NULL);
+    assert(editStart <= oldEditEnd && oldEditEnd <= stream->size);
+    assert(editStart <= newEditEnd && newEditEnd <= size);
+    assert(size - newEditEnd == stream->size - oldEditEnd);
+
+    /* Restart from the last checkpoint before the edit.  (Tokens that end
+       at the edit might have ended differently without it.) */
+    low = 0;
+    high = SimpleTokenStream_GetNumTokens(stream);
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (SimpleTokenStream_GetEndOffset(stream, middle) < editStart)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    SimpleTokenStream_MoveGap(stream, low);
+    checkpoint = low != 0 ? stream->entries[low - 1].end : start;
+
+    changed->first = low;
+    changed->numRemoved = 0;
+    changed->numInserted = 0;
+
+    if (SimpleLexer_InitGrowable(&lexer, NULL,
+        SIMPLE_TOKEN_STREAM_BUFFER_SIZE, SIZE_MAX) != 0)
+    {
+        SimpleTokenStream_Clear(stream);
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    lexer.state = checkpoint.state;
+    lexer.currentPosition.line = checkpoint.line;
+    lexer.currentPosition.column = checkpoint.column;
+    lexer.currentPosition.offset = checkpoint.offset;
+    lexer.numColumnsInPreviousLine = checkpoint.numColumnsInPreviousLine;
+    lexer.inputOffset = checkpoint.offset;
+    SimpleLexer_SetInput(&lexer, text + checkpoint.offset,
+        size - checkpoint.offset);
+
+    oldSize = stream->size;
+    stream->text = text;
+    stream->size = size;
+    for (;;)
+    {
+        error = SimpleLexer_GetNextToken(&lexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            token.text = NULL;
+            error = SimpleLexer_Finish(&lexer, &token);
+            stream->error = error == SIMPLE_LEXER_OK
+                ? SIMPLE_LEXER_EOF
+                : error;
+            if (token.text == NULL)
+            {
+                break;
+            }
+        }
+        else if (error != SIMPLE_LEXER_OK)
+        {
+            break;
+        }
+
+        SimpleTokenStream_Checkpoint(&lexer, &entry.end);
+        if (token.isView)
+        {
+            entry.token = token;
+            entry.token.text = NULL;
+        }
+        else if (SimpleToken_Copy(&token, &entry.token) != 0)
+        {
+            error = SIMPLE_LEXER_OUT_OF_MEMORY;
+            break;
+        }
+
+        /* Drop the old tokens that this token replaces.  The first old
+           token that ends where this one does in the same state and column
+           ends where the text was left alone, and everything after it
+           is the same as before, shifted by the edit. */
+        while (stream->gapEnd < stream->capacity)
+        {
+            old = &stream->entries[stream->gapEnd];
+            if (old->end.offset + oldSize >= oldEditEnd
+                && old->end.offset + size >= entry.end.offset)
+            {
+                break;
+            }
+            SimpleTokenStream_Drop(stream);
+            ++changed->numRemoved;
+        }
+        if (stream->gapEnd < stream->capacity
+            && old->end.offset + size == entry.end.offset
+            && old->end.state == entry.end.state
+            && old->end.column == entry.end.column)
+        {
+            stream->lastLine = entry.end.line - old->end.line;
+            SimpleTokenStream_Drop(stream);
+            ++changed->numRemoved;
+            (void) SimpleTokenStream_Insert(stream, &entry);
+            ++changed->numInserted;
+            SimpleLexer_Destroy(&lexer);
+            return SIMPLE_LEXER_OK;
+        }
+
+        if (SimpleTokenStream_Insert(stream, &entry) != 0)
+        {
+            SimpleTokenStream_DestroyEntry(&entry);
+            error = SIMPLE_LEXER_OUT_OF_MEMORY;
+            break;
+        }
+        ++changed->numInserted;
+        if (lexer.finished)
+        {
+            break;
+        }
+    }
+
+    SimpleLexer_Destroy(&lexer);
+    if (error == SIMPLE_LEXER_OUT_OF_MEMORY)
+    {
+        SimpleTokenStream_Clear(stream);
+        return error;
+    }
+
+    /* The lexer reached the end of the text without resynchronizing. */
+    while (stream->gapEnd < stream->capacity)
+    {
+        SimpleTokenStream_Drop(stream);
+        ++changed->numRemoved;
+    }
+    stream->lastLine = lexer.currentPosition.line;
+    return SIMPLE_LEXER_OK;
+}
+
+size_t SimpleTokenStream_GetNumTokens(const SimpleTokenStream* stream)
+{
+    assert(stream != NULL);
+
+    return stream->capacity - (stream->gapEnd - stream->gapStart);
+}
+
+void SimpleTokenStream_GetToken(
+    const SimpleTokenStream* restrict stream,
+    size_t index,
+    SimpleToken* restrict token)
+{
+    SimpleTokenStreamEntry entry;
+
+    assert(stream != NULL);
+    assert(index < SimpleTokenStream_GetNumTokens(stream));
+    assert(token != NULL);
+
+    if (index < stream->gapStart)
+    {
+        entry = stream->entries[index];
+    }
+    else
+    {
+        entry = stream->entries[index + stream->gapEnd - stream->gapStart];
+        SimpleTokenStream_Shift(&entry, stream->size, stream->lastLine);
+    }
+
+    *token = entry.token;
+    if (token->text == NULL)
+    {
+        /* Views' text starts after their opening quotation marks. */
+        token->text = (char*)(stream->text + token->span.start.offset
+            + (token->quoted ? 1 : 0));
+    }
+}
+
+void SimpleTokenStream_Destroy(SimpleTokenStream* stream)
+{
+    assert(stream != NULL);
+
+    SimpleTokenStream_Clear(stream);
+    free(stream->entries);
+    stream->entries = NULL;
+    stream->capacity = 0;
+    stream->gapStart = 0;
+    stream->gapEnd = 0;
+}
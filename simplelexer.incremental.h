@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a driver that keeps the tokens of an edited text up to date,
+ * such as in an editor or a language server, by re-lexing only the parts
+ * of the text that edits affect.
+ */
+
+#ifndef __SIMPLELEXER_INCREMENTAL_H
+#define __SIMPLELEXER_INCREMENTAL_H
+
+#include "simplelexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * This is a snapshot of a SimpleLexer between two tokens: everything that
+ * lexing the rest of the text depends on.  A lexer restored from it
+ * lexes the rest of the text exactly as the original lexer did.
+ */
+typedef struct SimpleLexerCheckpoint {
+    size_t offset;              /* where in the text lexing resumes */
+    size_t line;                /* the lexer's currentPosition there */
+    size_t column;
+    size_t numColumnsInPreviousLine;
+    SimpleLexerState state;     /* SIMPLE_LEXER_NUMSTATES if the lexer had
+                                   finished the text */
+} SimpleLexerCheckpoint;
+
+/*
+ * This is a token in a SimpleTokenStream and the checkpoint after it.
+ */
+typedef struct SimpleTokenStreamEntry {
+    SimpleToken token;          /* text is NULL if the token is a view */
+    SimpleLexerCheckpoint end;
+} SimpleTokenStreamEntry;
+
+/*
+ * These are the tokens that changed after an edit: Tokens
+ * [first, first + numInserted) replaced `numRemoved` tokens that started
+ * at `first`.  The other tokens are the same, but the ones after the changed
+ * tokens might have moved.
+ */
+typedef struct SimpleTokenRange {
+    size_t first;
+    size_t numRemoved;
+    size_t numInserted;
+} SimpleTokenRange;
+
+/*
+ * This is the sequence of tokens that a growable lexer produces from a text,
+ * kept up to date as the text is edited.  Each token comes with
+ * a checkpoint of the lexer after it, so after an edit, lexing restarts
+ * from the last checkpoint before the edit and stops as soon as the
+ * lexer's state resynchronizes with a checkpoint after the edit.  Thus
+ * the time that an edit takes depends on how many tokens it changes, not
+ * on how long the text is.
+ *
+ * The entries are stored in a gap buffer whose gap follows the last edit.
+ * The positions of entries after the gap are relative to the end of the
+ * text, so edits don't move or update the entries after them.
+ *
+ * Tokens without escape sequences are views into the text.  Copies of the
+ * other tokens' text are allocated with malloc().
+ *
+ * Initialize streams via SimpleTokenStream_Init().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleTokenStream {
+    SimpleTokenStreamEntry* entries;
+    size_t capacity;            /* entries' capacity in entries */
+    size_t gapStart;            /* the index of the gap's first entry */
+    size_t gapEnd;              /* the index of the entry after the gap */
+    const char* text;           /* the current text (not owned) */
+    size_t size;                /* the current text's length */
+    size_t lastLine;            /* the line that the text ends on */
+    SimpleLexerError error;     /* what lexing the text ended with:
+                                   SIMPLE_LEXER_EOF or an error that
+                                   SimpleLexer_Finish() returns */
+} SimpleTokenStream;
+
+/*
+ * Lex all `size` bytes of `text` into `stream` in the default dialect.
+ * The stream refers to the text, which must remain valid until the next edit.
+ *
+ * This returns SIMPLE_LEXER_OK on success or SIMPLE_LEXER_OUT_OF_MEMORY
+ * if allocating memory failed.  Either way, destroy the stream when it's
+ * no longer needed.
+ */
+extern SimpleLexerError SimpleTokenStream_Init(
+    SimpleTokenStream* SIMPLELEXER_RESTRICT stream,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size);
+
+/*
+ * Update the stream after an edit replaced the bytes
+ * [editStart, oldEditEnd) of the previous text with the bytes
+ * [editStart, newEditEnd) of `text`, which is the whole edited text
+ * (`size` bytes long).  Store the tokens that changed in `changed`.
+ *
+ * This returns SIMPLE_LEXER_OK on success or SIMPLE_LEXER_OUT_OF_MEMORY
+ * if allocating memory failed, in which case the stream is empty.
+ * (Call SimpleTokenStream_Init() again to recover.)
+ */
+extern SimpleLexerError SimpleTokenStream_Update(
+    SimpleTokenStream* SIMPLELEXER_RESTRICT stream,
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size,
+    size_t editStart,
+    size_t oldEditEnd,
+    size_t newEditEnd,
+    SimpleTokenRange* SIMPLELEXER_RESTRICT changed);
+
+/*
+ * Return the number of tokens in the stream.
+ */
+extern size_t SimpleTokenStream_GetNumTokens(const SimpleTokenStream* stream);
+
+/*
+ * Store the stream's `index`th token in `token`.  The token's text is
+ * valid until the next edit or until the stream is destroyed.
+ */
+extern void SimpleTokenStream_GetToken(
+    const SimpleTokenStream* SIMPLELEXER_RESTRICT stream,
+    size_t index,
+    SimpleToken* SIMPLELEXER_RESTRICT token);
+
+/*
+ * Free all of a stream's memory, including its tokens' texts.
+ */
+extern void SimpleTokenStream_Destroy(SimpleTokenStream* stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SIMPLELEXER_INCREMENTAL_H */
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * These are the tables that define SimpleLexer's grammar.  They're private to
+ * SimpleLexer's own modules: simplelexer.c defines them, and the optional
+ * drivers that need to follow the grammar without a lexer read them here
+ * rather than keeping copies of their own.
+ */
+
+#ifndef __SIMPLELEXER_INTERNAL_H
+#define __SIMPLELEXER_INTERNAL_H
+
+#include "simplelexer.h"
+
+/*
+ * These are the classes of bytes that the lexer distinguishes.  Whitespace is
+ * what isspace() recognizes in the "C" locale, whatever the current locale is.
+ * Dialects decide which bytes are in the other classes: the names are those
+ * of the default dialect's bytes.  (See SimpleLexerDialect's classes.)
+ */
+enum {
+    SIMPLE_LEXER_CLASS_OTHER,
+    SIMPLE_LEXER_CLASS_SPACE,           /* whitespace (but newlines), NUL,
+                                           and delimiters */
+    SIMPLE_LEXER_CLASS_NEWLINE,
+    SIMPLE_LEXER_CLASS_QUOTE,
+    SIMPLE_LEXER_CLASS_BACKSLASH,
+    SIMPLE_LEXER_CLASS_HASH,
+    SIMPLE_LEXER_NUMCLASSES
+};
+
+/*
+ * These are the things that the lexer can do with a byte.
+ */
+enum {
+    SIMPLE_LEXER_SKIP,                  /* consume the byte */
+    SIMPLE_LEXER_START,                 /* start an unquoted token with it */
+    SIMPLE_LEXER_START_QUOTED,          /* start a quoted token after it */
+    SIMPLE_LEXER_START_ESCAPED,         /* start a token with an escape */
+    SIMPLE_LEXER_APPEND,                /* append it to the token */
+    SIMPLE_LEXER_ESCAPE,                /* start an escape in the token */
+    SIMPLE_LEXER_APPEND_ESCAPED,        /* append its escaped meaning */
+    SIMPLE_LEXER_FINISH,                /* finish the token and consume it */
+    SIMPLE_LEXER_FINISH_BEFORE,         /* finish the token before it */
+    SIMPLE_LEXER_FINISH_QUOTED          /* finish the quoted token with it */
+};
+
+typedef struct SimpleLexerTransition {
+    unsigned char action;               /* what to do with the byte */
+    unsigned char nextState;            /* the lexer's state afterwards */
+} SimpleLexerTransition;
+
+/*
+ * This maps the lexer's states and the classes of the bytes that it reads
+ * to what it does with the bytes and the states that it enters.  The lexer
+ * reads a byte again in its next state after SIMPLE_LEXER_FINISH_BEFORE.
+ */
+extern const SimpleLexerTransition
+SimpleLexer_Transitions[SIMPLE_LEXER_NUMSTATES][SIMPLE_LEXER_NUMCLASSES];
+
+#endif  /* __SIMPLELEXER_INTERNAL_H */
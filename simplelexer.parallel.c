@@ -0,0 +1,724 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "simplelexer.parallel.h"
+#include "simplelexer.internal.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* the smallest chunks that SimpleLexer_LexParallel() picks by itself */
+#define SIMPLE_LEXER_MIN_CHUNK_SIZE (256 * 1024)
+
+/* the number of chunks per thread that SimpleLexer_LexParallel() aims for
+   if it picks the chunk size (more chunks balance the threads' loads) */
+#define SIMPLE_LEXER_CHUNKS_PER_THREAD 4
+
+/* the initial size of the chunk lexers' growable token buffers */
+#define SIMPLE_LEXER_CHUNK_BUFFER_SIZE 256
+
+/*
+ * This is a piece of the text that SimpleLexer_LexParallel() is lexing.
+ */
+typedef struct SimpleLexerChunk {
+    size_t start;               /* the chunk's offset in the text */
+    size_t size;                /* the chunk's size in bytes */
+
+    /* the state after the chunk for each state before it */
+    unsigned char exitStates[SIMPLE_LEXER_NUMSTATES];
+
+    size_t numNewlines;         /* the number of newlines in the chunk */
+    size_t lastNewline;         /* the offsets of the chunk's last two */
+    size_t secondLastNewline;   /* newlines (SIZE_MAX if there are none) */
+
+    SimpleLexerState entryState;    /* the state before the chunk */
+    TextPosition position;      /* the position of the chunk's first byte */
+    size_t numColumnsInPreviousLine;    /* ...as SimpleLexer tracks it */
+
+    SimpleToken* tokens;        /* the tokens that start in the chunk */
+    size_t numTokens;
+    size_t tokenCapacity;
+    size_t firstToken;          /* the index of the chunk's first token
+                                   among all of the text's tokens */
+    SimpleTokenArena arena;     /* holds the texts of tokens
+                                   that aren't views */
+
+    SimpleLexerError error;     /* SIMPLE_LEXER_OUT_OF_MEMORY or
+                                   the text's final error if the text's final
+                                   token starts in the chunk */
+} SimpleLexerChunk;
+
+/*
+ * This is one of SimpleLexer_LexParallel()'s passes over the chunks.
+ */
+typedef struct SimpleLexerJob {
+    const char* text;
+    size_t size;
+    const SimpleLexerDialect* dialect;  /* the text's language */
+
+    /* This maps states and the classes of the bytes that follow them
+       to the states after the bytes. */
+    unsigned char transitions[SIMPLE_LEXER_NUMSTATES][SIMPLE_LEXER_NUMCLASSES];
+
+    SimpleLexerChunk* chunks;
+    size_t numChunks;
+    SimpleToken* tokens;        /* all of the text's tokens */
+    void (*process)(const struct SimpleLexerJob* job, SimpleLexerChunk* chunk);
+
+    pthread_mutex_t mutex;      /* guards nextChunk */
+    size_t nextChunk;           /* the next chunk that needs processing */
+} SimpleLexerJob;
+
+/*
+ * Fill in a job's state transitions from the lexer's.  An unquoted token
+ * followed by a quotation mark is finished, and the lexer reads
+ * the quotation mark again, which starts a quoted token.
+ */
+static void SimpleLexer_InitTransitions(SimpleLexerJob* job)
+{
+    const SimpleLexerTransition* transition;
+    size_t state;
+    size_t c;
+
+    for (state = 0; state < SIMPLE_LEXER_NUMSTATES; ++state)
+    {
+        for (c = 0; c < SIMPLE_LEXER_NUMCLASSES; ++c)
+        {
+            transition = &SimpleLexer_Transitions[state][c];
+            if (transition->action == SIMPLE_LEXER_FINISH_BEFORE)
+            {
+                transition =
+                    &SimpleLexer_Transitions[transition->nextState][c];
+            }
+            job->transitions[state][c] = transition->nextState;
+        }
+    }
+}
+
+/*
+ * Move each of a chunk's tracked states past a byte of class `c`.
+ */
+static inline void SimpleLexer_TransitionStates(
+    const SimpleLexerJob* restrict job,
+    unsigned char* restrict states,
+    size_t numStates,
+    unsigned char c)
+{
+    size_t slot;
+
+    for (slot = 0; slot < numStates; ++slot)
+    {
+        states[slot] = job->transitions[states[slot]][c];
+    }
+}
+
+/* These test all of the bytes in a 64-bit word at once. */
+#define SIMPLE_LEXER_ONES UINT64_C(0x0101010101010101)
+#define SIMPLE_LEXER_HAS_ZERO_BYTE(word) \
+    (((word) - SIMPLE_LEXER_ONES) & ~(word) & (SIMPLE_LEXER_ONES << 7))
+#define SIMPLE_LEXER_HAS_BYTE(word, byte) \
+    SIMPLE_LEXER_HAS_ZERO_BYTE((word) ^ (SIMPLE_LEXER_ONES * (byte)))
+
+/*
+ * Return the offset of the first newline or other byte that can change
+ * the lexer's state in the middle of a run of token text or whitespace
+ * in text[index, end) or `end` if there isn't one.
+ */
+static inline size_t SimpleLexer_SkipOrdinaryChars(
+    const SimpleLexerDialect* restrict dialect,
+    const unsigned char* restrict text,
+    size_t index,
+    size_t end)
+{
+    uint64_t word;
+    uint64_t found;
+    size_t stop;
+
+    if (dialect->numUnquotedStops <= SIMPLE_LEXER_DIALECT_MAX_STOPS)
+    {
+        while (end - index >= sizeof(word))
+        {
+            (void) memcpy(&word, text + index, sizeof(word));
+            found = SIMPLE_LEXER_HAS_BYTE(word, '\n');
+            for (stop = 0; stop < dialect->numUnquotedStops; ++stop)
+            {
+                found |= SIMPLE_LEXER_HAS_BYTE(word,
+                    dialect->unquotedStops[stop]);
+            }
+            if (found != 0)
+            {
+                break;
+            }
+            index += sizeof(word);
+        }
+    }
+    while (index < end
+        && dialect->classes[text[index]] <= SIMPLE_LEXER_CLASS_SPACE)
+    {
+        ++index;
+    }
+    return index;
+}
+
+/*
+ * Determine a chunk's exit state for each entry state
+ * and find the chunk's newlines.
+ */
+static void SimpleLexer_ScanChunk(
+    const SimpleLexerJob* job,
+    SimpleLexerChunk* chunk)
+{
+    const unsigned char* text;
+    unsigned char states[SIMPLE_LEXER_NUMSTATES];
+    unsigned char slots[SIMPLE_LEXER_NUMSTATES];
+    size_t numStates;
+    size_t numTransitions;
+    size_t index;
+    size_t runStart;
+    size_t end;
+    size_t state;
+    size_t slot;
+    unsigned char c;
+
+    text = (const unsigned char*)job->text;
+
+    /* Track each distinct state that the chunk could be in.  slots maps
+       entry states to their current states' indices in states.  Entry states
+       tend to converge quickly, so merge duplicate states periodically. */
+    for (state = 0; state < SIMPLE_LEXER_NUMSTATES; ++state)
+    {
+        states[state] = (unsigned char)state;
+        slots[state] = (unsigned char)state;
+    }
+    numStates = SIMPLE_LEXER_NUMSTATES;
+    numTransitions = 0;
+
+    chunk->numNewlines = 0;
+    chunk->lastNewline = SIZE_MAX;
+    chunk->secondLastNewline = SIZE_MAX;
+
+    index = chunk->start;
+    end = chunk->start + chunk->size;
+    while (index < end)
+    {
+        c = job->dialect->classes[text[index++]];
+        SimpleLexer_TransitionStates(job, states, numStates, c);
+
+        if (c <= SIMPLE_LEXER_CLASS_SPACE)
+        {
+            /* Other characters and whitespace only switch between
+               SIMPLE_LEXER_STATE_NORMAL and SIMPLE_LEXER_STATE_TOKEN once
+               the first one ends any escape, so only the last one
+               in a run of them matters. */
+            runStart = index;
+            index = SimpleLexer_SkipOrdinaryChars(job->dialect, text, index,
+                end);
+            if (index != runStart)
+            {
+                SimpleLexer_TransitionStates(job, states, numStates,
+                    job->dialect->classes[text[index - 1]]);
+            }
+        }
+        else if (c == SIMPLE_LEXER_CLASS_NEWLINE)
+        {
+            ++chunk->numNewlines;
+            chunk->secondLastNewline = chunk->lastNewline;
+            chunk->lastNewline = index - 1;
+        }
+
+        if (++numTransitions % 64 == 0 || index == end)
+        {
+            for (state = 0; state < SIMPLE_LEXER_NUMSTATES; ++state)
+            {
+                chunk->exitStates[state] = states[slots[state]];
+            }
+            numStates = 0;
+            for (state = 0; state < SIMPLE_LEXER_NUMSTATES; ++state)
+            {
+                for (slot = 0; slot < numStates; ++slot)
+                {
+                    if (states[slot] == chunk->exitStates[state])
+                    {
+                        break;
+                    }
+                }
+                if (slot == numStates)
+                {
+                    states[numStates++] = chunk->exitStates[state];
+                }
+                slots[state] = (unsigned char)slot;
+            }
+        }
+    }
+}
+
+/*
+ * Return the offset of the first token that starts in text[offset, end)
+ * or `end` if there isn't one.
+ */
+static size_t SimpleLexer_FindTokenStart(
+    const SimpleLexerJob* job,
+    size_t offset,
+    size_t end,
+    int inComment)
+{
+    const char* text;
+    const char* newline;
+
+    text = job->text;
+    while (offset < end)
+    {
+        if (inComment)
+        {
+            newline = memchr(text + offset, '\n', end - offset);
+            if (newline == NULL)
+            {
+                return end;
+            }
+            offset = (size_t)(newline - text);
+            inComment = 0;
+        }
+        else
+        {
+            switch (job->dialect->classes[(unsigned char)text[offset]])
+            {
+                case SIMPLE_LEXER_CLASS_NEWLINE:
+                case SIMPLE_LEXER_CLASS_SPACE:
+                    break;
+                case SIMPLE_LEXER_CLASS_HASH:
+                    inComment = 1;
+                    break;
+                default:
+                    return offset;
+            }
+        }
+        ++offset;
+    }
+    return end;
+}
+
+/*
+ * Append a token to a chunk's tokens, copying its text into the chunk's arena
+ * if it isn't a view.  This returns zero on success and nonzero otherwise.
+ */
+static int SimpleLexer_AddChunkToken(
+    SimpleLexerChunk* restrict chunk,
+    const SimpleToken* restrict token)
+{
+    SimpleToken* tokens;
+    size_t capacity;
+
+    if (chunk->numTokens == chunk->tokenCapacity)
+    {
+        capacity = chunk->tokenCapacity != 0 ? chunk->tokenCapacity * 2 : 64;
+        tokens = realloc(chunk->tokens, capacity * sizeof(SimpleToken));
+        if (tokens == NULL)
+        {
+            return 1;
+        }
+        chunk->tokens = tokens;
+        chunk->tokenCapacity = capacity;
+    }
+
+    if (token->isView)
+    {
+        chunk->tokens[chunk->numTokens] = *token;
+    }
+    else if (SimpleTokenArena_Copy(&chunk->arena, token,
+        &chunk->tokens[chunk->numTokens]) != 0)
+    {
+        return 1;
+    }
+    ++chunk->numTokens;
+    return 0;
+}
+
+/*
+ * Lex the tokens that start in a chunk.
+ */
+static void SimpleLexer_LexChunk(
+    const SimpleLexerJob* job,
+    SimpleLexerChunk* chunk)
+{
+    SimpleLexer lexer;
+    SimpleToken token;
+    SimpleLexerError error;
+    size_t base;
+    size_t end;
+
+    if (SimpleLexer_InitGrowable(&lexer, NULL,
+        SIMPLE_LEXER_CHUNK_BUFFER_SIZE, SIZE_MAX) != 0)
+    {
+        chunk->error = SIMPLE_LEXER_OUT_OF_MEMORY;
+        return;
+    }
+    SimpleLexer_SetDialect(&lexer, job->dialect);
+    SimpleLexer_SetTokenViews(&lexer, 1);
+
+    /* Put the lexer in the state that the sequential lexer would be in. */
+    lexer.currentPosition = chunk->position;
+    lexer.inputOffset = chunk->start;
+    lexer.numColumnsInPreviousLine = chunk->numColumnsInPreviousLine;
+    lexer.state = chunk->entryState;
+    if (lexer.state == SIMPLE_LEXER_STATE_TOKEN
+        || lexer.state == SIMPLE_LEXER_STATE_QUOTED)
+    {
+        lexer.tokenIsView = 1;
+        lexer.tokenInputIndex = 0;
+    }
+
+    base = chunk->start;
+    end = chunk->start + chunk->size;
+
+    /* If the chunk starts inside a token, an earlier chunk owns the token.
+       Skip to the token's end without leaving the chunk: if the token ends
+       in a later chunk, this chunk has no tokens of its own. */
+    if (lexer.state != SIMPLE_LEXER_STATE_NORMAL
+        && lexer.state != SIMPLE_LEXER_STATE_COMMENT)
+    {
+        SimpleLexer_SetInput(&lexer, job->text + base, chunk->size);
+        error = SimpleLexer_GetNextToken(&lexer, &token);
+        if (error != SIMPLE_LEXER_OK)
+        {
+            if (error != SIMPLE_LEXER_EOF)
+            {
+                chunk->error = error;
+            }
+            SimpleLexer_Destroy(&lexer);
+            return;
+        }
+        base += lexer.inputIndex;
+    }
+
+    /* The chunk's last token may end in a later chunk, so give the lexer
+       the rest of the text. */
+    SimpleLexer_SetInput(&lexer, job->text + base, job->size - base);
+    for (;;)
+    {
+        if (SimpleLexer_FindTokenStart(job, base + lexer.inputIndex, end,
+                lexer.state == SIMPLE_LEXER_STATE_COMMENT) == end
+            && end != job->size)
+        {
+            break;
+        }
+
+        token.text = NULL;
+        error = SimpleLexer_GetNextToken(&lexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            /* The text's final token starts in this chunk (if it has one). */
+            error = SimpleLexer_Finish(&lexer, &token);
+            chunk->error = error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error;
+        }
+        else if (error != SIMPLE_LEXER_OK)
+        {
+            chunk->error = error;
+            break;
+        }
+
+        if (token.text != NULL && SimpleLexer_AddChunkToken(chunk, &token) != 0)
+        {
+            chunk->error = SIMPLE_LEXER_OUT_OF_MEMORY;
+            break;
+        }
+        if (lexer.finished)
+        {
+            break;
+        }
+    }
+
+    SimpleLexer_Destroy(&lexer);
+}
+
+/*
+ * Copy a chunk's tokens into the array of all of the text's tokens.
+ */
+static void SimpleLexer_GatherChunk(
+    const SimpleLexerJob* job,
+    SimpleLexerChunk* chunk)
+{
+    if (chunk->numTokens != 0)
+    {
+        (void) memcpy(job->tokens + chunk->firstToken, chunk->tokens,
+            chunk->numTokens * sizeof(SimpleToken));
+    }
+}
+
+static void* SimpleLexer_RunJobThread(void* argument)
+{
+    SimpleLexerJob* job;
+    size_t chunk;
+
+    job = argument;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->mutex);
+        chunk = job->nextChunk++;
+        pthread_mutex_unlock(&job->mutex);
+
+        if (chunk >= job->numChunks)
+        {
+            return NULL;
+        }
+        job->process(job, &job->chunks[chunk]);
+    }
+}
+
+/*
+ * Process all of a job's chunks on `numThreads` threads, including
+ * the calling thread.  The calling thread processes the chunks alone
+ * if the other threads can't be created.
+ */
+static void SimpleLexer_RunJob(SimpleLexerJob* job, size_t numThreads)
+{
+    pthread_t* threads;
+    size_t numStartedThreads;
+
+    job->nextChunk = 0;
+
+    numStartedThreads = 0;
+    threads = numThreads > 1 ? malloc((numThreads - 1) * sizeof(pthread_t))
+        : NULL;
+    if (threads != NULL)
+    {
+        while (numStartedThreads < numThreads - 1
+            && pthread_create(&threads[numStartedThreads], NULL,
+                SimpleLexer_RunJobThread, job) == 0)
+        {
+            ++numStartedThreads;
+        }
+    }
+
+    SimpleLexer_RunJobThread(job);
+
+    while (numStartedThreads != 0)
+    {
+        pthread_join(threads[--numStartedThreads], NULL);
+    }
+    free(threads);
+}
+
+void SimpleTokenList_Destroy(SimpleTokenList* list)
+{
+    size_t index;
+
+    assert(list != NULL);
+
+    for (index = 0; index < list->numArenas; ++index)
+    {
+        SimpleTokenArena_Destroy(&list->arenas[index]);
+    }
+    free(list->arenas);
+    free(list->tokens);
+
+    list->tokens = NULL;
+    list->numTokens = 0;
+    list->arenas = NULL;
+    list->numArenas = 0;
+}
+
+SimpleLexerError SimpleLexer_LexParallel(
+    const char* restrict text,
+    size_t size,
+    size_t numThreads,
+    size_t chunkSize,
+    SimpleTokenList* restrict list)
+{
+    SimpleLexerJob job;
+    SimpleLexerChunk* chunk;
+    SimpleLexerError error;
+    size_t numChunks;
+    size_t index;
+    size_t state;
+    size_t line;
+    size_t lastNewline;
+    size_t secondLastNewline;
+    long numProcessors;
+
+    assert(text != NULL || size == 0);
+    assert(list != NULL);
+
+    list->tokens = NULL;
+    list->numTokens = 0;
+    list->arenas = NULL;
+    list->numArenas = 0;
+
+    if (size == 0)
+    {
+        return SIMPLE_LEXER_EOF;
+    }
+
+    if (numThreads == 0)
+    {
+        numProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+        numThreads = numProcessors > 0 ? (size_t)numProcessors : 1;
+    }
+    if (chunkSize == 0)
+    {
+        chunkSize = size / numThreads / SIMPLE_LEXER_CHUNKS_PER_THREAD;
+        if (chunkSize < SIMPLE_LEXER_MIN_CHUNK_SIZE)
+        {
+            chunkSize = SIMPLE_LEXER_MIN_CHUNK_SIZE;
+        }
+    }
+    numChunks = size / chunkSize + (size % chunkSize != 0);
+    if (numThreads > numChunks)
+    {
+        numThreads = numChunks;
+    }
+
+    job.chunks = calloc(numChunks, sizeof(SimpleLexerChunk));
+    if (job.chunks == NULL)
+    {
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    if (pthread_mutex_init(&job.mutex, NULL) != 0)
+    {
+        free(job.chunks);
+        return SIMPLE_LEXER_OUT_OF_MEMORY;
+    }
+    job.text = text;
+    job.size = size;
+    job.dialect = &SimpleLexer_DefaultDialect;
+    SimpleLexer_InitTransitions(&job);
+    job.numChunks = numChunks;
+
+    for (index = 0; index < numChunks; ++index)
+    {
+        chunk = &job.chunks[index];
+        chunk->start = index * chunkSize;
+        chunk->size = size - chunk->start < chunkSize
+            ? size - chunk->start
+            : chunkSize;
+        SimpleTokenArena_Init(&chunk->arena, NULL, 0);
+        chunk->error = SIMPLE_LEXER_OK;
+    }
+
+    /* Find each chunk's exit states and newlines in parallel. */
+    job.process = SimpleLexer_ScanChunk;
+    SimpleLexer_RunJob(&job, numThreads);
+
+    /* Chain the chunks' states from the start of the text
+       and sum their newlines to get their starting positions. */
+    state = SIMPLE_LEXER_STATE_NORMAL;
+    line = 1;
+    lastNewline = SIZE_MAX;
+    secondLastNewline = SIZE_MAX;
+    for (index = 0; index < numChunks; ++index)
+    {
+        chunk = &job.chunks[index];
+        chunk->entryState = (SimpleLexerState)state;
+        chunk->position.line = line;
+        chunk->position.offset = chunk->start;
+        if (lastNewline == SIZE_MAX)
+        {
+            chunk->position.column = chunk->start + 1;
+            chunk->numColumnsInPreviousLine = 0;
+        }
+        else
+        {
+            chunk->position.column = chunk->start - lastNewline;
+            chunk->numColumnsInPreviousLine = secondLastNewline == SIZE_MAX
+                ? lastNewline + 1
+                : lastNewline - secondLastNewline;
+        }
+
+        state = chunk->exitStates[state];
+        line += chunk->numNewlines;
+        if (chunk->numNewlines > 1)
+        {
+            lastNewline = chunk->lastNewline;
+            secondLastNewline = chunk->secondLastNewline;
+        }
+        else if (chunk->numNewlines == 1)
+        {
+            secondLastNewline = lastNewline;
+            lastNewline = chunk->lastNewline;
+        }
+    }
+
+    /* Lex the chunks in parallel. */
+    job.process = SimpleLexer_LexChunk;
+    SimpleLexer_RunJob(&job, numThreads);
+
+    /* Gather the chunks' tokens into one array in parallel. */
+    error = SIMPLE_LEXER_EOF;
+    for (index = 0; index < numChunks; ++index)
+    {
+        chunk = &job.chunks[index];
+        chunk->firstToken = list->numTokens;
+        list->numTokens += chunk->numTokens;
+        if (chunk->error != SIMPLE_LEXER_OK
+            && error != SIMPLE_LEXER_OUT_OF_MEMORY)
+        {
+            error = chunk->error;
+        }
+    }
+    if (error != SIMPLE_LEXER_OUT_OF_MEMORY)
+    {
+        list->tokens = malloc(
+            (list->numTokens != 0 ? list->numTokens : 1) * sizeof(SimpleToken));
+        list->arenas = malloc(numChunks * sizeof(SimpleTokenArena));
+        if (list->tokens != NULL && list->arenas != NULL)
+        {
+            job.tokens = list->tokens;
+            job.process = SimpleLexer_GatherChunk;
+            SimpleLexer_RunJob(&job, numThreads);
+        }
+        else
+        {
+            error = SIMPLE_LEXER_OUT_OF_MEMORY;
+        }
+    }
+    pthread_mutex_destroy(&job.mutex);
+
+    for (index = 0; index < numChunks; ++index)
+    {
+        chunk = &job.chunks[index];
+        if (error != SIMPLE_LEXER_OUT_OF_MEMORY)
+        {
+            list->arenas[list->numArenas++] = chunk->arena;
+        }
+        else
+        {
+            SimpleTokenArena_Destroy(&chunk->arena);
+        }
+        free(chunk->tokens);
+    }
+    free(job.chunks);
+
+    if (error == SIMPLE_LEXER_OUT_OF_MEMORY)
+    {
+        SimpleTokenList_Destroy(list);
+    }
+    return error;
+}
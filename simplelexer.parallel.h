@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * This is a driver that lexes one large buffer on several threads.
+ * Unlike the rest of SimpleLexer, it depends on POSIX threads.
+ */
+
+#ifndef __SIMPLELEXER_PARALLEL_H
+#define __SIMPLELEXER_PARALLEL_H
+
+#include "simplelexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * This is a list of tokens in stream order.  Tokens without escape sequences
+ * are views into the lexed buffer (see SimpleLexer_SetTokenViews()), so they
+ * last only as long as the buffer does.  The list's arenas hold the texts of
+ * the other tokens.  Free the list's memory via SimpleTokenList_Destroy().
+ * All of this structure's fields should be considered read-only.
+ */
+typedef struct SimpleTokenList {
+    SimpleToken* tokens;        /* the tokens */
+    size_t numTokens;           /* the number of tokens */
+    SimpleTokenArena* arenas;   /* hold the texts of tokens that aren't views */
+    size_t numArenas;           /* the number of arenas */
+} SimpleTokenList;
+
+/*
+ * Free all of a token list's memory, including its tokens' texts.
+ */
+extern void SimpleTokenList_Destroy(SimpleTokenList* list);
+
+/*
+ * Lex all `size` bytes of `text` as a single stream on `numThreads` threads
+ * (or one thread per online processor if `numThreads` is zero) and store
+ * the tokens in `list`.  The tokens and their spans are exactly what
+ * a growable lexer would produce if it were given `text` as its only input
+ * and then finished.  The text is always lexed in the default dialect.
+ *
+ * This splits `text` into `chunkSize`-byte chunks (or a few chunks per thread
+ * if `chunkSize` is zero).  The threads first determine the state that
+ * the lexer would end each chunk in for every state that it could start
+ * the chunk in.  Chaining those results from the start of `text` yields
+ * each chunk's actual starting state, and a prefix sum over the chunks'
+ * newline counts yields each chunk's starting line and column.
+ * Then the threads lex the chunks independently.  Each chunk owns the tokens
+ * that start in it, so a chunk's last token might end in a later chunk.
+ *
+ * This returns SIMPLE_LEXER_EOF if it lexed the whole buffer without errors.
+ * It returns SIMPLE_LEXER_ESCAPING_EOF or SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN
+ * as SimpleLexer_Finish() does, in which case `list` still holds all of
+ * the tokens, including the final one.  It returns SIMPLE_LEXER_OUT_OF_MEMORY
+ * if allocating memory failed, in which case `list` is empty.  Lexing falls
+ * back to the calling thread if threads can't be created.  Either way,
+ * destroy `list` when it's no longer needed.
+ */
+extern SimpleLexerError SimpleLexer_LexParallel(
+    const char* SIMPLELEXER_RESTRICT text,
+    size_t size,
+    size_t numThreads,
+    size_t chunkSize,
+    SimpleTokenList* SIMPLELEXER_RESTRICT list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __SIMPLELEXER_PARALLEL_H */
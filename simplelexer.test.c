@@ -24,11 +24,21 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include "simplelexer.h"
+#define _POSIX_C_SOURCE 200809L
 
+#include "simplelexer.h"
+#include "simplelexer.batch.h"
+#include "simplelexer.cache.h"
+#include "simplelexer.file.h"
+#include "simplelexer.incremental.h"
+#include "simplelexer.parallel.h"
+
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 static SimpleLexer lexer;
 static SimpleToken token;
@@ -648,6 +658,1953 @@ static int CEscapeCharactersProduceAsciiEquivalents()
     return 0;
 }
 
+static int OnlyAsciiWhitespaceDelimitsTokens()
+{
+    const char *input = "a\xa0\x85z \"q\\";
+
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a\xa0\x85z");
+    TEST_SPAN(1, 1, 1, 4);
+    TEST_ASSERT_EQUAL(lexer.state, SIMPLE_LEXER_STATE_NORMAL);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(lexer.state, SIMPLE_LEXER_STATE_ESCAPING_QUOTED);
+    TEST_FINISH(SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_STREQ(token.text, "q");
+
+    return 0;
+}
+
+static int SpansRecordByteOffsets()
+{
+    /* Offsets continue across inputs, as lines and columns do. */
+    SimpleLexer_SetInput(&lexer, "ab \"c", 5);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "ab");
+    TEST_SPAN(1, 1, 1, 2);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 0);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.offset, 5);
+
+    SimpleLexer_SetInput(&lexer, "\nd\"\r\n# x\n e", 11);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "c\nd");
+    TEST_SPAN(1, 4, 2, 2);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 3);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 7);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "e");
+    TEST_SPAN(4, 2, 4, 2);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 15);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 15);
+
+    return 0;
+}
+
+static int LinesAndColumnsCanBeComputedFromOffsets()
+{
+    const char *input = "a\\\n b\n\"c\nd\"e\"f\" # g\n\n  h\\\ni\"j\\\n";
+    SimpleLexer eagerLexer;
+    char eagerBuffer[32];
+    SimpleToken eagerToken;
+    SimpleLexerError error;
+    TextPosition start;
+    TextPosition end;
+
+    SimpleLexer_Init(&eagerLexer, eagerBuffer, sizeof(eagerBuffer));
+    SimpleLexer_SetInput(&eagerLexer, input, strlen(input));
+    SimpleLexer_SetPositionTracking(&lexer, SIMPLE_LEXER_TRACK_OFFSETS);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+
+    do
+    {
+        error = SimpleLexer_GetNextToken(&lexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            error = SimpleLexer_Finish(&lexer, &token);
+            TEST_ASSERT_EQUAL(SimpleLexer_GetNextToken(&eagerLexer,
+                &eagerToken), SIMPLE_LEXER_EOF);
+            TEST_ASSERT_EQUAL(SimpleLexer_Finish(&eagerLexer, &eagerToken),
+                error);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL(SimpleLexer_GetNextToken(&eagerLexer,
+                &eagerToken), error);
+        }
+        TEST_ASSERT_STREQ(token.text, eagerToken.text);
+        TEST_SPAN(0, 0, 0, 0);
+        start = token.span.start;
+        end = token.span.end;
+        SimpleLexer_ComputeLineAndColumn(input, strlen(input), &start);
+        SimpleLexer_ComputeLineAndColumn(input, strlen(input), &end);
+        TEST_ASSERT_EQUAL(start.offset, eagerToken.span.start.offset);
+        TEST_ASSERT_EQUAL(end.offset, eagerToken.span.end.offset);
+        TEST_ASSERT_SPAN_EQUAL(eagerToken.span, start.line, start.column,
+            end.line, end.column);
+    } while (error == SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetPositionTracking(&lexer, SIMPLE_LEXER_TRACK_NOTHING);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "b");
+    TEST_SPAN(0, 0, 0, 0);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 0);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 0);
+
+    return 0;
+}
+
+static int LongTokensSpanningManyBlocks()
+{
+    char input[300];
+    char expected[100];
+
+    (void) memset(input, 'a', 100);
+    input[100] = '\t';
+    input[101] = '"';
+    (void) memset(input + 102, 'b', 100);
+    input[150] = '\n';
+    input[202] = '"';
+    (void) memset(input + 203, 'c', 97);
+
+    SimpleLexer_SetInput(&lexer, input, sizeof(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    (void) memset(expected, 'a', 99);
+    expected[99] = '\0';
+    TEST_ASSERT_EQUAL(token.length, 100);
+    TEST_ASSERT_EQUAL(strncmp(token.text, expected, 99), 0);
+    TEST_ASSERT_EQUAL(token.text[99], 'a');
+    TEST_SPAN(1, 1, 1, 100);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.length, 100);
+    TEST_ASSERT_EQUAL(token.text[47], 'b');
+    TEST_ASSERT_EQUAL(token.text[48], '\n');
+    TEST_ASSERT_EQUAL(token.text[49], 'b');
+    TEST_ASSERT_EQUAL(token.quoted, 1);
+    TEST_SPAN(1, 102, 2, 52);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.length, 97);
+    TEST_ASSERT_EQUAL(token.text[96], 'c');
+    TEST_SPAN(2, 53, 2, 149);
+
+    return 0;
+}
+
+static int LongCommentsAreSkipped()
+{
+    char input[256];
+
+    (void) memset(input, 'x', sizeof(input));
+    (void) memcpy(input, "token1 #", 8);
+    (void) memcpy(input + 200, "\n token2 # \"", 12);
+
+    SimpleLexer_SetInput(&lexer, input, sizeof(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "token1");
+    TEST_SPAN(1, 1, 1, 6);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "token2");
+    TEST_SPAN(2, 2, 2, 7);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.line, 2);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.column, 56);
+
+    return 0;
+}
+
+static int TokenLargerThanBufferIsTooLarge()
+{
+    char input[sizeof(defaultBuffer) + 64];
+
+    (void) memset(input, 'a', sizeof(input));
+
+    SimpleLexer_SetInput(&lexer, input, sizeof(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    TEST_ASSERT_EQUAL(lexer.bufferLength, sizeof(defaultBuffer) - 1);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.column, sizeof(defaultBuffer));
+    TEST_GET_TOKEN(SIMPLE_LEXER_TOKEN_TOO_LARGE);
+
+    return 0;
+}
+
+static int FragmentModeSplitsTokensLargerThanBuffer()
+{
+    const char *input = "ab \"cdefghij\" klmnopq";
+    char smallBuffer[4];
+
+    SimpleLexer_Init(&lexer, smallBuffer, sizeof(smallBuffer));
+    SimpleLexer_SetFragments(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "ab");
+    TEST_ASSERT_EQUAL(token.firstFragment, 1);
+    TEST_ASSERT_EQUAL(token.lastFragment, 1);
+
+    /* Each fragment fills the buffer, and the last one has the whole span. */
+    TEST_GET_TOKEN(SIMPLE_LEXER_PARTIAL_TOKEN);
+    TEST_ASSERT_STREQ(token.text, "cde");
+    TEST_ASSERT_EQUAL(token.quoted, 1);
+    TEST_ASSERT_EQUAL(token.firstFragment, 1);
+    TEST_ASSERT_EQUAL(token.lastFragment, 0);
+    TEST_ASSERT_EQUAL(token.span.start.column, 4);
+    TEST_GET_TOKEN(SIMPLE_LEXER_PARTIAL_TOKEN);
+    TEST_ASSERT_STREQ(token.text, "fgh");
+    TEST_ASSERT_EQUAL(token.firstFragment, 0);
+    TEST_ASSERT_EQUAL(token.lastFragment, 0);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "ij");
+    TEST_ASSERT_EQUAL(token.firstFragment, 0);
+    TEST_ASSERT_EQUAL(token.lastFragment, 1);
+    TEST_SPAN(1, 4, 1, 13);
+
+    /* The final token can come in fragments, too. */
+    TEST_GET_TOKEN(SIMPLE_LEXER_PARTIAL_TOKEN);
+    TEST_ASSERT_STREQ(token.text, "klm");
+    TEST_GET_TOKEN(SIMPLE_LEXER_PARTIAL_TOKEN);
+    TEST_ASSERT_STREQ(token.text, "nop");
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "q");
+    TEST_ASSERT_EQUAL(token.firstFragment, 0);
+    TEST_ASSERT_EQUAL(token.lastFragment, 1);
+    TEST_SPAN(1, 15, 1, 21);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 20);
+
+    /* Views that can't be copied when their inputs end become fragments,
+       and last fragments can be empty. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, "abcdef", 6);
+    TEST_GET_TOKEN(SIMPLE_LEXER_PARTIAL_TOKEN);
+    TEST_ASSERT_EQUAL(token.isView, 1);
+    TEST_ASSERT_EQUAL(token.length, 6);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_SetInput(&lexer, " g", 2);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.length, 0);
+    TEST_ASSERT_EQUAL(token.lastFragment, 1);
+    TEST_SPAN(1, 1, 1, 6);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "g");
+    TEST_ASSERT_EQUAL(token.firstFragment, 1);
+    return 0;
+}
+
+static int TokenViewsPointIntoInput()
+{
+    const char *input = "token1 \"quoted token\"tok\\en \"a\\\"b\" last";
+    const size_t len = strlen(input);
+
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, input, len);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 1);
+    TEST_ASSERT_EQUAL(token.text, input);
+    TEST_ASSERT_EQUAL(token.length, 6);
+    TEST_SPAN(1, 1, 1, 6);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 1);
+    TEST_ASSERT_EQUAL(token.text, input + 8);
+    TEST_ASSERT_EQUAL(token.length, 12);
+    TEST_ASSERT_EQUAL(token.quoted, 1);
+    TEST_SPAN(1, 8, 1, 21);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 0);
+    TEST_ASSERT_STREQ(token.text, "token");
+    TEST_SPAN(1, 22, 1, 27);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 0);
+    TEST_ASSERT_STREQ(token.text, "a\"b");
+    TEST_ASSERT_EQUAL(token.quoted, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 0);
+    TEST_ASSERT_STREQ(token.text, "last");
+
+    return 0;
+}
+
+static int TokenViewsSpanningInputsAreCopied()
+{
+    const char* input1 = "prefix";
+    const char* input2 = "suffix token ";
+    SimpleToken copy;
+
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, input1, strlen(input1));
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_SetInput(&lexer, input2, strlen(input2));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 0);
+    TEST_ASSERT_STREQ(token.text, "prefixsuffix");
+    TEST_SPAN(1, 1, 1, 12);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.isView, 1);
+    TEST_ASSERT_EQUAL(token.text, input2 + 7);
+
+    TEST_ASSERT_EQUAL(SimpleToken_Copy(&token, &copy), 0);
+    TEST_ASSERT_EQUAL(copy.isView, 0);
+    TEST_ASSERT_STREQ(copy.text, "token");
+    SimpleToken_Destroy(&copy);
+
+    return 0;
+}
+
+static int GetTokensFillsTokenArray()
+{
+    const char *input = "a bb \"c c\" d\\e f";
+    SimpleToken tokens[2];
+    char arena[sizeof(defaultBuffer) * 2];
+    size_t numTokens;
+
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_ASSERT_EQUAL(SimpleLexer_GetTokens(&lexer, tokens, 2, arena,
+        sizeof(arena), &numTokens), SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(numTokens, 2);
+    TEST_ASSERT_STREQ(tokens[0].text, "a");
+    TEST_ASSERT_SPAN_EQUAL(tokens[0].span, 1, 1, 1, 1);
+    TEST_ASSERT_STREQ(tokens[1].text, "bb");
+    TEST_ASSERT_SPAN_EQUAL(tokens[1].span, 1, 3, 1, 4);
+    TEST_ASSERT_EQUAL(SimpleLexer_GetTokens(&lexer, tokens, 2, arena,
+        sizeof(arena), &numTokens), SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(numTokens, 2);
+    TEST_ASSERT_STREQ(tokens[0].text, "c c");
+    TEST_ASSERT_EQUAL(tokens[0].quoted, 1);
+    TEST_ASSERT_STREQ(tokens[1].text, "de");
+    TEST_ASSERT_EQUAL(SimpleLexer_GetTokens(&lexer, tokens, 2, arena,
+        sizeof(arena), &numTokens), SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(numTokens, 0);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "f");
+
+    return 0;
+}
+
+static int GetTokensStopsAtTokenThatDoesNotFitArena()
+{
+    const char *input = "a bb \"c c\" de ";
+    char buffer[8];
+    SimpleToken tokens[8];
+    char arena[10];
+    size_t numTokens;
+
+    SimpleLexer_Init(&lexer, buffer, sizeof(buffer));
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_ASSERT_EQUAL(SimpleLexer_GetTokens(&lexer, tokens, 8, arena,
+        sizeof(arena), &numTokens), SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(numTokens, 3);
+    TEST_ASSERT_STREQ(tokens[0].text, "a");
+    TEST_ASSERT_STREQ(tokens[1].text, "bb");
+    TEST_ASSERT_STREQ(tokens[2].text, "c c");
+    TEST_ASSERT_EQUAL(SimpleLexer_GetTokens(&lexer, tokens, 8, arena,
+        2, &numTokens), SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    TEST_ASSERT_EQUAL(numTokens, 0);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "de");
+    TEST_SPAN(1, 12, 1, 13);
+
+    return 0;
+}
+
+static int GrowableLexerGrowsItsBuffer()
+{
+    char input[120];
+
+    (void) memset(input, 'a', sizeof(input));
+    input[40] = ' ';
+
+    TEST_ASSERT_EQUAL(SimpleLexer_InitGrowable(&lexer, NULL, 4, 64), 0);
+    SimpleLexer_SetInput(&lexer, input, sizeof(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.length, 40);
+    TEST_ASSERT_EQUAL(token.text[39], 'a');
+    TEST_ASSERT_EQUAL(token.text[40], '\0');
+    TEST_ASSERT_EQUAL(lexer.bufferCapacity, 64);
+    TEST_GET_TOKEN(SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    SimpleLexer_Destroy(&lexer);
+
+    return 0;
+}
+
+static int failNextReallocation;
+
+static void* FailingReallocate(
+    void* context,
+    void* block,
+    size_t oldSize,
+    size_t newSize)
+{
+    if (failNextReallocation)
+    {
+        failNextReallocation = 0;
+        return NULL;
+    }
+    return SimpleLexer_StandardAllocator.reallocate(context, block, oldSize,
+        newSize);
+}
+
+static int GrowableLexerResumesTokenAfterAllocationFailure()
+{
+    const char* input = "abcdefghij \"klmnopqrstuvwxyz0123\" ";
+    SimpleLexerAllocator allocator = SimpleLexer_StandardAllocator;
+
+    allocator.reallocate = FailingReallocate;
+    TEST_ASSERT_EQUAL(SimpleLexer_InitGrowable(&lexer, &allocator, 4, 1024),
+        0);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    failNextReallocation = 1;
+    TEST_GET_TOKEN(SIMPLE_LEXER_OUT_OF_MEMORY);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "abcdefghij");
+    TEST_SPAN(1, 1, 1, 10);
+    failNextReallocation = 1;
+    TEST_GET_TOKEN(SIMPLE_LEXER_OUT_OF_MEMORY);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "klmnopqrstuvwxyz0123");
+    TEST_SPAN(1, 12, 1, 33);
+    SimpleLexer_Destroy(&lexer);
+
+    return 0;
+}
+
+static int LineIndexMapsOffsetsAndLines()
+{
+    static char text[20480];
+    static char newlines[4096];
+    SimpleLexerAllocator allocator = SimpleLexer_StandardAllocator;
+    SimpleLineIndex index;
+    TextPosition expected;
+    TextPosition position;
+    size_t size;
+    size_t added;
+    size_t chunk;
+    size_t numLines;
+    size_t offset;
+
+    /* Lines are 0 to 299 bytes long, so some distances take two bytes. */
+    size = 0;
+    for (numLines = 1; size < 20000; ++numLines)
+    {
+        (void) memset(text + size, 'x', numLines * 37 % 300);
+        size += numLines * 37 % 300;
+        text[size++] = '\n';
+    }
+    (void) memset(text + size, 'y', 10);
+    size += 10;
+
+    allocator.reallocate = FailingReallocate;
+    SimpleLineIndex_Init(&index, &allocator);
+    for (added = 0, chunk = 1; added < size; added += chunk, chunk += 13)
+    {
+        if (chunk > size - added)
+        {
+            chunk = size - added;
+        }
+        TEST_ASSERT_EQUAL(SimpleLineIndex_Add(&index, text + added, chunk),
+            SIMPLE_LEXER_OK);
+    }
+    TEST_ASSERT_EQUAL(index.size, size);
+    TEST_ASSERT_EQUAL(index.numNewlines, numLines - 1);
+
+    for (offset = 0; offset <= size; ++offset)
+    {
+        expected.offset = offset;
+        SimpleLexer_ComputeLineAndColumn(text, size, &expected);
+        position.offset = offset;
+        TEST_ASSERT_EQUAL(SimpleLineIndex_GetPosition(&index, &position), 0);
+        TEST_ASSERT_EQUAL(position.line, expected.line);
+        TEST_ASSERT_EQUAL(position.column, expected.column);
+        if (expected.column == 1)
+        {
+            TEST_ASSERT_EQUAL(SimpleLineIndex_GetLineStart(&index,
+                expected.line, &position.offset), 0);
+            TEST_ASSERT_EQUAL(position.offset, offset);
+        }
+    }
+    position.offset = size + 1;
+    TEST_ASSERT(SimpleLineIndex_GetPosition(&index, &position) != 0);
+    TEST_ASSERT(SimpleLineIndex_GetLineStart(&index, 0, &offset) != 0);
+    TEST_ASSERT(SimpleLineIndex_GetLineStart(&index, numLines + 1, &offset)
+        != 0);
+
+    /* Failed additions leave the index as it was. */
+    (void) memset(newlines, '\n', sizeof(newlines));
+    failNextReallocation = 1;
+    TEST_ASSERT_EQUAL(SimpleLineIndex_Add(&index, newlines, sizeof(newlines)),
+        SIMPLE_LEXER_OUT_OF_MEMORY);
+    TEST_ASSERT_EQUAL(index.size, size);
+    TEST_ASSERT_EQUAL(index.numNewlines, numLines - 1);
+
+    /* Truncation drops the newlines past the cut. */
+    SimpleLineIndex_Truncate(&index, 1000);
+    TEST_ASSERT_EQUAL(SimpleLineIndex_Add(&index, "\n\n", 2), SIMPLE_LEXER_OK);
+    expected.offset = 1002;
+    SimpleLexer_ComputeLineAndColumn(text, 1000, &expected);
+    position.offset = 1002;
+    TEST_ASSERT_EQUAL(SimpleLineIndex_GetPosition(&index, &position), 0);
+    TEST_ASSERT_EQUAL(position.line, expected.line + 2);
+    TEST_ASSERT_EQUAL(position.column, 1);
+    TEST_ASSERT_EQUAL(SimpleLineIndex_GetLineStart(&index, position.line,
+        &offset), 0);
+    TEST_ASSERT_EQUAL(offset, 1002);
+
+    SimpleLineIndex_Destroy(&index);
+    return 0;
+}
+
+static int ArenaDuplicatesTokens()
+{
+    const char *input = "token1 \"token 2\" token3 ";
+    SimpleTokenArena arena;
+    SimpleToken tokens[3];
+    SimpleToken* copy;
+    SimpleToken* copies;
+    size_t index;
+
+    SimpleTokenArena_Init(&arena, NULL, 32);
+    TEST_ASSERT(SimpleTokenArena_Allocate(&arena, 0) != NULL);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    for (index = 0; index < 3; ++index)
+    {
+        TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+        TEST_ASSERT_EQUAL(SimpleTokenArena_Copy(&arena, &token, &tokens[index]),
+            0);
+    }
+    TEST_ASSERT_STREQ(tokens[0].text, "token1");
+    TEST_ASSERT_STREQ(tokens[1].text, "token 2");
+    TEST_ASSERT_EQUAL(tokens[1].quoted, 1);
+    TEST_ASSERT_STREQ(tokens[2].text, "token3");
+    TEST_ASSERT_SPAN_EQUAL(tokens[2].span, 1, 18, 1, 23);
+
+    copy = SimpleTokenArena_Duplicate(&arena, &tokens[1]);
+    TEST_ASSERT(copy != NULL);
+    TEST_ASSERT_STREQ(copy->text, "token 2");
+    TEST_ASSERT_EQUAL(copy->text, (char*)(copy + 1));
+
+    copies = SimpleTokenArena_DuplicateMany(&arena, tokens, 3);
+    TEST_ASSERT(copies != NULL);
+    TEST_ASSERT_STREQ(copies[0].text, "token1");
+    TEST_ASSERT_STREQ(copies[1].text, "token 2");
+    TEST_ASSERT_STREQ(copies[2].text, "token3");
+    TEST_ASSERT_EQUAL(copies[0].text, (char*)(copies + 3));
+    TEST_ASSERT_SPAN_EQUAL(copies[1].span, 1, 8, 1, 16);
+
+    /* Sizes that would overflow fail instead of wrapping around. */
+    TEST_ASSERT(SimpleTokenArena_Allocate(&arena, SIZE_MAX) == NULL);
+    TEST_ASSERT(SimpleTokenArena_Allocate(&arena, SIZE_MAX - 3) == NULL);
+    tokens[2].length = SIZE_MAX - 4;
+    TEST_ASSERT(SimpleTokenArena_DuplicateMany(&arena, tokens, 3) == NULL);
+
+    SimpleTokenArena_Reset(&arena);
+    TEST_ASSERT(SimpleTokenArena_DuplicateMany(&arena, NULL, 0) != NULL);
+    copy = SimpleTokenArena_Duplicate(&arena, &token);
+    TEST_ASSERT(copy != NULL);
+    TEST_ASSERT_STREQ(copy->text, "token3");
+    SimpleTokenArena_Destroy(&arena);
+
+    return 0;
+}
+
+static int SymbolTableInternsStrings()
+{
+    SimpleSymbolTable table;
+    char text[16];
+    size_t index;
+    size_t length;
+    uint32_t symbol;
+
+    SimpleSymbolTable_Init(&table, NULL);
+    TEST_ASSERT_EQUAL(SimpleSymbolTable_Find(&table, "a", 1),
+        SIMPLE_SYMBOL_NONE);
+
+    /* Symbols keep their IDs as the table grows. */
+    for (index = 0; index < 1000; ++index)
+    {
+        length = (size_t)sprintf(text, "symbol%zu", index);
+        TEST_ASSERT_EQUAL(SimpleSymbolTable_Intern(&table, text, length),
+            index + 1);
+    }
+    for (index = 0; index < 1000; ++index)
+    {
+        length = (size_t)sprintf(text, "symbol%zu", index);
+        TEST_ASSERT_EQUAL(SimpleSymbolTable_Intern(&table, text, length),
+            index + 1);
+        TEST_ASSERT_EQUAL(SimpleSymbolTable_Find(&table, text, length),
+            index + 1);
+        TEST_ASSERT_STREQ(SimpleSymbolTable_GetText(&table,
+            (uint32_t)(index + 1), &length), text);
+        TEST_ASSERT_EQUAL(length, strlen(text));
+    }
+    TEST_ASSERT_EQUAL(table.numSymbols, 1000);
+    TEST_ASSERT_EQUAL(SimpleSymbolTable_Find(&table, "symbol", 6),
+        SIMPLE_SYMBOL_NONE);
+
+    /* Strings can contain NULs. */
+    symbol = SimpleSymbolTable_Intern(&table, "a\0b", 3);
+    TEST_ASSERT_EQUAL(symbol, 1001);
+    TEST_ASSERT_EQUAL(SimpleSymbolTable_Intern(&table, "a", 1), 1002);
+    TEST_ASSERT_EQUAL(memcmp(SimpleSymbolTable_GetText(&table, symbol,
+        &length), "a\0b", 4), 0);
+    TEST_ASSERT_EQUAL(length, 3);
+
+    SimpleSymbolTable_Destroy(&table);
+    return 0;
+}
+
+static int LexerInternsTokens()
+{
+    const char *input = "set x 1\nset y x\n\"set\" s\\\"et";
+    SimpleSymbolTable table;
+    uint32_t expected[] = { 1, 2, 3, 1, 4, 2, 1, 5 };
+    size_t index;
+
+    SimpleSymbolTable_Init(&table, NULL);
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    SimpleLexer_SetSymbolTable(&lexer, &table);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    for (index = 0; index < 7; ++index)
+    {
+        TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+        TEST_ASSERT_EQUAL(token.symbol, expected[index]);
+    }
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.symbol, expected[7]);
+    TEST_ASSERT_STREQ(SimpleSymbolTable_GetText(&table, token.symbol, NULL),
+        "s\"et");
+    TEST_ASSERT_STREQ(SimpleSymbolTable_GetText(&table, 2, NULL), "x");
+
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetSymbolTable(&lexer, NULL);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(token.symbol, SIMPLE_SYMBOL_NONE);
+
+    SimpleSymbolTable_Destroy(&table);
+    return 0;
+}
+
+static int KeywordSetFindsKeywords()
+{
+    static const char* const cKeywords[] = {
+        "auto", "break", "case", "char", "const", "continue", "default",
+        "do", "double", "else", "enum", "extern", "float", "for", "goto",
+        "if", "inline", "int", "long", "register", "restrict", "return",
+        "short", "signed", "sizeof", "static", "struct", "switch",
+        "typedef", "union", "unsigned", "void", "volatile", "while",
+        "_Bool", "_Complex", "_Imaginary"
+    };
+    static const char* const duplicates[] = { "a", "b", "c", "b" };
+    static char names[2000][8];
+    const char* manyKeywords[2000];
+    char name[8];
+    SimpleKeywordSet set;
+    size_t index;
+    int expected;
+
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Init(&set, NULL, cKeywords,
+        sizeof(cKeywords) / sizeof(cKeywords[0])), 0);
+    for (index = 0; index < sizeof(cKeywords) / sizeof(cKeywords[0]);
+        ++index)
+    {
+        TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, cKeywords[index],
+            strlen(cKeywords[index])), (int)index);
+    }
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, "iff", 3),
+        SIMPLE_KEYWORD_NONE);
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, "i", 1),
+        SIMPLE_KEYWORD_NONE);
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, "whilst", 6),
+        SIMPLE_KEYWORD_NONE);
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, "", 0),
+        SIMPLE_KEYWORD_NONE);
+    SimpleKeywordSet_Destroy(&set);
+
+    for (index = 0; index < 2000; ++index)
+    {
+        (void) sprintf(names[index], "k%zu", index * 7);
+        manyKeywords[index] = names[index];
+    }
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Init(&set, NULL, manyKeywords, 2000),
+        0);
+    for (index = 0; index < 14000; ++index)
+    {
+        (void) sprintf(name, "k%zu", index);
+        expected = index % 7 == 0 ? (int)(index / 7) : SIMPLE_KEYWORD_NONE;
+        TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, name, strlen(name)),
+            expected);
+    }
+    SimpleKeywordSet_Destroy(&set);
+
+    TEST_ASSERT(SimpleKeywordSet_Init(&set, NULL, duplicates, 4) != 0);
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Init(&set, NULL, NULL, 0), 0);
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Find(&set, "a", 1),
+        SIMPLE_KEYWORD_NONE);
+    SimpleKeywordSet_Destroy(&set);
+
+    return 0;
+}
+
+static int LexerClassifiesOnlyUnquotedUnescapedKeywords()
+{
+    static const char* const keywords[] = { "if", "else", "\"if\"" };
+    const char *input = "if \"if\" \\if i\\f iff else# c\nelse";
+    int expected[] = { 0, SIMPLE_KEYWORD_NONE, SIMPLE_KEYWORD_NONE,
+        SIMPLE_KEYWORD_NONE, SIMPLE_KEYWORD_NONE, 1, 1 };
+    SimpleKeywordSet set;
+    size_t index;
+
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Init(&set, NULL, keywords, 3), 0);
+    SimpleLexer_SetTokenViews(&lexer, 1);
+    SimpleLexer_SetKeywords(&lexer, &set);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    for (index = 0; index < 6; ++index)
+    {
+        TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+        TEST_ASSERT_EQUAL(token.keyword, expected[index]);
+    }
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "else");
+    TEST_ASSERT_EQUAL(token.keyword, expected[6]);
+
+    SimpleKeywordSet_Destroy(&set);
+    return 0;
+}
+
+static int DialectsChangeTheLanguage()
+{
+    const char *input = "abcdefghijklmnopqrstuvwxyz0123456789,b "
+        "'x\"y\\'z' \"p'q\" ; c \"d\n#e\\n";
+    SimpleLexerDialect dialect;
+
+    TEST_ASSERT_EQUAL(SimpleLexerDialect_Init(&dialect, "'\"", ";", ",", '\\',
+        NULL), 0);
+    SimpleLexer_SetDialect(&lexer, &dialect);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "abcdefghijklmnopqrstuvwxyz0123456789");
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "b");
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "x\"y'z");
+    TEST_ASSERT(token.quoted);
+    TEST_SPAN(1, 40, 1, 47);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "p'q");
+    TEST_ASSERT(token.quoted);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "#e\n");
+    TEST_SPAN(2, 1, 2, 4);
+
+    /* Resetting keeps the dialect, and NULL restores the default one. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetInput(&lexer, "a;b", 3);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a");
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetDialect(&lexer, NULL);
+    SimpleLexer_SetInput(&lexer, "a;b", 3);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a;b");
+    return 0;
+}
+
+static int DialectInitRejectsConflictingBytes()
+{
+    const char *input = "a!b\\n\\\"c-d ee";
+    const char *delimiters = "!$%&()*+,-./:;<=>?@[]";
+    SimpleLexerDialect dialect;
+
+    TEST_ASSERT(SimpleLexerDialect_Init(&dialect, "''", NULL, NULL, -1,
+        NULL) != 0);
+    TEST_ASSERT(SimpleLexerDialect_Init(&dialect, "'", "'", NULL, -1,
+        NULL) != 0);
+    TEST_ASSERT(SimpleLexerDialect_Init(&dialect, NULL, NULL, "\t", -1,
+        NULL) != 0);
+    TEST_ASSERT(SimpleLexerDialect_Init(&dialect, NULL, ";", NULL, ';',
+        NULL) != 0);
+    TEST_ASSERT(SimpleLexerDialect_Init(&dialect, NULL, NULL, NULL, '\\',
+        "abc") != 0);
+
+    /* Dialects with too many special bytes to compare at once still work,
+       as do escapes whose meanings differ from C's. */
+    TEST_ASSERT_EQUAL(SimpleLexerDialect_Init(&dialect, NULL, NULL,
+        delimiters, '\\', "nN\"Q"), 0);
+    SimpleLexer_SetDialect(&lexer, &dialect);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a");
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "bNQc");
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "d");
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "ee");
+    return 0;
+}
+
+static int LexerCountsWhatItDoes()
+{
+    const char *input1 = "ab \"c d\" \\tx # note\nlo";
+    const char *input2 = "ng \"\"";
+    char smallBuffer[4];
+    SimpleLexerStats stats;
+    SimpleLexerStats total;
+
+    SimpleLexer_SetInput(&lexer, input1, strlen(input1));
+    while (SimpleLexer_GetNextToken(&lexer, &token) == SIMPLE_LEXER_OK)
+    {
+    }
+    SimpleLexer_SetInput(&lexer, input2, strlen(input2));
+    while (SimpleLexer_GetNextToken(&lexer, &token) == SIMPLE_LEXER_OK)
+    {
+    }
+    TEST_FINISH(SIMPLE_LEXER_EOF);
+    SimpleLexer_GetStats(&lexer, &stats);
+#ifdef SIMPLELEXER_STATS
+    TEST_ASSERT_EQUAL(stats.numBytes, 27);
+    TEST_ASSERT_EQUAL(stats.numInputs, 2);
+    TEST_ASSERT_EQUAL(stats.numQuotedTokens, 2);
+    TEST_ASSERT_EQUAL(stats.numUnquotedTokens, 3);
+    TEST_ASSERT_EQUAL(stats.numStartedEscapedTokens, 1);
+    TEST_ASSERT_EQUAL(stats.numEscapes, 1);
+    TEST_ASSERT_EQUAL(stats.numCommentBytes, 6);
+    TEST_ASSERT_EQUAL(stats.numSpanningTokens, 1);
+    TEST_ASSERT_EQUAL(stats.numTokensTooLarge, 0);
+    TEST_ASSERT_EQUAL(stats.tokenLengths[0], 1);
+    TEST_ASSERT_EQUAL(stats.tokenLengths[2], 3);
+    TEST_ASSERT_EQUAL(stats.tokenLengths[3], 1);
+#else
+    TEST_ASSERT_EQUAL(stats.numBytes, 0);
+    TEST_ASSERT_EQUAL(stats.numQuotedTokens, 0);
+    TEST_ASSERT_EQUAL(stats.tokenLengths[2], 0);
+#endif
+
+    /* Counters survive resets but not SimpleLexer_ResetStats(). */
+    total = stats;
+    SimpleLexerStats_Merge(&total, &stats);
+    TEST_ASSERT_EQUAL(total.numBytes, 2 * stats.numBytes);
+    TEST_ASSERT_EQUAL(total.tokenLengths[2], 2 * stats.tokenLengths[2]);
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetInput(&lexer, "x y", 3);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    SimpleLexer_ResetStats(&lexer);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_GetStats(&lexer, &total);
+    TEST_ASSERT_EQUAL(total.numUnquotedTokens, 0);
+#ifdef SIMPLELEXER_STATS
+    TEST_ASSERT_EQUAL(total.numBytes, 1);
+#endif
+
+    SimpleLexer_Init(&lexer, smallBuffer, sizeof(smallBuffer));
+    SimpleLexer_SetInput(&lexer, "abcdefgh", 8);
+    TEST_GET_TOKEN(SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    SimpleLexer_GetStats(&lexer, &stats);
+#ifdef SIMPLELEXER_STATS
+    TEST_ASSERT_EQUAL(stats.numTokensTooLarge, 1);
+    TEST_ASSERT_EQUAL(stats.numInputs, 1);
+#endif
+    return 0;
+}
+
+static int Utf8ModeSplitsOnUnicodeSpaces()
+{
+    const char *input =
+        "a\xC2\xA0" "b\xE3\x80\x80\"c\xC2\xA0" "d\" \\\xC2\xA0" "e \xE4\xB8\xAD";
+    const char *split = "ab\xE2\x80\x83" "cd x\xE2\x80\x8By";
+    size_t index;
+
+    /* Without UTF-8 mode, the spaces are token text. */
+    SimpleLexer_SetInput(&lexer, input, 4);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a\xC2\xA0" "b");
+
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetUtf8(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "a");
+    TEST_SPAN(1, 1, 1, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "b");
+    TEST_SPAN(1, 4, 1, 4);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 3);
+
+    /* Quoted and escaped spaces are token text. */
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "c\xC2\xA0" "d");
+    TEST_SPAN(1, 8, 1, 13);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "\xC2\xA0" "e");
+    TEST_SPAN(1, 15, 1, 18);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "\xE4\xB8\xAD");
+    TEST_SPAN(1, 20, 1, 22);
+
+    /* Spaces split across inputs are recognized all the same. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetUtf8(&lexer, 1);
+    for (index = 0; index < 4; ++index)
+    {
+        SimpleLexer_SetInput(&lexer, split + index, 1);
+        TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    }
+    SimpleLexer_SetInput(&lexer, split + 4, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "ab");
+    TEST_SPAN(1, 1, 1, 2);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 1);
+    for (index = 5; index < 7; ++index)
+    {
+        SimpleLexer_SetInput(&lexer, split + index, 1);
+        TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    }
+    SimpleLexer_SetInput(&lexer, split + 7, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "cd");
+    TEST_SPAN(1, 6, 1, 7);
+    TEST_ASSERT_EQUAL(token.span.start.offset, 5);
+
+    /* U+200B isn't whitespace, so its bytes go back into the token. */
+    for (index = 8; split[index] != '\0'; ++index)
+    {
+        SimpleLexer_SetInput(&lexer, split + index, 1);
+        TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    }
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "x\xE2\x80\x8By");
+    TEST_SPAN(1, 9, 1, 13);
+    TEST_ASSERT_EQUAL(token.span.end.offset, 12);
+
+    /* So do the bytes of a character that the stream cuts off. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetUtf8(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, split, 4);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_INVALID_UTF8);
+    TEST_ASSERT_STREQ(token.text, "ab\xE2\x80");
+    TEST_SPAN(1, 1, 1, 4);
+    return 0;
+}
+
+static int Utf8ModeRejectsInvalidSequences()
+{
+    const char *input = "one tw\xFFo three";
+    char text[100];
+
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("abc", 3), 3);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("\xF0\x9F\x98\x80z", 5), 5);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("ab\x80", 3), 2);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("a\xE2\x82", 3), 1);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("a\xC0\x80", 3), 1);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("\xED\xA0\x80", 3), 0);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8("\xF4\x90\x80\x80", 4), 0);
+    (void) memset(text, 'a', sizeof(text));
+    (void) memcpy(text + 70, "\xE4\xB8\xAD\xF8", 4);
+    TEST_ASSERT_EQUAL(SimpleLexer_ValidateUtf8(text, sizeof(text)), 73);
+
+    /* Lexing stops at the invalid byte until the next input. */
+    SimpleLexer_SetUtf8(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "one");
+    TEST_GET_TOKEN(SIMPLE_LEXER_INVALID_UTF8);
+    TEST_GET_TOKEN(SIMPLE_LEXER_INVALID_UTF8);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.column, 7);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.offset, 6);
+    SimpleLexer_SetInput(&lexer, input + 7, strlen(input + 7));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "two");
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "three");
+
+    /* A sequence that starts in one input can be invalid in the next. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetUtf8(&lexer, 1);
+    SimpleLexer_SetInput(&lexer, "a \xE2\x82", 4);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_SetInput(&lexer, "z", 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_INVALID_UTF8);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.offset, 4);
+    return 0;
+}
+
+static int ColumnsCanCountCodePointsAndDisplayWidth()
+{
+    const char *input =
+        "\xC3\xA9t\xC3\xA9 \"\xE4\xB8\xAD\xE6\x96\x87\" x\n\t\xF0\x9F\x98\x80";
+    char text[81];
+    size_t index;
+
+    /* Code points: UTF-8 continuation bytes take no columns. */
+    SimpleLexer_SetColumns(&lexer, SIMPLE_LEXER_COLUMN_CODE_POINTS, 0);
+    SimpleLexer_SetInput(&lexer, input, strlen(input));
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 1, 1, 3);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 5, 1, 8);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 10, 1, 10);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_SPAN(2, 2, 2, 2);
+
+    /* Display width: wide characters take two columns, and tabs go to the
+       next tab stop.  Characters split across inputs count all the same. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetColumns(&lexer, SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH, 4);
+    SimpleLexer_SetInput(&lexer, input, 9);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 1, 1, 3);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_SetInput(&lexer, input + 9, strlen(input + 9) - 2);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 5, 1, 10);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 12, 1, 12);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    SimpleLexer_SetInput(&lexer, input + strlen(input) - 2, 2);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_SPAN(2, 5, 2, 6);
+
+    /* Whole vectors of two-byte characters are counted at once. */
+    for (index = 0; index < 80; index += 2)
+    {
+        text[index] = '\xC3';
+        text[index + 1] = '\xA9';
+    }
+    text[80] = '\0';
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetColumns(&lexer, SIMPLE_LEXER_COLUMN_CODE_POINTS, 0);
+    SimpleLexer_SetInput(&lexer, text, 80);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 1, 1, 40);
+
+    /* Tab stops work with byte columns, too. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetColumns(&lexer, SIMPLE_LEXER_COLUMN_BYTES, 8);
+    SimpleLexer_SetInput(&lexer, "ab\tc", 4);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 1, 1, 2);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 9, 1, 9);
+
+    /* Wide UTF-8 spaces are two columns wide, too. */
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetUtf8(&lexer, 1);
+    SimpleLexer_SetColumns(&lexer, SIMPLE_LEXER_COLUMN_DISPLAY_WIDTH, 0);
+    SimpleLexer_SetInput(&lexer, "a\xE3\x80\x80" "b", 5);
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 1, 1, 1);
+    TEST_GET_TOKEN(SIMPLE_LEXER_EOF);
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_SPAN(1, 4, 1, 4);
+    return 0;
+}
+
+static int SplitLineStoresWordsInOneBlock()
+{
+    const char *line = "cp -r \"my files\" a\\ b \"\" dest # copy\n";
+    int argc;
+    char **argv;
+
+    TEST_ASSERT_EQUAL(SimpleLexer_SplitLine(line, strlen(line), &argc, &argv),
+        SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(argc, 6);
+    TEST_ASSERT_STREQ(argv[0], "cp");
+    TEST_ASSERT_STREQ(argv[1], "-r");
+    TEST_ASSERT_STREQ(argv[2], "my files");
+    TEST_ASSERT_STREQ(argv[3], "a b");
+    TEST_ASSERT_STREQ(argv[4], "");
+    TEST_ASSERT_STREQ(argv[5], "dest");
+    TEST_ASSERT(argv[6] == NULL);
+
+    /* The strings follow the pointer array in the same block. */
+    TEST_ASSERT((char *)argv[0] > (char *)&argv[6]);
+    TEST_ASSERT(argv[1] == argv[0] + 3);
+    free(argv);
+
+    /* The densest text still fits. */
+    TEST_ASSERT_EQUAL(SimpleLexer_SplitLine("a\"\"b\"\"c", 7, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(argc, 5);
+    TEST_ASSERT_STREQ(argv[4], "c");
+    free(argv);
+
+    TEST_ASSERT_EQUAL(SimpleLexer_SplitLine("", 0, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(argc, 0);
+    TEST_ASSERT(argv[0] == NULL);
+    free(argv);
+
+    TEST_ASSERT_EQUAL(SimpleLexer_SplitLine("echo \"hi", 8, &argc, &argv),
+        SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_EQUAL(argc, 0);
+    TEST_ASSERT(argv == NULL);
+    return 0;
+}
+
+static int LineSplitterSplitsStreamsIntoRecords()
+{
+    const char *stream =
+        "set a 1\n\n# comment\nput \"two\nlines\" x\\\ny # note\nget a";
+    SimpleLineSplitter splitter;
+    size_t index;
+    int argc;
+    char **argv;
+    char **firstBlock;
+
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Init(&splitter, NULL, 64), 0);
+
+    /* Feed the stream a byte at a time: records come out as soon as their
+       newlines arrive. */
+    for (index = 0; stream[index] != '\n'; ++index)
+    {
+        SimpleLineSplitter_SetInput(&splitter, stream + index, 1);
+        TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+            SIMPLE_LEXER_EOF);
+    }
+    SimpleLineSplitter_SetInput(&splitter, stream + index, 1);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(argc, 3);
+    TEST_ASSERT_STREQ(argv[0], "set");
+    TEST_ASSERT_STREQ(argv[2], "1");
+    TEST_ASSERT(argv[3] == NULL);
+    firstBlock = argv;
+
+    /* Quoted words and escaped newlines continue records. */
+    ++index;
+    SimpleLineSplitter_SetInput(&splitter, stream + index,
+        strlen(stream + index));
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(argc, 3);
+    TEST_ASSERT_STREQ(argv[0], "put");
+    TEST_ASSERT_STREQ(argv[1], "two\nlines");
+    TEST_ASSERT_STREQ(argv[2], "x\ny");
+    TEST_ASSERT(argv == firstBlock);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+
+    /* The last record needn't end with a newline. */
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Finish(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(argc, 2);
+    TEST_ASSERT_STREQ(argv[0], "get");
+    TEST_ASSERT_STREQ(argv[1], "a");
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Finish(&splitter, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+
+    /* Finishing can yield two records if the last word starts a new one. */
+    SimpleLineSplitter_Reset(&splitter);
+    SimpleLineSplitter_SetInput(&splitter, "one two\nthree \"fo", 17);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(argc, 2);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Finish(&splitter, &argc, &argv),
+        SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_EQUAL(argc, 2);
+    TEST_ASSERT_STREQ(argv[0], "three");
+    TEST_ASSERT_STREQ(argv[1], "fo");
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Finish(&splitter, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+
+    SimpleLineSplitter_Reset(&splitter);
+    SimpleLineSplitter_SetInput(&splitter, "a\nb", 3);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Next(&splitter, &argc, &argv),
+        SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(SimpleLineSplitter_Finish(&splitter, &argc, &argv),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(argv[0], "b");
+
+    SimpleLineSplitter_Destroy(&splitter);
+    return 0;
+}
+
+typedef struct CollectedTokens {
+    SimpleTokenArena arena;
+    SimpleToken tokens[8];
+    size_t numTokens;
+    size_t numViews;
+    size_t maxTokens;
+} CollectedTokens;
+
+static int CollectToken(void* context, const SimpleToken* token)
+{
+    CollectedTokens* collected = context;
+
+    if (token->isView)
+    {
+        ++collected->numViews;
+    }
+    if (SimpleTokenArena_Copy(&collected->arena, token,
+        &collected->tokens[collected->numTokens]))
+    {
+        return 1;
+    }
+    return ++collected->numTokens == collected->maxTokens;
+}
+
+static const char fileInput[] = "token1 \"token 2\"\n# comment\nto\\ken3 token4";
+
+static int CheckCollectedFileTokens(CollectedTokens* collected)
+{
+    TEST_ASSERT_EQUAL(collected->numTokens, 4);
+    TEST_ASSERT_STREQ(collected->tokens[0].text, "token1");
+    TEST_ASSERT_STREQ(collected->tokens[1].text, "token 2");
+    TEST_ASSERT_SPAN_EQUAL(collected->tokens[1].span, 1, 8, 1, 16);
+    TEST_ASSERT_STREQ(collected->tokens[2].text, "token3");
+    TEST_ASSERT_SPAN_EQUAL(collected->tokens[2].span, 3, 1, 3, 7);
+    TEST_ASSERT_STREQ(collected->tokens[3].text, "token4");
+    TEST_ASSERT_SPAN_EQUAL(collected->tokens[3].span, 3, 9, 3, 14);
+    return 0;
+}
+
+static int FeedPushesTokensAndMixesWithPulling()
+{
+    static const char input[] = "a \"b c\" d\\ e f";
+    CollectedTokens collected;
+
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.numViews = 0;
+    collected.maxTokens = 2;
+    TEST_ASSERT_EQUAL(SimpleLexer_Feed(&lexer, input, strlen(input),
+        CollectToken, &collected), SIMPLE_LEXER_STOPPED);
+    TEST_ASSERT_EQUAL(collected.numTokens, 2);
+    TEST_ASSERT_EQUAL(collected.numViews, 2);
+    TEST_ASSERT_STREQ(collected.tokens[0].text, "a");
+    TEST_ASSERT_STREQ(collected.tokens[1].text, "b c");
+    TEST_ASSERT_SPAN_EQUAL(collected.tokens[1].span, 1, 3, 1, 7);
+
+    /* Pulling picks up where the handler stopped. */
+    TEST_GET_TOKEN(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "d e");
+    TEST_ASSERT_EQUAL(token.isView, 0);
+
+    /* The last token continues in the next input. */
+    collected.maxTokens = 8;
+    TEST_ASSERT_EQUAL(SimpleLexer_PushTokens(&lexer, CollectToken,
+        &collected), SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(collected.numTokens, 2);
+    TEST_ASSERT_EQUAL(SimpleLexer_Feed(&lexer, "g h", 3, CollectToken,
+        &collected), SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(collected.numTokens, 3);
+    TEST_ASSERT_EQUAL(collected.numViews, 2);
+    TEST_ASSERT_STREQ(collected.tokens[2].text, "fg");
+    TEST_ASSERT_SPAN_EQUAL(collected.tokens[2].span, 1, 14, 1, 15);
+    TEST_ASSERT_EQUAL(collected.tokens[2].span.start.offset, 13);
+    TEST_ASSERT_EQUAL(lexer.currentPosition.offset, 17);
+
+    TEST_FINISH(SIMPLE_LEXER_OK);
+    TEST_ASSERT_STREQ(token.text, "h");
+    TEST_SPAN(1, 17, 1, 17);
+    SimpleTokenArena_Destroy(&collected.arena);
+
+    return 0;
+}
+
+static int LexFdMapsRegularFiles()
+{
+    CollectedTokens collected;
+    FILE* file;
+    SimpleLexerError error;
+
+    file = tmpfile();
+    TEST_ASSERT(file != NULL);
+    TEST_ASSERT_EQUAL(fputs(fileInput, file) >= 0, 1);
+    TEST_ASSERT_EQUAL(fflush(file), 0);
+
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.numViews = 0;
+    collected.maxTokens = 8;
+    error = SimpleLexer_LexFd(&lexer, fileno(file), CollectToken, &collected);
+    (void) fclose(file);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(lexer.tokenViews, 0);
+    TEST_ASSERT_EQUAL(CheckCollectedFileTokens(&collected), 0);
+    TEST_ASSERT_EQUAL(collected.numViews, 2);
+    SimpleTokenArena_Destroy(&collected.arena);
+
+    return 0;
+}
+
+static int LexFdReadsPipes()
+{
+    CollectedTokens collected;
+    int fds[2];
+    SimpleLexerError error;
+
+    TEST_ASSERT_EQUAL(pipe(fds), 0);
+    TEST_ASSERT_EQUAL(write(fds[1], fileInput, strlen(fileInput)),
+        (ssize_t)strlen(fileInput));
+    (void) close(fds[1]);
+
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.numViews = 0;
+    collected.maxTokens = 8;
+    error = SimpleLexer_LexFd(&lexer, fds[0], CollectToken, &collected);
+    (void) close(fds[0]);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(lexer.tokenViews, 0);
+    TEST_ASSERT_EQUAL(CheckCollectedFileTokens(&collected), 0);
+    SimpleTokenArena_Destroy(&collected.arena);
+
+    return 0;
+}
+
+static int LexFdStopsWhenHandlerSaysSo()
+{
+    CollectedTokens collected;
+    FILE* file;
+    SimpleLexerError error;
+
+    TEST_ASSERT_EQUAL(SimpleLexer_LexFile(&lexer,
+        "/nonexistent/simplelexer/input", CollectToken, &collected),
+        SIMPLE_LEXER_IO_ERROR);
+
+    file = tmpfile();
+    TEST_ASSERT(file != NULL);
+    TEST_ASSERT_EQUAL(fputs(fileInput, file) >= 0, 1);
+    TEST_ASSERT_EQUAL(fflush(file), 0);
+
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.numViews = 0;
+    collected.maxTokens = 1;
+    error = SimpleLexer_LexFd(&lexer, fileno(file), CollectToken, &collected);
+    (void) fclose(file);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_STOPPED);
+    TEST_ASSERT_EQUAL(collected.numTokens, 1);
+    TEST_ASSERT_STREQ(collected.tokens[0].text, "token1");
+    TEST_ASSERT_EQUAL(lexer.tokenViews, 0);
+    SimpleTokenArena_Destroy(&collected.arena);
+
+    return 0;
+}
+
+typedef struct BatchResults {
+    CollectedTokens files[4];
+    SimpleLexerError errors[4];
+    int errorNumbers[4];
+    size_t numResults;
+} BatchResults;
+
+static int CollectBatchToken(
+    void* context,
+    size_t file,
+    const SimpleToken* token)
+{
+    BatchResults* results = context;
+
+    return CollectToken(&results->files[file], token);
+}
+
+static int CollectBatchResult(
+    void* context,
+    size_t file,
+    SimpleLexerError error)
+{
+    BatchResults* results = context;
+
+    results->errors[file] = error;
+    results->errorNumbers[file] = error == SIMPLE_LEXER_IO_ERROR ? errno : 0;
+    ++results->numResults;
+    return 0;
+}
+
+/*
+ * Write `text` to a new temporary file and store its path in `path`,
+ * which must hold at least 32 bytes.
+ */
+static int WriteTemporaryFile(char* path, const char* text)
+{
+    int fd;
+    size_t length;
+
+    (void) strcpy(path, "/tmp/simplelexer.test.XXXXXX");
+    fd = mkstemp(path);
+    TEST_ASSERT(fd >= 0);
+    length = strlen(text);
+    TEST_ASSERT_EQUAL(write(fd, text, length), (ssize_t)length);
+    TEST_ASSERT_EQUAL(close(fd), 0);
+    return 0;
+}
+
+static void InitBatchResults(BatchResults* results, size_t maxTokens)
+{
+    size_t file;
+
+    for (file = 0; file < 4; ++file)
+    {
+        SimpleTokenArena_Init(&results->files[file].arena, NULL, 0);
+        results->files[file].numTokens = 0;
+        results->files[file].numViews = 0;
+        results->files[file].maxTokens = maxTokens;
+        results->errors[file] = SIMPLE_LEXER_OK;
+    }
+    results->numResults = 0;
+}
+
+static void DestroyBatchResults(BatchResults* results)
+{
+    size_t file;
+
+    for (file = 0; file < 4; ++file)
+    {
+        SimpleTokenArena_Destroy(&results->files[file].arena);
+    }
+}
+
+static int LexFilesLexesEachFile()
+{
+    char goodPath[32];
+    char unclosedPath[32];
+    const char* paths[4];
+    SimpleBatchOptions options;
+    BatchResults results;
+    SimpleLexerError error;
+
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(goodPath, fileInput), 0);
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(unclosedPath, "\"unclosed"), 0);
+    paths[0] = goodPath;
+    paths[1] = "/nonexistent/simplelexer/input";
+    paths[2] = unclosedPath;
+    paths[3] = goodPath;
+
+    /* Tiny buffers make tokens span reads. */
+    (void) memset(&options, 0, sizeof(options));
+    options.queueDepth = 2;
+    options.bufferSize = 5;
+    InitBatchResults(&results, 8);
+    error = SimpleLexer_LexFiles(paths, 4, &options, CollectBatchToken,
+        CollectBatchResult, &results);
+    (void) unlink(goodPath);
+    (void) unlink(unclosedPath);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(results.numResults, 4);
+
+    TEST_ASSERT_EQUAL(results.errors[0], SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(CheckCollectedFileTokens(&results.files[0]), 0);
+    TEST_ASSERT_EQUAL(results.errors[1], SIMPLE_LEXER_IO_ERROR);
+    TEST_ASSERT_EQUAL(results.errorNumbers[1], ENOENT);
+    TEST_ASSERT_EQUAL(results.files[1].numTokens, 0);
+    TEST_ASSERT_EQUAL(results.errors[2],
+        SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_EQUAL(results.files[2].numTokens, 1);
+    TEST_ASSERT_STREQ(results.files[2].tokens[0].text, "unclosed");
+    TEST_ASSERT_EQUAL(results.errors[3], SIMPLE_LEXER_EOF);
+    TEST_ASSERT_EQUAL(CheckCollectedFileTokens(&results.files[3]), 0);
+    DestroyBatchResults(&results);
+
+    return 0;
+}
+
+static int LexFilesStopsWhenHandlerSaysSo()
+{
+    char path[32];
+    const char* paths[3];
+    SimpleBatchOptions options;
+    BatchResults results;
+    SimpleLexerError error;
+
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(path, fileInput), 0);
+    paths[0] = path;
+    paths[1] = path;
+    paths[2] = path;
+
+    (void) memset(&options, 0, sizeof(options));
+    options.queueDepth = 1;
+    InitBatchResults(&results, 1);
+    error = SimpleLexer_LexFiles(paths, 3, &options, CollectBatchToken,
+        CollectBatchResult, &results);
+    (void) unlink(path);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_STOPPED);
+    TEST_ASSERT_EQUAL(results.numResults, 0);
+    TEST_ASSERT_EQUAL(results.files[0].numTokens, 1);
+    TEST_ASSERT_STREQ(results.files[0].tokens[0].text, "token1");
+    TEST_ASSERT_EQUAL(results.files[1].numTokens, 0);
+    DestroyBatchResults(&results);
+
+    return 0;
+}
+
+static int TokenCacheRoundTripsTokens()
+{
+    char path[32];
+    char changedInput[sizeof(fileInput)];
+    SimpleTokenCache cache;
+    SimpleToken cached;
+    SimpleLexerError error;
+    int result;
+
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(path, ""), 0);
+    error = SimpleTokenCache_Write(path, &lexer, fileInput, strlen(fileInput));
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+
+    SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+    result = SimpleTokenCache_Open(&cache, path, &lexer, fileInput,
+        strlen(fileInput));
+    TEST_ASSERT_EQUAL(result, 0);
+    TEST_ASSERT_EQUAL(cache.numTokens, 4);
+    TEST_ASSERT_EQUAL(cache.error, SIMPLE_LEXER_EOF);
+    SimpleTokenCache_GetToken(&cache, 1, &cached);
+    TEST_ASSERT_STREQ(cached.text, "token 2");
+    TEST_ASSERT(cached.quoted);
+    TEST_ASSERT(!cached.isView);
+    TEST_ASSERT_SPAN_EQUAL(cached.span, 1, 8, 1, 16);
+    TEST_ASSERT_EQUAL(cached.span.end.offset, 15);
+    SimpleTokenCache_GetToken(&cache, 2, &cached);
+    TEST_ASSERT_STREQ(cached.text, "token3");
+    TEST_ASSERT(!cached.quoted);
+    TEST_ASSERT_SPAN_EQUAL(cached.span, 3, 1, 3, 7);
+    SimpleTokenCache_Close(&cache);
+
+    /* Changed texts and languages don't match. */
+    (void) memcpy(changedInput, fileInput, sizeof(fileInput));
+    changedInput[3] = 'E';
+    TEST_ASSERT(SimpleTokenCache_Open(&cache, path, &lexer, changedInput,
+        strlen(changedInput)) != 0);
+    SimpleLexer_SetPositionTracking(&lexer, SIMPLE_LEXER_TRACK_OFFSETS);
+    TEST_ASSERT(SimpleTokenCache_Open(&cache, path, &lexer, fileInput,
+        strlen(fileInput)) != 0);
+    TEST_ASSERT(SimpleTokenCache_Open(&cache, "/nonexistent/simplelexer",
+        &lexer, fileInput, strlen(fileInput)) != 0);
+    (void) unlink(path);
+
+    return 0;
+}
+
+static int LexCachedFallsBackWhenCacheIsStale()
+{
+    static const char* const keywords[] = { "token4", "token3" };
+    char path[32];
+    CollectedTokens collected;
+    SimpleKeywordSet set;
+    SimpleTokenCache cache;
+    SimpleLexerError error;
+    int pass;
+
+    TEST_ASSERT_EQUAL(SimpleKeywordSet_Init(&set, NULL, keywords, 2), 0);
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(path, "not a cache"), 0);
+
+    /* The first pass lexes and writes the cache; the second reads it. */
+    for (pass = 0; pass < 2; ++pass)
+    {
+        SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+        SimpleLexer_SetKeywords(&lexer, &set);
+        SimpleTokenArena_Init(&collected.arena, NULL, 0);
+        collected.numTokens = 0;
+        collected.numViews = 0;
+        collected.maxTokens = 8;
+        error = SimpleLexer_LexCached(&lexer, path, fileInput,
+            strlen(fileInput), CollectToken, &collected);
+        TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+        TEST_ASSERT_EQUAL(CheckCollectedFileTokens(&collected), 0);
+        TEST_ASSERT_EQUAL(collected.numViews, pass == 0 ? 2 : 0);
+        TEST_ASSERT_EQUAL(collected.tokens[2].keyword, SIMPLE_KEYWORD_NONE);
+        TEST_ASSERT_EQUAL(collected.tokens[3].keyword, 0);
+        SimpleTokenArena_Destroy(&collected.arena);
+    }
+
+    /* Caches record what lexing ended with. */
+    SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.maxTokens = 8;
+    error = SimpleLexer_LexCached(&lexer, path, "a \"unclosed", 11,
+        CollectToken, &collected);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_EQUAL(collected.numTokens, 2);
+    SimpleTokenArena_Destroy(&collected.arena);
+    SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+    TEST_ASSERT_EQUAL(SimpleTokenCache_Open(&cache, path, &lexer,
+        "a \"unclosed", 11), 0);
+    TEST_ASSERT_EQUAL(cache.error, SIMPLE_LEXER_UNCLOSED_QUOTED_TOKEN);
+    TEST_ASSERT_EQUAL(cache.numTokens, 2);
+    SimpleTokenCache_Close(&cache);
+
+    (void) unlink(path);
+    SimpleKeywordSet_Destroy(&set);
+    return 0;
+}
+
+static int TokenCacheKeepsFragments()
+{
+    char path[32];
+    char input[40];
+    char smallBuffer[8];
+    CollectedTokens collected;
+    SimpleSymbolTable table;
+    SimpleTokenCache cache;
+    SimpleToken cached;
+    SimpleLexerError error;
+    int pass;
+
+    input[0] = 'x';
+    (void) memset(input + 1, 'a', 38);
+    input[39] = '\0';
+    SimpleSymbolTable_Init(&table, NULL);
+    TEST_ASSERT_EQUAL(WriteTemporaryFile(path, ""), 0);
+
+    /* The first pass lexes and writes the cache; the second reads it.
+       Neither interns the (empty) last fragment. */
+    for (pass = 0; pass < 2; ++pass)
+    {
+        SimpleLexer_Init(&lexer, smallBuffer, sizeof(smallBuffer));
+        SimpleLexer_SetFragments(&lexer, 1);
+        SimpleLexer_SetSymbolTable(&lexer, &table);
+        SimpleTokenArena_Init(&collected.arena, NULL, 0);
+        collected.numTokens = 0;
+        collected.numViews = 0;
+        collected.maxTokens = 8;
+        error = SimpleLexer_LexCached(&lexer, path, input, 39, CollectToken,
+            &collected);
+        TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+        TEST_ASSERT_EQUAL(collected.numTokens, 2);
+        TEST_ASSERT_STREQ(collected.tokens[0].text, input);
+        TEST_ASSERT_EQUAL(collected.tokens[0].firstFragment, 1);
+        TEST_ASSERT_EQUAL(collected.tokens[0].lastFragment, 0);
+        TEST_ASSERT_EQUAL(collected.tokens[0].symbol, SIMPLE_SYMBOL_NONE);
+        TEST_ASSERT_EQUAL(collected.tokens[1].length, 0);
+        TEST_ASSERT_EQUAL(collected.tokens[1].firstFragment, 0);
+        TEST_ASSERT_EQUAL(collected.tokens[1].lastFragment, 1);
+        TEST_ASSERT_EQUAL(collected.tokens[1].symbol, SIMPLE_SYMBOL_NONE);
+        TEST_ASSERT_SPAN_EQUAL(collected.tokens[1].span, 1, 1, 1, 39);
+        SimpleTokenArena_Destroy(&collected.arena);
+    }
+    TEST_ASSERT_EQUAL(table.numSymbols, 0);
+
+    SimpleLexer_Init(&lexer, smallBuffer, sizeof(smallBuffer));
+    SimpleLexer_SetFragments(&lexer, 1);
+    TEST_ASSERT_EQUAL(SimpleTokenCache_Open(&cache, path, &lexer, input, 39),
+        0);
+    SimpleTokenCache_GetToken(&cache, 0, &cached);
+    TEST_ASSERT_EQUAL(cached.firstFragment, 1);
+    TEST_ASSERT_EQUAL(cached.lastFragment, 0);
+    SimpleTokenCache_Close(&cache);
+
+    /* Lexers with other buffer sizes don't match. */
+    SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+    SimpleLexer_SetFragments(&lexer, 1);
+    TEST_ASSERT(SimpleTokenCache_Open(&cache, path, &lexer, input, 39) != 0);
+
+    /* Without fragment mode, the text is lexed (and fails) instead. */
+    SimpleLexer_Init(&lexer, smallBuffer, sizeof(smallBuffer));
+    TEST_ASSERT(SimpleTokenCache_Open(&cache, path, &lexer, input, 39) != 0);
+    SimpleTokenArena_Init(&collected.arena, NULL, 0);
+    collected.numTokens = 0;
+    collected.maxTokens = 8;
+    error = SimpleLexer_LexCached(&lexer, path, input, 39, CollectToken,
+        &collected);
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_TOKEN_TOO_LARGE);
+    TEST_ASSERT_EQUAL(collected.numTokens, 0);
+    SimpleTokenArena_Destroy(&collected.arena);
+
+    (void) unlink(path);
+    SimpleSymbolTable_Destroy(&table);
+    return 0;
+}
+
+/*
+ * Check that SimpleLexer_LexParallel() lexes `text` exactly as
+ * a sequential growable lexer does.
+ */
+static int CheckParallelLexing(
+    const char* text,
+    size_t size,
+    size_t numThreads,
+    size_t chunkSize)
+{
+    SimpleLexer sequentialLexer;
+    SimpleTokenList list;
+    SimpleLexerError error;
+    SimpleLexerError parallelError;
+    size_t index;
+
+    parallelError = SimpleLexer_LexParallel(text, size, numThreads, chunkSize,
+        &list);
+    TEST_ASSERT_EQUAL(SimpleLexer_InitGrowable(&sequentialLexer, NULL, 16, SIZE_MAX), 0);
+    SimpleLexer_SetTokenViews(&sequentialLexer, 1);
+    SimpleLexer_SetInput(&sequentialLexer, text, size);
+
+    for (index = 0; ; ++index)
+    {
+        token.text = NULL;
+        error = SimpleLexer_GetNextToken(&sequentialLexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            error = SimpleLexer_Finish(&sequentialLexer, &token);
+            if (token.text == NULL)
+            {
+                break;
+            }
+        }
+        TEST_ASSERT(index < list.numTokens);
+        TEST_ASSERT_EQUAL(list.tokens[index].length, token.length);
+        TEST_ASSERT_EQUAL(memcmp(list.tokens[index].text, token.text, token.length), 0);
+        TEST_ASSERT_EQUAL(list.tokens[index].isView, token.isView);
+        TEST_ASSERT_EQUAL(list.tokens[index].quoted, token.quoted);
+        TEST_ASSERT_EQUAL(list.tokens[index].startedEscaped, token.startedEscaped);
+        TEST_ASSERT_SPAN_EQUAL(list.tokens[index].span, token.span.start.line,
+            token.span.start.column, token.span.end.line, token.span.end.column);
+        TEST_ASSERT_EQUAL(list.tokens[index].span.start.offset, token.span.start.offset);
+        TEST_ASSERT_EQUAL(list.tokens[index].span.end.offset, token.span.end.offset);
+        if (sequentialLexer.finished)
+        {
+            ++index;
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL(list.numTokens, index);
+    TEST_ASSERT_EQUAL(parallelError, error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error);
+
+    SimpleLexer_Destroy(&sequentialLexer);
+    SimpleTokenList_Destroy(&list);
+    return 0;
+}
+
+static int LexParallelMatchesSequentialLexer()
+{
+    static const char* const inputs[] = {
+        "",
+        "token1 \"token 2\"\n# comment\nto\\ken3 token4",
+        "  leading and trailing  \n\n",
+        "\"quoted # with \\\" escapes\nand newlines\"unquoted\"adjacent\"#c\n\\\\",
+        "a#b\n\"#\" \\# \\\n x\"unclosed\n quoted token",
+        "trailing escape \\",
+    };
+    static const char alphabet[] = "ab \n\"\\#\t";
+    char randomInput[2000];
+    unsigned long seed;
+    size_t input;
+    size_t numThreads;
+    size_t chunkSize;
+    size_t index;
+
+    for (input = 0; input < sizeof(inputs) / sizeof(inputs[0]); ++input)
+    {
+        for (chunkSize = 1; chunkSize <= 8; ++chunkSize)
+        {
+            numThreads = chunkSize / 2 + 1;
+            TEST_ASSERT_EQUAL(CheckParallelLexing(inputs[input],
+                strlen(inputs[input]), numThreads, chunkSize), 0);
+        }
+    }
+
+    seed = 1;
+    for (index = 0; index < sizeof(randomInput); ++index)
+    {
+        seed = seed * 1103515245 + 12345;
+        randomInput[index] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    for (chunkSize = 1; chunkSize <= 1024; chunkSize = chunkSize * 2 + 1)
+    {
+        TEST_ASSERT_EQUAL(CheckParallelLexing(randomInput, sizeof(randomInput),
+            4, chunkSize), 0);
+    }
+    TEST_ASSERT_EQUAL(CheckParallelLexing(randomInput, sizeof(randomInput),
+        0, 0), 0);
+
+    return 0;
+}
+
+/*
+ * Check that `stream` holds exactly the tokens that a sequential growable
+ * lexer produces from `text`.
+ */
+static int CheckTokenStream(
+    const SimpleTokenStream* stream,
+    const char* text,
+    size_t size)
+{
+    SimpleLexer sequentialLexer;
+    SimpleToken streamToken;
+    SimpleLexerError error;
+    size_t index;
+
+    TEST_ASSERT_EQUAL(SimpleLexer_InitGrowable(&sequentialLexer, NULL, 16, SIZE_MAX), 0);
+    SimpleLexer_SetTokenViews(&sequentialLexer, 1);
+    SimpleLexer_SetInput(&sequentialLexer, text, size);
+
+    for (index = 0; ; ++index)
+    {
+        token.text = NULL;
+        error = SimpleLexer_GetNextToken(&sequentialLexer, &token);
+        if (error == SIMPLE_LEXER_EOF)
+        {
+            error = SimpleLexer_Finish(&sequentialLexer, &token);
+            if (token.text == NULL)
+            {
+                break;
+            }
+        }
+        TEST_ASSERT(index < SimpleTokenStream_GetNumTokens(stream));
+        SimpleTokenStream_GetToken(stream, index, &streamToken);
+        TEST_ASSERT_EQUAL(streamToken.length, token.length);
+        TEST_ASSERT_EQUAL(memcmp(streamToken.text, token.text, token.length), 0);
+        TEST_ASSERT_EQUAL(streamToken.quoted, token.quoted);
+        TEST_ASSERT_EQUAL(streamToken.startedEscaped, token.startedEscaped);
+        TEST_ASSERT_SPAN_EQUAL(streamToken.span, token.span.start.line,
+            token.span.start.column, token.span.end.line, token.span.end.column);
+        TEST_ASSERT_EQUAL(streamToken.span.start.offset, token.span.start.offset);
+        TEST_ASSERT_EQUAL(streamToken.span.end.offset, token.span.end.offset);
+        if (sequentialLexer.finished)
+        {
+            ++index;
+            break;
+        }
+    }
+    TEST_ASSERT_EQUAL(SimpleTokenStream_GetNumTokens(stream), index);
+    TEST_ASSERT_EQUAL(stream->error, error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error);
+
+    SimpleLexer_Destroy(&sequentialLexer);
+    return 0;
+}
+
+static int IncrementalLexingMatchesFullLexing()
+{
+    static const char alphabet[] = "ab  \n\n\"\\#";
+    static char texts[2][600];
+    SimpleTokenStream stream;
+    SimpleTokenRange changed;
+    unsigned long random;
+    size_t size;
+    size_t newSize;
+    size_t editStart;
+    size_t numDeleted;
+    size_t numInserted;
+    size_t numTokens;
+    size_t index;
+    size_t edit;
+    char* text;
+    char* newText;
+
+    random = 12345;
+    for (size = 0; size < 300; ++size)
+    {
+        random = random * 1103515245 + 12345;
+        texts[0][size] = alphabet[(random >> 16) % (sizeof(alphabet) - 1)];
+    }
+    text = texts[0];
+    TEST_ASSERT_EQUAL(SimpleTokenStream_Init(&stream, text, size), SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(CheckTokenStream(&stream, text, size), 0);
+
+    /* Edit the text at random, alternating between two buffers. */
+    for (edit = 0; edit < 2000; ++edit)
+    {
+        newText = texts[(edit + 1) & 1];
+        random = random * 1103515245 + 12345;
+        editStart = (random >> 16) % (size + 1);
+        random = random * 1103515245 + 12345;
+        numDeleted = (random >> 16) % 4;
+        if (numDeleted > size - editStart)
+        {
+            numDeleted = size - editStart;
+        }
+        random = random * 1103515245 + 12345;
+        numInserted = size - numDeleted < 500 ? (random >> 16) % 4 : 0;
+
+        (void) memcpy(newText, text, editStart);
+        for (index = 0; index < numInserted; ++index)
+        {
+            random = random * 1103515245 + 12345;
+            newText[editStart + index] =
+                alphabet[(random >> 16) % (sizeof(alphabet) - 1)];
+        }
+        (void) memcpy(newText + editStart + numInserted,
+            text + editStart + numDeleted, size - editStart - numDeleted);
+        newSize = size - numDeleted + numInserted;
+
+        numTokens = SimpleTokenStream_GetNumTokens(&stream);
+        TEST_ASSERT_EQUAL(SimpleTokenStream_Update(&stream, newText, newSize,
+            editStart, editStart + numDeleted, editStart + numInserted,
+            &changed), SIMPLE_LEXER_OK);
+        TEST_ASSERT_EQUAL(SimpleTokenStream_GetNumTokens(&stream),
+            numTokens - changed.numRemoved + changed.numInserted);
+        TEST_ASSERT_EQUAL(CheckTokenStream(&stream, newText, newSize), 0);
+        text = newText;
+        size = newSize;
+    }
+
+    SimpleTokenStream_Destroy(&stream);
+    return 0;
+}
+
+static int IncrementalLexingRelexesOnlyWhatChanged()
+{
+    static char text[20000];
+    static char newText[20001];
+    SimpleTokenStream stream;
+    SimpleTokenRange changed;
+    SimpleToken streamToken;
+    size_t line;
+
+    for (line = 0; line < 1000; ++line)
+    {
+        (void) memcpy(text + line * 20, "key \"some value\" #c\n", 20);
+    }
+    TEST_ASSERT_EQUAL(SimpleTokenStream_Init(&stream, text, sizeof(text)),
+        SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(SimpleTokenStream_GetNumTokens(&stream), 2000);
+
+    /* Insert a newline into line 500's value. */
+    (void) memcpy(newText, text, 500 * 20 + 10);
+    newText[500 * 20 + 10] = '\n';
+    (void) memcpy(newText + 500 * 20 + 11, text + 500 * 20 + 10,
+        sizeof(text) - 500 * 20 - 10);
+    TEST_ASSERT_EQUAL(SimpleTokenStream_Update(&stream, newText,
+        sizeof(newText), 500 * 20 + 10, 500 * 20 + 10, 500 * 20 + 11,
+        &changed), SIMPLE_LEXER_OK);
+    /* The lexer resynchronizes after the next line's first token. */
+    TEST_ASSERT_EQUAL(changed.first, 1001);
+    TEST_ASSERT_EQUAL(changed.numRemoved, 2);
+    TEST_ASSERT_EQUAL(changed.numInserted, 2);
+    SimpleTokenStream_GetToken(&stream, 1001, &streamToken);
+    TEST_ASSERT_EQUAL(streamToken.length, 11);
+    TEST_ASSERT_EQUAL(memcmp(streamToken.text, "some \nvalue", 11), 0);
+    SimpleTokenStream_GetToken(&stream, 1999, &streamToken);
+    TEST_ASSERT_SPAN_EQUAL(streamToken.span, 1001, 5, 1001, 16);
+    TEST_ASSERT_EQUAL(CheckTokenStream(&stream, newText, sizeof(newText)), 0);
+
+    /* Opening a quotation mark changes everything after it. */
+    newText[500 * 20 + 4] = 'x';
+    TEST_ASSERT_EQUAL(SimpleTokenStream_Update(&stream, newText,
+        sizeof(newText), 500 * 20 + 4, 500 * 20 + 5, 500 * 20 + 5,
+        &changed), SIMPLE_LEXER_OK);
+    TEST_ASSERT_EQUAL(CheckTokenStream(&stream, newText, sizeof(newText)), 0);
+
+    SimpleTokenStream_Destroy(&stream);
+    return 0;
+}
+
 typedef struct Test
 {
     const char *name;
@@ -688,6 +2645,45 @@ static Test tests[] = {
     REGISTER_TEST(LeadingTrailingAndMiddleWhitespace),
     REGISTER_TEST(TokenStartedEscaped),
     REGISTER_TEST(CEscapeCharactersProduceAsciiEquivalents),
+    REGISTER_TEST(OnlyAsciiWhitespaceDelimitsTokens),
+    REGISTER_TEST(SpansRecordByteOffsets),
+    REGISTER_TEST(LinesAndColumnsCanBeComputedFromOffsets),
+    REGISTER_TEST(LongTokensSpanningManyBlocks),
+    REGISTER_TEST(LongCommentsAreSkipped),
+    REGISTER_TEST(TokenLargerThanBufferIsTooLarge),
+    REGISTER_TEST(FragmentModeSplitsTokensLargerThanBuffer),
+    REGISTER_TEST(TokenViewsPointIntoInput),
+    REGISTER_TEST(TokenViewsSpanningInputsAreCopied),
+    REGISTER_TEST(GetTokensFillsTokenArray),
+    REGISTER_TEST(GetTokensStopsAtTokenThatDoesNotFitArena),
+    REGISTER_TEST(GrowableLexerGrowsItsBuffer),
+    REGISTER_TEST(GrowableLexerResumesTokenAfterAllocationFailure),
+    REGISTER_TEST(LineIndexMapsOffsetsAndLines),
+    REGISTER_TEST(ArenaDuplicatesTokens),
+    REGISTER_TEST(SymbolTableInternsStrings),
+    REGISTER_TEST(LexerInternsTokens),
+    REGISTER_TEST(KeywordSetFindsKeywords),
+    REGISTER_TEST(LexerClassifiesOnlyUnquotedUnescapedKeywords),
+    REGISTER_TEST(DialectsChangeTheLanguage),
+    REGISTER_TEST(DialectInitRejectsConflictingBytes),
+    REGISTER_TEST(LexerCountsWhatItDoes),
+    REGISTER_TEST(Utf8ModeSplitsOnUnicodeSpaces),
+    REGISTER_TEST(Utf8ModeRejectsInvalidSequences),
+    REGISTER_TEST(ColumnsCanCountCodePointsAndDisplayWidth),
+    REGISTER_TEST(SplitLineStoresWordsInOneBlock),
+    REGISTER_TEST(LineSplitterSplitsStreamsIntoRecords),
+    REGISTER_TEST(FeedPushesTokensAndMixesWithPulling),
+    REGISTER_TEST(LexFdMapsRegularFiles),
+    REGISTER_TEST(LexFdReadsPipes),
+    REGISTER_TEST(LexFdStopsWhenHandlerSaysSo),
+    REGISTER_TEST(LexFilesLexesEachFile),
+    REGISTER_TEST(LexFilesStopsWhenHandlerSaysSo),
+    REGISTER_TEST(TokenCacheRoundTripsTokens),
+    REGISTER_TEST(LexCachedFallsBackWhenCacheIsStale),
+    REGISTER_TEST(TokenCacheKeepsFragments),
+    REGISTER_TEST(LexParallelMatchesSequentialLexer),
+    REGISTER_TEST(IncrementalLexingMatchesFullLexing),
+    REGISTER_TEST(IncrementalLexingRelexesOnlyWhatChanged),
     { NULL, NULL },
 };
 
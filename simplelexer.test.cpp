@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2019 Jordan Vaughan
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY,
+ * OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * These tests check simplelexer.hpp's Tokenizer against SimpleLexer:
+ * Both must return the same tokens, spans, and errors for every text.
+ */
+
+#include "simplelexer.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+static SimpleLexer lexer;
+static SimpleToken token;
+static char defaultBuffer[1024];
+
+#define TEST_ASSERT(x) \
+    do { \
+        if (!(x)) { \
+            (void) std::fprintf(stderr, "assertion failed: " #x "\n"); \
+            return 1; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_EQUAL(x, y) \
+    do { \
+        if ((x) != (y)) { \
+            (void) std::fprintf(stderr, "assertion failed: expected " #x " to equal " #y "\n"); \
+            return 1; \
+        } \
+    } while (0)
+
+#define TEST_ASSERT_POSITION_EQUAL(x, y) \
+    do { \
+        TEST_ASSERT_EQUAL((x).line, (y).line); \
+        TEST_ASSERT_EQUAL((x).column, (y).column); \
+        TEST_ASSERT_EQUAL((x).offset, (y).offset); \
+    } while (0)
+
+/*
+ * Compare the lexer's token with the tokenizer's.  The lexer copies
+ * the token that SimpleLexer_Finish() returns, so `compareViews` is false
+ * for that one.
+ */
+static int CompareTokens(const simplelexer::Token& actual, bool compareViews)
+{
+    TEST_ASSERT(actual.text == std::string_view(token.text, token.length));
+    TEST_ASSERT_POSITION_EQUAL(actual.span.start, token.span.start);
+    TEST_ASSERT_POSITION_EQUAL(actual.span.end, token.span.end);
+    TEST_ASSERT_EQUAL(actual.quoted, token.quoted != 0);
+    TEST_ASSERT_EQUAL(actual.startedEscaped, token.startedEscaped != 0);
+    TEST_ASSERT(!compareViews || actual.isView == (token.isView != 0));
+    TEST_ASSERT(actual.firstFragment && actual.lastFragment);
+    return 0;
+}
+
+/*
+ * Lex `text` with both the lexer and a tokenizer and compare the results.
+ */
+static int CompareLexing(std::string_view text)
+{
+    simplelexer::Tokenizer tokenizer(text);
+    simplelexer::Token actual;
+    SimpleLexerError error;
+
+    SimpleLexer_Reset(&lexer);
+    SimpleLexer_SetInput(&lexer, text.data(), text.size());
+    while ((error = SimpleLexer_GetNextToken(&lexer, &token))
+        == SIMPLE_LEXER_OK)
+    {
+        TEST_ASSERT(tokenizer.next(actual));
+        TEST_ASSERT_EQUAL(CompareTokens(actual, true), 0);
+    }
+    TEST_ASSERT_EQUAL(error, SIMPLE_LEXER_EOF);
+
+    token.text = nullptr;
+    error = SimpleLexer_Finish(&lexer, &token);
+    if (token.text != nullptr)
+    {
+        TEST_ASSERT(tokenizer.next(actual));
+        TEST_ASSERT_EQUAL(CompareTokens(actual, false), 0);
+    }
+    TEST_ASSERT(!tokenizer.next(actual));
+    TEST_ASSERT_EQUAL(tokenizer.error(),
+        error == SIMPLE_LEXER_OK ? SIMPLE_LEXER_EOF : error);
+    return 0;
+}
+
+static int EmptyAndBlankTexts()
+{
+    TEST_ASSERT_EQUAL(CompareLexing(""), 0);
+    TEST_ASSERT_EQUAL(CompareLexing(" "), 0);
+    TEST_ASSERT_EQUAL(CompareLexing(" \t\v\f\r\n\n  "), 0);
+    TEST_ASSERT_EQUAL(CompareLexing(std::string_view("\0 \0\n", 4)), 0);
+    return 0;
+}
+
+static int UnquotedTokens()
+{
+    TEST_ASSERT_EQUAL(CompareLexing("a"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("one two  three\nfour\r\nfive "), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\n\n  indented\n\tline"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("a\"b\" c"), 0);
+    return 0;
+}
+
+static int QuotedTokens()
+{
+    TEST_ASSERT_EQUAL(CompareLexing("\"\""), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\"one two\" \"three\"\"four\"x"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\"spans\nlines\" after"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\"# not a comment\""), 0);
+    return 0;
+}
+
+static int EscapedTokens()
+{
+    TEST_ASSERT_EQUAL(CompareLexing("\\a\\b\\f\\n\\r\\t\\v\\q"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\\ leading a\\ b"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\"in \\\"quotes\\\"\" \\\"x"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("line\\\ncontinued"), 0);
+    return 0;
+}
+
+static int Comments()
+{
+    TEST_ASSERT_EQUAL(CompareLexing("# only a comment"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("a # comment\nb#c\n#\n d"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("a\\#b \"#\"#"), 0);
+    return 0;
+}
+
+static int TextsEndingInErrors()
+{
+    TEST_ASSERT_EQUAL(CompareLexing("\"unclosed"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("a \"unclosed\nquote"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("escaping\\"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\"escaping\\"), 0);
+    TEST_ASSERT_EQUAL(CompareLexing("\\"), 0);
+    return 0;
+}
+
+static int RandomTexts()
+{
+    static const char alphabet[] = "ab \t\n\r\"\\#nt\0";
+    std::uint32_t state;
+    std::string text;
+    std::size_t length;
+    int iteration;
+
+    state = 2463534242u;
+    for (iteration = 0; iteration < 20000; ++iteration)
+    {
+        /* xorshift32 */
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        length = state % 48;
+        text.clear();
+        while (text.size() < length)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            text += alphabet[state % (sizeof(alphabet) - 1)];
+        }
+        if (CompareLexing(text) != 0)
+        {
+            (void) std::fprintf(stderr, "mismatch on random text %d\n",
+                iteration);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct Test
+{
+    const char *name;
+    int (*test)();
+} Test;
+
+#define REGISTER_TEST(name) { #name, name }
+
+static Test tests[] = {
+    REGISTER_TEST(EmptyAndBlankTexts),
+    REGISTER_TEST(UnquotedTokens),
+    REGISTER_TEST(QuotedTokens),
+    REGISTER_TEST(EscapedTokens),
+    REGISTER_TEST(Comments),
+    REGISTER_TEST(TextsEndingInErrors),
+    REGISTER_TEST(RandomTexts),
+    { nullptr, nullptr }
+};
+
+int main(int argc, char **argv)
+{
+    std::size_t numPassed;
+    std::size_t numFailed;
+    Test *currentTest;
+
+    (void) std::fprintf(stdout, "Running tests...\n\n");
+
+    numPassed = 0;
+    numFailed = 0;
+    for (currentTest = tests; currentTest->name != nullptr; ++currentTest)
+    {
+        (void) std::fprintf(stdout, "> %s RUN\n", currentTest->name);
+        SimpleLexer_Init(&lexer, defaultBuffer, sizeof(defaultBuffer));
+        SimpleLexer_SetTokenViews(&lexer, 1);
+        (void) std::memset(&token, 0, sizeof(token));
+        if (currentTest->test() == 0)
+        {
+            (void) std::fprintf(stdout, "> %s PASS\n", currentTest->name);
+            ++numPassed;
+        }
+        else
+        {
+            (void) std::fprintf(stdout, "> %s FAIL\n", currentTest->name);
+            ++numFailed;
+        }
+    }
+
+    (void) std::fprintf(stdout, "\nPassed: %zu\nFailed: %zu\n\n",
+        numPassed, numFailed);
+    return numFailed ? 1 : 0;
+}